@@ -2521,10 +2521,7 @@ static int main_menu_action(struct cfdisk *cf, int key)
 		if (rc)
 			warn = _("Failed to write disklabel.");
 		else {
-			if (cf->device_is_used)
-				fdisk_reread_changes(cf->cxt, cf->original_layout);
-			else
-				fdisk_reread_partition_table(cf->cxt);
+			fdisk_reread_changes(cf->cxt, cf->original_layout);
 			info = _("The partition table has been altered.");
 		}
 		cf->nwrites++;
@@ -601,10 +601,7 @@ static int generic_menu_cb(struct fdisk_context **cxt0,
 		if (fdisk_get_parent(cxt))
 			break; /* nested PT, don't leave */
 
-		if (device_is_used)
-			rc = fdisk_reread_changes(cxt, original_layout);
-		else
-			rc = fdisk_reread_partition_table(cxt);
+		rc = fdisk_reread_changes(cxt, original_layout);
 		if (!rc)
 			rc = fdisk_deassign_device(cxt, 0);
 		/* fallthrough */
@@ -54,7 +54,6 @@
 #endif
 
 int pwipemode = WIPEMODE_AUTO;
-int device_is_used;
 int is_interactive;
 struct fdisk_table *original_layout;
 
@@ -1170,10 +1169,8 @@ int main(int argc, char **argv)
 
 		init_fields(cxt, outarg, NULL);		/* -o <columns> */
 
-		if (!fdisk_is_readonly(cxt)) {
+		if (!fdisk_is_readonly(cxt))
 			fdisk_get_partitions(cxt, &original_layout);
-			device_is_used = fdisk_device_is_used(cxt);
-		}
 
 		while (1)
 			process_fdisk_menu(&cxt);
@@ -26,7 +26,6 @@
 
 extern int pwipemode;
 extern struct fdisk_table *original_layout;
-extern int device_is_used;
 extern int is_interactive;
 
 UL_DEBUG_DECLARE_MASK(fdisk);
@@ -38,6 +38,7 @@
 #endif
 #include <libgen.h>
 #include <sys/time.h>
+#include <sys/wait.h>
 
 #include "c.h"
 #include "xalloc.h"
@@ -51,6 +52,8 @@
 #include "rpmatch.h"
 #include "optutils.h"
 #include "ttyutils.h"
+#include "jsonwrt.h"
+#include "monotonic.h"
 
 #include "libfdisk.h"
 #include "fdisk-list.h"
@@ -90,6 +93,7 @@ enum {
 	ACT_DISKID,
 	ACT_DELETE,
 	ACT_BACKUP_SECTORS,
+	ACT_MULTI,
 };
 
 struct sfdisk {
@@ -102,10 +106,12 @@ struct sfdisk {
 	const char	*label_nested;	/* --label-nested <label> */
 	const char	*backup_file;	/* -O <path> */
 	const char	*move_typescript; /* --movedata <typescript> */
+	size_t		njobs;		/* --jobs <num>, max parallel --multi jobs */
 	char		*prompt;
 
 	struct fdisk_context	*cxt;		/* libfdisk context */
 	struct fdisk_partition  *orig_pa;	/* -N <partno> before the change */
+	struct fdisk_table	*orig_layout;	/* on-disk layout before the change */
 
 	unsigned int verify : 1,	/* call fdisk_verify_disklabel() */
 		     quiet  : 1,	/* suppress extra messages */
@@ -259,6 +265,7 @@ static int sfdisk_deinit(struct sfdisk *sf)
 	}
 
 	fdisk_unref_context(sf->cxt);
+	fdisk_unref_table(sf->orig_layout);
 	free(sf->prompt);
 
 	memset(sf, 0, sizeof(*sf));
@@ -387,6 +394,7 @@ static int assign_device(struct sfdisk *sf, const char *devname, int rdonly)
 		}
 		if (sf->backup)
 			backup_partition_table(sf, devname);
+		fdisk_get_partitions(cxt, &sf->orig_layout);
 	}
 	return 0;
 }
@@ -666,9 +674,11 @@ static int write_changes(struct sfdisk *sf)
 			 * related to the write to the device.
 			 */
 			xusleep(250000);
-			fdisk_reread_partition_table(sf->cxt);
+			fdisk_reread_changes(sf->cxt, sf->orig_layout);
 		}
 	}
+	fdisk_unref_table(sf->orig_layout);
+	sf->orig_layout = NULL;
 
 	if (!rc)
 		rc = fdisk_deassign_device(sf->cxt,
@@ -1124,6 +1134,8 @@ static void assign_device_partition(struct sfdisk *sf,
 	lb = fdisk_get_label(sf->cxt, NULL);
 	if (!lb)
 		errx(EXIT_FAILURE, _("%s: no partition table found"), devname);
+	if (!fdisk_is_readonly(sf->cxt))
+		fdisk_get_partitions(sf->cxt, &sf->orig_layout);
 
 	n = fdisk_get_npartitions(sf->cxt);
 	if (partno > n)
@@ -2030,6 +2042,230 @@ static int command_fdisk(struct sfdisk *sf, int argc, char **argv)
 	return rc;
 }
 
+/*
+ * sfdisk --multi <manifest>
+ *
+ * The manifest contains "<device> <script>" lines. The scripts are applied
+ * to the devices in parallel; every device is processed by a separate
+ * process (with its own libfdisk context) as "sfdisk <device> < <script>".
+ * The number of the processes running at the same time is limited by --jobs
+ * (default is the number of the online CPUs). The result is reported in
+ * JSON, the output of the processes is part of the report.
+ */
+struct multi_job {
+	char		*devname;
+	char		*script;
+	FILE		*out;		/* stdout and stderr of the process */
+	pid_t		pid;
+	int		status;		/* exit status, or 128 + signal */
+	struct timeval	start;
+	struct timeval	end;
+};
+
+static size_t read_manifest(const char *filename, struct multi_job **jobs)
+{
+	FILE *f;
+	char *line = NULL;
+	size_t sz = 0, n = 0, lineno = 0;
+
+	f = strcmp(filename, "-") == 0 ? stdin : fopen(filename, "r" UL_CLOEXECSTR);
+	if (!f)
+		err(EXIT_FAILURE, _("cannot open %s"), filename);
+
+	*jobs = NULL;
+	while (getline(&line, &sz, f) >= 0) {
+		struct multi_job *job;
+		char *dev, *script, *p;
+		size_t i;
+
+		lineno++;
+		dev = (char *) skip_space(line);
+		if (!*dev || *dev == '#')
+			continue;
+		ltrim_whitespace((unsigned char *) dev);
+		rtrim_whitespace((unsigned char *) dev);
+
+		for (p = dev; *p && !isspace((unsigned char) *p); p++);
+		script = (char *) skip_space(p);
+		*p = '\0';
+		if (!*script)
+			errx(EXIT_FAILURE, _("%s:%zu: no script specified for %s"),
+					filename, lineno, dev);
+
+		for (i = 0; i < n; i++) {
+			if (strcmp((*jobs)[i].devname, dev) == 0)
+				errx(EXIT_FAILURE, _("%s:%zu: %s specified more than once"),
+						filename, lineno, dev);
+		}
+
+		*jobs = xrealloc(*jobs, (n + 1) * sizeof(struct multi_job));
+		job = &(*jobs)[n++];
+		memset(job, 0, sizeof(*job));
+		job->devname = xstrdup(dev);
+		job->script = xstrdup(script);
+	}
+
+	free(line);
+	if (f != stdin)
+		fclose(f);
+	return n;
+}
+
+static void __attribute__((__noreturn__)) multi_child(struct sfdisk *sf,
+						      struct multi_job *jobs, size_t njobs,
+						      struct multi_job *job)
+{
+	size_t i;
+	int fd, rc;
+
+	/* the output files of the other jobs are inherited from the parent */
+	for (i = 0; i < njobs; i++) {
+		if (&jobs[i] != job && jobs[i].out) {
+			fclose(jobs[i].out);
+			jobs[i].out = NULL;
+		}
+	}
+
+	fd = open(job->script, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		err(EXIT_FAILURE, _("cannot open %s"), job->script);
+	if (dup2(fd, STDIN_FILENO) < 0
+	    || dup2(fileno(job->out), STDOUT_FILENO) < 0
+	    || dup2(fileno(job->out), STDERR_FILENO) < 0)
+		err(EXIT_FAILURE, _("failed to redirect I/O"));
+	close(fd);
+
+	sf->interactive = 0;
+	rc = command_fdisk(sf, 1, &job->devname);
+	sfdisk_deinit(sf);
+
+	exit(rc == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+static void multi_report_job(struct ul_jsonwrt *json, struct multi_job *job)
+{
+	char buf[64], *data = NULL;
+	struct timeval tv;
+	struct stat st;
+
+	ul_jsonwrt_object_open(json, NULL);
+	ul_jsonwrt_value_s(json, "device", job->devname);
+	ul_jsonwrt_value_s(json, "script", job->script);
+	ul_jsonwrt_value_u64(json, "status", job->status);
+
+	timersub(&job->end, &job->start, &tv);
+	snprintf(buf, sizeof(buf), "%ld.%06ld", (long) tv.tv_sec, (long) tv.tv_usec);
+	ul_jsonwrt_value_raw(json, "time", buf);
+
+	if (fstat(fileno(job->out), &st) == 0 && st.st_size > 0) {
+		data = xmalloc(st.st_size + 1);
+		if (pread(fileno(job->out), data, st.st_size, 0) != st.st_size) {
+			free(data);
+			data = NULL;
+		} else
+			data[st.st_size] = '\0';
+	}
+	ul_jsonwrt_value_s(json, "output", data);
+	ul_jsonwrt_object_close(json);
+
+	free(data);
+}
+
+static void multi_start_job(struct sfdisk *sf, struct multi_job *jobs, size_t njobs,
+			    struct multi_job *job)
+{
+	job->out = tmpfile();
+	if (!job->out)
+		err(EXIT_FAILURE, _("cannot create temporary file"));
+
+	gettime_monotonic(&job->start);
+	job->pid = fork();
+	if (job->pid < 0)
+		err(EXIT_FAILURE, _("fork failed"));
+	if (job->pid == 0)
+		multi_child(sf, jobs, njobs, job);
+
+	DBG(MISC, ul_debug("multi: %s started [pid=%d]", job->devname, (int) job->pid));
+}
+
+static int command_multi(struct sfdisk *sf, int argc, char **argv)
+{
+	struct multi_job *jobs = NULL;
+	struct ul_jsonwrt json;
+	size_t i, n, next = 0, running = 0;
+	int rc = 0;
+
+	if (!argc)
+		errx(EXIT_FAILURE, _("no manifest specified"));
+	if (argc > 1)
+		errx(EXIT_FAILURE, _("unexpected arguments"));
+
+	n = read_manifest(argv[0], &jobs);
+	if (!n)
+		errx(EXIT_FAILURE, _("%s: no devices specified"), argv[0]);
+
+	if (!sf->njobs) {
+		long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		sf->njobs = ncpus > 0 ? (size_t) ncpus : 1;
+	}
+	DBG(MISC, ul_debug("multi: %zu devices, max %zu jobs", n, sf->njobs));
+
+	fflush(stdout);
+	fflush(stderr);
+
+	while (next < n || running) {
+		int status;
+		pid_t pid;
+
+		if (next < n && running < sf->njobs) {
+			multi_start_job(sf, jobs, n, &jobs[next++]);
+			running++;
+			continue;
+		}
+
+		pid = waitpid(-1, &status, 0);
+
+		if (pid < 0) {
+			if (errno == EINTR)
+				continue;
+			err(EXIT_FAILURE, _("waitpid failed"));
+		}
+		for (i = 0; i < n; i++) {
+			struct multi_job *job = &jobs[i];
+
+			if (job->pid != pid)
+				continue;
+			gettime_monotonic(&job->end);
+			if (WIFEXITED(status))
+				job->status = WEXITSTATUS(status);
+			else if (WIFSIGNALED(status))
+				job->status = 128 + WTERMSIG(status);
+			if (job->status)
+				rc = -EINVAL;
+			DBG(MISC, ul_debug("multi: %s done [status=%d]", job->devname, job->status));
+			running--;
+			break;
+		}
+	}
+
+	ul_jsonwrt_init(&json, stdout, 0);
+	ul_jsonwrt_root_open(&json);
+	ul_jsonwrt_array_open(&json, "sfdisk");
+	for (i = 0; i < n; i++)
+		multi_report_job(&json, &jobs[i]);
+	ul_jsonwrt_array_close(&json);
+	ul_jsonwrt_root_close(&json);
+
+	for (i = 0; i < n; i++) {
+		fclose(jobs[i].out);
+		free(jobs[i].devname);
+		free(jobs[i].script);
+	}
+	free(jobs);
+	return rc;
+}
+
 static void __attribute__((__noreturn__)) usage(void)
 {
 	FILE *out = stdout;
@@ -2055,6 +2291,7 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_(" -T, --list-types                  print the recognized types (see -X)\n"), out);
 	fputs(_(" -V, --verify [<dev> ...]          test whether partitions seem correct\n"), out);
 	fputs(_("     --delete <dev> [<part> ...]   delete all or specified partitions\n"), out);
+	fputs(_("     --multi <manifest>            apply scripts to more devices in parallel\n"), out);
 
 	fputs(USAGE_SEPARATOR, out);
 	fputs(_(" --part-label <dev> <part> [<str>] print or change partition label\n"), out);
@@ -2078,6 +2315,7 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_("     --move-data[=<typescript>] move partition data after relocation (requires -N)\n"), out);
 	fputs(_("     --move-use-fsync      use fsync after each write when move data\n"), out);
 	fputs(_(" -f, --force               disable all consistency checking\n"), out);
+	fputs(_("     --jobs <num>          maximal number of parallel --multi jobs\n"), out);
 
 	fprintf(out,
 	      _("     --color[=<when>]      colorize output (%s, %s or %s)\n"), "auto", "always", "never");
@@ -2144,6 +2382,8 @@ int main(int argc, char *argv[])
 		OPT_NOTELL,
 		OPT_RELOCATE,
 		OPT_LOCK,
+		OPT_MULTI,
+		OPT_JOBS,
 	};
 
 	static const struct option longopts[] = {
@@ -2159,6 +2399,7 @@ int main(int argc, char *argv[])
 		{ "dump",    no_argument,	NULL, 'd' },
 		{ "help",    no_argument,       NULL, 'h' },
 		{ "force",   no_argument,       NULL, 'f' },
+		{ "jobs",    required_argument, NULL, OPT_JOBS },
 		{ "json",    no_argument,	NULL, 'J' },
 		{ "label",   required_argument, NULL, 'X' },
 		{ "label-nested", required_argument, NULL, 'Y' },
@@ -2170,6 +2411,7 @@ int main(int argc, char *argv[])
 		{ "no-tell-kernel", no_argument, NULL, OPT_NOTELL },
 		{ "move-data", optional_argument, NULL, OPT_MOVEDATA },
 		{ "move-use-fsync", no_argument, NULL, OPT_MOVEFSYNC },
+		{ "multi",   no_argument,	NULL, OPT_MULTI },
 		{ "output",  required_argument, NULL, 'o' },
 		{ "partno",  required_argument, NULL, 'N' },
 		{ "reorder", no_argument,       NULL, 'r' },
@@ -2364,6 +2606,14 @@ int main(int argc, char *argv[])
 		case OPT_RELOCATE:
 			sf->act = ACT_RELOCATE;
 			break;
+		case OPT_MULTI:
+			sf->act = ACT_MULTI;
+			break;
+		case OPT_JOBS:
+			sf->njobs = strtou32_or_err(optarg, _("failed to parse number of jobs"));
+			if (!sf->njobs)
+				errx(EXIT_FAILURE, _("invalid number of jobs: %s"), optarg);
+			break;
 		case OPT_LOCK:
 			sf->lockmode = "1";
 			if (optarg) {
@@ -2466,6 +2716,10 @@ int main(int argc, char *argv[])
 	case ACT_RELOCATE:
 		rc = command_relocate(sf, argc - optind, argv + optind);
 		break;
+
+	case ACT_MULTI:
+		rc = command_multi(sf, argc - optind, argv + optind);
+		break;
 	}
 
 	sfdisk_deinit(sf);
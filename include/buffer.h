@@ -21,6 +21,7 @@ struct ul_buffer {
 
 void ul_buffer_reset_data(struct ul_buffer *buf);
 void ul_buffer_free_data(struct ul_buffer *buf);
+void ul_buffer_truncate_data(struct ul_buffer *buf, size_t sz);
 int ul_buffer_is_empty(struct ul_buffer *buf);
 void ul_buffer_set_chunksize(struct ul_buffer *buf, size_t sz);
 void ul_buffer_refer_string(struct ul_buffer *buf, char *str);
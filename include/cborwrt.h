@@ -0,0 +1,56 @@
+#ifndef UTIL_LINUX_CBORWRT_H
+#define UTIL_LINUX_CBORWRT_H
+
+/* CBOR (RFC 8949) major types */
+enum {
+	UL_CBOR_UINT	= 0,
+	UL_CBOR_NEGINT	= 1,
+	UL_CBOR_BYTES	= 2,
+	UL_CBOR_TEXT	= 3,
+	UL_CBOR_ARRAY	= 4,
+	UL_CBOR_MAP	= 5,
+	UL_CBOR_TAG	= 6,
+	UL_CBOR_SIMPLE	= 7
+};
+
+#define UL_CBOR_FALSE		0xf4
+#define UL_CBOR_TRUE		0xf5
+#define UL_CBOR_NULL		0xf6
+#define UL_CBOR_FLOAT64		0xfb
+#define UL_CBOR_BREAK		0xff
+#define UL_CBOR_INDEFINITE	31
+
+#define UL_CBOR_SELFDESCRIBE	55799	/* tag, magic 0xd9d9f7 */
+
+struct ul_cborwrt {
+	FILE *out;
+	int depth;
+};
+
+void ul_cborwrt_init(struct ul_cborwrt *fmt, FILE *out);
+void ul_cborwrt_head(struct ul_cborwrt *fmt, int major, uint64_t arg);
+
+void ul_cborwrt_open(struct ul_cborwrt *fmt, const char *name, int type);
+void ul_cborwrt_close(struct ul_cborwrt *fmt);
+
+#define ul_cborwrt_root_open(_f)	ul_cborwrt_open(_f, NULL, UL_CBOR_MAP)
+#define ul_cborwrt_root_close(_f)	ul_cborwrt_close(_f)
+
+#define ul_cborwrt_array_open(_f, _n)	ul_cborwrt_open(_f, _n, UL_CBOR_ARRAY)
+#define ul_cborwrt_array_close(_f)	ul_cborwrt_close(_f)
+
+#define ul_cborwrt_object_open(_f, _n)	ul_cborwrt_open(_f, _n, UL_CBOR_MAP)
+#define ul_cborwrt_object_close(_f)	ul_cborwrt_close(_f)
+
+void ul_cborwrt_value_s(struct ul_cborwrt *fmt,
+			const char *name, const char *data);
+void ul_cborwrt_value_number(struct ul_cborwrt *fmt,
+			const char *name, const char *data);
+void ul_cborwrt_value_u64(struct ul_cborwrt *fmt,
+			const char *name, uint64_t data);
+void ul_cborwrt_value_boolean(struct ul_cborwrt *fmt,
+			const char *name, int data);
+void ul_cborwrt_value_null(struct ul_cborwrt *fmt,
+			const char *name);
+
+#endif /* UTIL_LINUX_CBORWRT_H */
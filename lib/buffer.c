@@ -17,6 +17,23 @@ void ul_buffer_reset_data(struct ul_buffer *buf)
 		memset(buf->ptrs, 0, buf->nptrs * sizeof(char *));
 }
 
+/* cuts the data to @sz bytes, saved pointers behind the end are reset */
+void ul_buffer_truncate_data(struct ul_buffer *buf, size_t sz)
+{
+	size_t i;
+
+	if (!buf->begin || (size_t) (buf->end - buf->begin) <= sz)
+		return;
+
+	buf->end = buf->begin + sz;
+	*buf->end = '\0';
+
+	for (i = 0; i < buf->nptrs; i++) {
+		if (buf->ptrs[i] > buf->end)
+			buf->ptrs[i] = NULL;
+	}
+}
+
 void ul_buffer_free_data(struct ul_buffer *buf)
 {
 	assert(buf);
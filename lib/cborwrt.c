@@ -0,0 +1,247 @@
+/*
+ * CBOR (RFC 8949) output formatting functions.
+ *
+ * No copyright is claimed.  This code is in the public domain; do with
+ * it what you wish.
+ *
+ * The output has the same structure as the output from jsonwrt.c: the
+ * objects are maps with text keys and all the maps and arrays use
+ * indefinite length, so it's possible to write them without the number
+ * of items in advance.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+#include <inttypes.h>
+
+#include "c.h"
+#include "cctype.h"
+#include "c_strtod.h"
+#include "cborwrt.h"
+
+void ul_cborwrt_init(struct ul_cborwrt *fmt, FILE *out)
+{
+	fmt->out = out;
+	fmt->depth = 0;
+}
+
+/* writes the initial byte and the argument in the shortest form */
+void ul_cborwrt_head(struct ul_cborwrt *fmt, int major, uint64_t arg)
+{
+	unsigned char buf[9];
+	size_t i, n;
+
+	buf[0] = major << 5;
+
+	if (arg < 24) {
+		buf[0] |= arg;
+		n = 0;
+	} else if (arg <= UINT8_MAX) {
+		buf[0] |= 24;
+		n = 1;
+	} else if (arg <= UINT16_MAX) {
+		buf[0] |= 25;
+		n = 2;
+	} else if (arg <= UINT32_MAX) {
+		buf[0] |= 26;
+		n = 4;
+	} else {
+		buf[0] |= 27;
+		n = 8;
+	}
+
+	for (i = 0; i < n; i++)			/* big-endian */
+		buf[n - i] = (arg >> (i * 8)) & 0xff;
+
+	fwrite(buf, 1, n + 1, fmt->out);
+}
+
+/*
+ * Returns 1 if @data is a valid UTF-8 string (RFC 3629): no overlong forms,
+ * no surrogates and nothing above U+10FFFF.
+ */
+static int is_valid_utf8(const unsigned char *data, size_t len)
+{
+	size_t i = 0;
+
+	while (i < len) {
+		unsigned char c = data[i];
+		unsigned char lo = 0x80, hi = 0xbf;
+		size_t n, k;
+
+		if (c < 0x80) {
+			i++;
+			continue;
+		}
+		if (c >= 0xc2 && c <= 0xdf)
+			n = 1;
+		else if (c >= 0xe0 && c <= 0xef) {
+			n = 2;
+			if (c == 0xe0)
+				lo = 0xa0;	/* overlong */
+			else if (c == 0xed)
+				hi = 0x9f;	/* surrogates */
+		} else if (c >= 0xf0 && c <= 0xf4) {
+			n = 3;
+			if (c == 0xf0)
+				lo = 0x90;	/* overlong */
+			else if (c == 0xf4)
+				hi = 0x8f;	/* above U+10FFFF */
+		} else
+			return 0;
+
+		if (len - i <= n)
+			return 0;
+		for (k = 1; k <= n; k++) {
+			unsigned char x = data[i + k];
+
+			if (x < lo || x > hi)
+				return 0;
+			lo = 0x80;
+			hi = 0xbf;
+		}
+		i += n + 1;
+	}
+	return 1;
+}
+
+/* the text string has to be UTF-8, anything else is written as byte string */
+static void cborwrt_text(struct ul_cborwrt *fmt, const char *data, size_t len)
+{
+	int major = is_valid_utf8((const unsigned char *) data, len) ?
+			UL_CBOR_TEXT : UL_CBOR_BYTES;
+
+	ul_cborwrt_head(fmt, major, len);
+	if (len)
+		fwrite(data, 1, len, fmt->out);
+}
+
+/* the keys are in lower case, the same as in JSON */
+static void cborwrt_key(struct ul_cborwrt *fmt, const char *name)
+{
+	size_t i, len = strlen(name);
+
+	ul_cborwrt_head(fmt, UL_CBOR_TEXT, len);
+	for (i = 0; i < len; i++)
+		fputc(c_tolower(name[i]), fmt->out);
+}
+
+void ul_cborwrt_open(struct ul_cborwrt *fmt, const char *name, int type)
+{
+	if (fmt->depth == 0)
+		ul_cborwrt_head(fmt, UL_CBOR_TAG, UL_CBOR_SELFDESCRIBE);
+	if (name)
+		cborwrt_key(fmt, name);
+
+	fputc((type << 5) | UL_CBOR_INDEFINITE, fmt->out);
+	fmt->depth++;
+}
+
+void ul_cborwrt_close(struct ul_cborwrt *fmt)
+{
+	assert(fmt->depth > 0);
+
+	fputc(UL_CBOR_BREAK, fmt->out);
+	fmt->depth--;
+}
+
+void ul_cborwrt_value_s(struct ul_cborwrt *fmt,
+			const char *name, const char *data)
+{
+	if (name)
+		cborwrt_key(fmt, name);
+	if (data && *data)
+		cborwrt_text(fmt, data, strlen(data));
+	else
+		fputc(UL_CBOR_NULL, fmt->out);
+}
+
+static void cborwrt_double(struct ul_cborwrt *fmt, double d)
+{
+	uint64_t x;
+	unsigned char buf[9];
+	size_t i;
+
+	memcpy(&x, &d, sizeof(x));
+
+	buf[0] = UL_CBOR_FLOAT64;
+	for (i = 0; i < 8; i++)
+		buf[8 - i] = (x >> (i * 8)) & 0xff;
+	fwrite(buf, 1, sizeof(buf), fmt->out);
+}
+
+/*
+ * The number is in the string (as for JSON). It's written as an integer or
+ * as a float; the string which is not a number is written as text.
+ */
+void ul_cborwrt_value_number(struct ul_cborwrt *fmt,
+			const char *name, const char *data)
+{
+	char *end = NULL;
+
+	if (name)
+		cborwrt_key(fmt, name);
+	if (!data || !*data) {
+		fputc(UL_CBOR_NULL, fmt->out);
+		return;
+	}
+
+	errno = 0;
+	if (*data == '-') {
+		intmax_t num = strtoimax(data, &end, 10);
+
+		if (!errno && end && !*end && end > data + 1) {
+			ul_cborwrt_head(fmt, num < 0 ? UL_CBOR_NEGINT : UL_CBOR_UINT,
+					num < 0 ? (uint64_t) (-1 - num) : (uint64_t) num);
+			return;
+		}
+	} else if (isdigit((unsigned char) *data)) {
+		uintmax_t num = strtoumax(data, &end, 10);
+
+		if (!errno && end && !*end) {
+			ul_cborwrt_head(fmt, UL_CBOR_UINT, num);
+			return;
+		}
+	}
+
+	/* decimal float (not hex, inf or nan) */
+	if (data[strspn(data, "0123456789+-.eE")] == '\0') {
+		double d;
+
+		errno = 0;
+		end = NULL;
+		d = c_strtod(data, &end);
+		if (!errno && end && end > data && !*end) {
+			cborwrt_double(fmt, d);
+			return;
+		}
+	}
+
+	cborwrt_text(fmt, data, strlen(data));
+}
+
+void ul_cborwrt_value_u64(struct ul_cborwrt *fmt,
+			const char *name, uint64_t data)
+{
+	if (name)
+		cborwrt_key(fmt, name);
+	ul_cborwrt_head(fmt, UL_CBOR_UINT, data);
+}
+
+void ul_cborwrt_value_boolean(struct ul_cborwrt *fmt,
+			const char *name, int data)
+{
+	if (name)
+		cborwrt_key(fmt, name);
+	fputc(data ? UL_CBOR_TRUE : UL_CBOR_FALSE, fmt->out);
+}
+
+void ul_cborwrt_value_null(struct ul_cborwrt *fmt,
+			const char *name)
+{
+	if (name)
+		cborwrt_key(fmt, name);
+	fputc(UL_CBOR_NULL, fmt->out);
+}
@@ -7,6 +7,8 @@
  * Written by Karel Zak <kzak@redhat.com>
  */
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 #include <inttypes.h>
 #include <ctype.h>
 #include <cctype.h>
@@ -98,7 +100,87 @@ static void fputs_quoted_case_json(const char *data, FILE *out, int dir)
 	fputc('"', out);
 }
 
-#define fputs_quoted_json(_d, _o)       fputs_quoted_case_json(_d, _o, 0)
+/*
+ * Escape sequences for bytes which cannot be in JSON string: 0 for safe bytes,
+ * 'u' for \u00XX, otherwise the char after backslash.
+ */
+static const char json_escapes[256] = {
+	'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',		/* 0x00 - 0x07 */
+	'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',		/* 0x08 - 0x0f */
+	'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',		/* 0x10 - 0x17 */
+	'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',		/* 0x18 - 0x1f */
+	['"'] = '"',
+	['\\'] = '\\'
+};
+
+#define JSON_ONES	((uint64_t) 0x0101010101010101ULL)
+#define JSON_HIGHS	((uint64_t) 0x8080808080808080ULL)
+
+/* returns non-zero if any byte in the word is '"', '\\' or a control char */
+static inline uint64_t json_word_has_special(uint64_t v)
+{
+	uint64_t q = v ^ (JSON_ONES * '"'),
+		 b = v ^ (JSON_ONES * '\\');
+
+	return (((v - JSON_ONES * 0x20) & ~v)		/* byte < 0x20 */
+		| ((q - JSON_ONES) & ~q)		/* byte == '"' */
+		| ((b - JSON_ONES) & ~b))		/* byte == '\\' */
+		& JSON_HIGHS;
+}
+
+/* returns length of the initial segment of @data without special bytes */
+static size_t json_safe_span(const char *data, size_t len)
+{
+	size_t i = 0;
+
+	for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+		uint64_t v;
+
+		memcpy(&v, data + i, sizeof(v));
+		if (json_word_has_special(v))
+			break;
+	}
+	while (i < len && !json_escapes[(unsigned char) data[i]])
+		i++;
+	return i;
+}
+
+/*
+ * The same as fputs_quoted_case_json(data, out, 0), but the runs of safe
+ * bytes are written by one fwrite() and the escapes are looked up in the
+ * table rather than tested byte by byte. This is the hot path for JSON
+ * values.
+ */
+static void fputs_quoted_json(const char *data, FILE *out)
+{
+	size_t len = data ? strlen(data) : 0;
+
+	fputc('"', out);
+	while (len) {
+		size_t n = json_safe_span(data, len);
+		unsigned char c;
+		char esc[7];
+
+		if (n)
+			fwrite(data, 1, n, out);
+		if (n == len)
+			break;
+
+		c = (unsigned char) data[n];
+		esc[0] = '\\';
+		if (json_escapes[c] == 'u') {
+			snprintf(esc + 1, sizeof(esc) - 1, "u00%02x", c);
+			fwrite(esc, 1, 6, out);
+		} else {
+			esc[1] = json_escapes[c];
+			fwrite(esc, 1, 2, out);
+		}
+		data += n + 1;
+		len -= n + 1;
+	}
+	fputc('"', out);
+}
+
 #define fputs_quoted_json_upper(_d, _o) fputs_quoted_case_json(_d, _o, 1)
 #define fputs_quoted_json_lower(_d, _o) fputs_quoted_case_json(_d, _o, -1)
 
@@ -227,3 +309,114 @@ void ul_jsonwrt_value_null(struct ul_jsonwrt *fmt,
 	fputs("null", fmt->out);
 	ul_jsonwrt_value_close(fmt);
 }
+
+#ifdef TEST_PROGRAM_JSONWRT
+# include <stdlib.h>
+# include <time.h>
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void random_string(char *buf, size_t sz, unsigned int *seed)
+{
+	size_t i, len = rand_r(seed) % (sz - 1);
+
+	for (i = 0; i < len; i++) {
+		int r = rand_r(seed) % 8;
+
+		/* mostly printable chars, but some specials and high bytes */
+		buf[i] = r == 0 ? 1 + rand_r(seed) % 0x1f :
+			 r == 1 ? "\"\\"[rand_r(seed) % 2] :
+			 r == 2 ? 0x80 + rand_r(seed) % 0x80 :
+				  0x20 + rand_r(seed) % 0x5f;
+	}
+	buf[len] = '\0';
+}
+
+/* compares fputs_quoted_json() with the reference byte-by-byte version */
+static int test_compare(unsigned int seed, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		char str[256], *a = NULL, *b = NULL;
+		size_t asz = 0, bsz = 0;
+		FILE *fa, *fb;
+		int rc;
+
+		random_string(str, sizeof(str), &seed);
+
+		fa = open_memstream(&a, &asz);
+		fb = open_memstream(&b, &bsz);
+		if (!fa || !fb)
+			err(EXIT_FAILURE, "open_memstream failed");
+
+		fputs_quoted_json(str, fa);
+		fputs_quoted_case_json(str, fb, 0);
+		fclose(fa);
+		fclose(fb);
+
+		rc = asz != bsz || memcmp(a, b, asz) != 0;
+		if (rc)
+			fprintf(stderr, "mismatch: fast='%s' reference='%s'\n", a, b);
+		free(a);
+		free(b);
+		if (rc)
+			return EXIT_FAILURE;
+	}
+	printf("%zu strings OK\n", n);
+	return EXIT_SUCCESS;
+}
+
+static int test_bench(size_t n)
+{
+	char str[] = "/dev/mapper/luks-0123456789abcdef rw,relatime,seclabel \"x\"";
+	FILE *out = fopen("/dev/null", "w");
+	double t0, t1, t2;
+	size_t i;
+
+	if (!out)
+		err(EXIT_FAILURE, "/dev/null: open failed");
+
+	t0 = now();
+	for (i = 0; i < n; i++)
+		fputs_quoted_case_json(str, out, 0);
+	t1 = now();
+	for (i = 0; i < n; i++)
+		fputs_quoted_json(str, out);
+	t2 = now();
+
+	fclose(out);
+	printf("reference: %8.3f s\n", t1 - t0);
+	printf("fast:      %8.3f s\n", t2 - t1);
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+	int i;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s --compare [<seed> [<count>]] | --bench [<count>] | <string> ...\n",
+				program_invocation_short_name);
+		return EXIT_FAILURE;
+	}
+
+	if (strcmp(argv[1], "--compare") == 0)
+		return test_compare(argc > 2 ? strtoul(argv[2], NULL, 10) : 1,
+				    argc > 3 ? strtoul(argv[3], NULL, 10) : 100000);
+	if (strcmp(argv[1], "--bench") == 0)
+		return test_bench(argc > 2 ? strtoul(argv[2], NULL, 10) : 10000000);
+
+	for (i = 1; i < argc; i++) {
+		fputs_quoted_json(argv[i], stdout);
+		fputc('\n', stdout);
+	}
+	return EXIT_SUCCESS;
+}
+#endif /* TEST_PROGRAM_JSONWRT */
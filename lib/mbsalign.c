@@ -20,6 +20,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <limits.h>
 #include <ctype.h>
 
@@ -28,6 +29,50 @@
 #include "strutils.h"
 #include "widechar.h"
 
+#define MBS_ONES	0x0101010101010101ULL
+#define MBS_HIGHS	0x8080808080808080ULL
+
+/* non-zero if any byte of @v is not printable ASCII, or is '\\' and @nobslash */
+static inline uint64_t mbs_word_has_nonascii(uint64_t v, int nobslash)
+{
+	uint64_t d = v ^ (MBS_ONES * 0x7f),
+		 b = v ^ (MBS_ONES * '\\');
+	uint64_t res = v					/* byte >= 0x80 */
+		| ((v - MBS_ONES * 0x20) & ~v)			/* byte < 0x20 */
+		| ((d - MBS_ONES) & ~d);			/* byte == 0x7f */
+
+	if (nobslash)
+		res |= (b - MBS_ONES) & ~b;			/* byte == '\\' */
+	return res & MBS_HIGHS;
+}
+
+static inline int mbs_is_ascii_print(unsigned char c, int nobslash)
+{
+	return c >= 0x20 && c < 0x7f && !(nobslash && c == '\\');
+}
+
+/*
+ * Returns length of the initial segment of @s (max @len bytes) with printable
+ * ASCII chars only. Every such char is one cell wide in all locales, so the
+ * segment does not need the wide-char conversion. The backslash is excluded
+ * if @nobslash is set, the mbs_safe_* functions encode "\x".
+ */
+static size_t mbs_ascii_span(const char *s, size_t len, int nobslash)
+{
+	size_t i = 0;
+
+	for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+		uint64_t v;
+
+		memcpy(&v, s + i, sizeof(v));
+		if (mbs_word_has_nonascii(v, nobslash))
+			break;
+	}
+	while (i < len && mbs_is_ascii_print((unsigned char) s[i], nobslash))
+		i++;
+	return i;
+}
+
 /*
  * Counts number of cells in multibyte string. All control and
  * non-printable chars are ignored.
@@ -47,6 +92,13 @@ size_t mbs_nwidth(const char *buf, size_t bufsz)
 		last = p + (bufsz - 1);
 
 	while (p && *p && p <= last) {
+		size_t n = mbs_ascii_span(p, last - p + 1, 0);
+
+		if (n) {
+			width += n;
+			p += n;
+			continue;
+		}
 		if (iscntrl((unsigned char) *p)) {
 			p++;
 
@@ -66,12 +118,15 @@ size_t mbs_nwidth(const char *buf, size_t bufsz)
 
 		if (len == 0)
 			break;
-		if (len > 0 && iswprint(wc)) {
+		if (len == (size_t) -1 || len == (size_t) -2) {
+			/* invalid sequence, note that wc is undefined */
+			len = 1;
+			memset(&st, 0, sizeof(st));
+		} else if (iswprint(wc)) {
 			int x = wcwidth(wc);
 			if (x > 0)
 				width += x;
-		} else if (len == (size_t) -1 || len == (size_t) -2)
-			len = 1;
+		}
 		p += len;
 #else
 		if (isprint((unsigned char) *p))
@@ -110,6 +165,13 @@ size_t mbs_safe_nwidth(const char *buf, size_t bufsz, size_t *sz)
 		last = p + (bufsz - 1);
 
 	while (p && *p && p <= last) {
+		size_t n = mbs_ascii_span(p, last - p + 1, 1);
+
+		if (n) {
+			width += n, bytes += n;
+			p += n;
+			continue;
+		}
 		if ((p < last && *p == '\\' && *(p + 1) == 'x')
 		    || iscntrl((unsigned char) *p)) {
 			width += 4, bytes += 4;		/* *p encoded to \x?? */
@@ -187,6 +249,15 @@ char *mbs_safe_encode_to_buffer(const char *s, size_t *width, char *buf, const c
 	*width = 0;
 
 	while (p && *p) {
+		size_t n = mbs_ascii_span(p, sz - (p - s), 1);
+
+		if (n) {
+			memcpy(r, p, n);
+			r += n;
+			*width += n;
+			p += n;
+			continue;
+		}
 		if (safechars && strchr(safechars, *p)) {
 			*r++ = *p++;
 			continue;
@@ -276,6 +347,15 @@ char *mbs_invalid_encode_to_buffer(const char *s, size_t *width, char *buf)
 	*width = 0;
 
 	while (p && *p) {
+		size_t n = mbs_ascii_span(p, sz - (p - s), 1);
+
+		if (n) {
+			memcpy(r, p, n);
+			r += n;
+			*width += n;
+			p += n;
+			continue;
+		}
 #ifdef HAVE_WIDECHAR
 		wchar_t wc;
 		size_t len = mbrtowc(&wc, p, MB_CUR_MAX, &st);
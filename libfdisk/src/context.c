@@ -5,8 +5,11 @@
 #include "blkdev.h"
 #ifdef __linux__
 # include "partx.h"
+# include "sysfs.h"
+# include "fileutils.h"
 #endif
 #include "loopdev.h"
+#include "monotonic.h"
 #include "fdiskP.h"
 
 #include "strutils.h"
@@ -830,6 +833,32 @@ int fdisk_reassign_device(struct fdisk_context *cxt)
 	return rc;
 }
 
+static int reread_ioctl(struct fdisk_context *cxt)
+{
+	int i = 0;
+
+	DBG(CXT, ul_debugobj(cxt, "calling re-read ioctl"));
+	sync();
+#ifdef BLKRRPART
+	fdisk_info(cxt, _("Calling ioctl() to re-read partition table."));
+	i = ioctl(cxt->dev_fd, BLKRRPART);
+#else
+	errno = ENOSYS;
+	i = 1;
+#endif
+	return i ? -errno : 0;
+}
+
+static void reread_failed(struct fdisk_context *cxt, int rc)
+{
+	errno = -rc;
+	fdisk_warn(cxt, _("Re-reading the partition table failed."));
+	fdisk_info(cxt,	_(
+		"The kernel still uses the old table. The "
+		"new table will be used at the next reboot "
+		"or after you run partprobe(8) or partx(8)."));
+}
+
 /**
  * fdisk_reread_partition_table:
  * @cxt: context
@@ -840,7 +869,7 @@ int fdisk_reassign_device(struct fdisk_context *cxt)
  */
 int fdisk_reread_partition_table(struct fdisk_context *cxt)
 {
-	int i = 0;
+	int rc;
 
 	assert(cxt);
 	assert(cxt->dev_fd >= 0);
@@ -848,26 +877,10 @@ int fdisk_reread_partition_table(struct fdisk_context *cxt)
 	if (!S_ISBLK(cxt->dev_st.st_mode))
 		return 0;
 
-	DBG(CXT, ul_debugobj(cxt, "calling re-read ioctl"));
-	sync();
-#ifdef BLKRRPART
-	fdisk_info(cxt, _("Calling ioctl() to re-read partition table."));
-	i = ioctl(cxt->dev_fd, BLKRRPART);
-#else
-	errno = ENOSYS;
-	i = 1;
-#endif
-
-	if (i) {
-		fdisk_warn(cxt, _("Re-reading the partition table failed."));
-		fdisk_info(cxt,	_(
-			"The kernel still uses the old table. The "
-			"new table will be used at the next reboot "
-			"or after you run partprobe(8) or partx(8)."));
-		return -errno;
-	}
-
-	return 0;
+	rc = reread_ioctl(cxt);
+	if (rc)
+		reread_failed(cxt, rc);
+	return rc;
 }
 
 #ifdef __linux__
@@ -885,16 +898,213 @@ static inline int add_to_partitions_array(
 	(*n)++;
 	return 0;
 }
+
+/*
+ * Returns partitions as used by kernel (from /sys/block/<disk>/<part>/). The
+ * start and size are converted from 512-byte to the context sectors.
+ */
+static int get_kernel_partitions(struct fdisk_context *cxt, struct fdisk_table **tb)
+{
+	struct path_cxt *pc;
+	struct dirent *d;
+	DIR *dir;
+	unsigned int ssf = cxt->sector_size / 512;
+	int rc = 0;
+
+	pc = ul_new_sysfs_path(fdisk_get_devno(cxt), NULL, NULL);
+	if (!pc)
+		return -errno;
+	dir = ul_path_opendir(pc, NULL);
+	if (!dir) {
+		rc = -errno;
+		goto done;
+	}
+	*tb = fdisk_new_table();
+	if (!*tb) {
+		rc = -ENOMEM;
+		goto done;
+	}
+
+	while ((d = xreaddir(dir))) {
+		struct fdisk_partition *pa;
+		uint64_t start, size;
+		int partno;
+
+		if (!sysfs_blkdev_is_partition_dirent(dir, d, NULL))
+			continue;
+		if (ul_path_readf_s32(pc, &partno, "%s/partition", d->d_name) != 0
+		    || partno <= 0
+		    || ul_path_readf_u64(pc, &start, "%s/start", d->d_name) != 0
+		    || ul_path_readf_u64(pc, &size, "%s/size", d->d_name) != 0)
+			continue;
+
+		pa = fdisk_new_partition();
+		if (!pa) {
+			rc = -ENOMEM;
+			break;
+		}
+		pa->partno = partno - 1;
+		pa->start = start / ssf;
+		pa->size = size / ssf;
+
+		DBG(CXT, ul_debugobj(cxt, "kernel partition #%zu [start=%ju, size=%ju]",
+				pa->partno, (uintmax_t) pa->start, (uintmax_t) pa->size));
+		rc = fdisk_table_add_partition(*tb, pa);
+		fdisk_unref_partition(pa);
+		if (rc)
+			break;
+	}
+	if (!rc)
+		rc = fdisk_table_sort_partitions(*tb, fdisk_partition_cmp_partno);
+done:
+	if (dir)
+		closedir(dir);
+	ul_unref_path(pc);
+	return rc;
+}
+
+enum {
+	BLKPG_SYNC_DEL,
+	BLKPG_SYNC_RESIZE,
+	BLKPG_SYNC_ADD
+};
+
+/*
+ * Calls one BLKPG ioctl, @start and @size are in 512-byte sectors.
+ */
+static int blkpg_sync_partition(struct fdisk_context *cxt, int op, size_t partno,
+				uint64_t start, uint64_t size)
+{
+	static const char *const names[] = {
+		[BLKPG_SYNC_DEL] = "BLKPG_DEL_PARTITION",
+		[BLKPG_SYNC_RESIZE] = "BLKPG_RESIZE_PARTITION",
+		[BLKPG_SYNC_ADD] = "BLKPG_ADD_PARTITION"
+	};
+	struct timeval a, b, d;
+	int rc = 0;
+
+	gettime_monotonic(&a);
+	switch (op) {
+	case BLKPG_SYNC_DEL:
+		rc = partx_del_partition(cxt->dev_fd, partno);
+		break;
+	case BLKPG_SYNC_RESIZE:
+		rc = partx_resize_partition(cxt->dev_fd, partno, start, size);
+		break;
+	case BLKPG_SYNC_ADD:
+		rc = partx_add_partition(cxt->dev_fd, partno, start, size);
+		break;
+	}
+	if (rc)
+		rc = -errno;
+	gettime_monotonic(&b);
+	timersub(&b, &a, &d);
+
+	DBG(CXT, ul_debugobj(cxt, "#%zu %s [start=%ju, size=%ju]: rc=%d, %ld usec",
+			partno, names[op], (uintmax_t) start, (uintmax_t) size, rc,
+			(long) (d.tv_sec * 1000000 + d.tv_usec)));
+	return rc;
+}
+
+static inline int strings_differ(const char *a, const char *b, int icase)
+{
+	if (!a || !b)
+		return a != b;
+	return icase ? strcasecmp(a, b) : strcmp(a, b);
+}
+
+/*
+ * Returns 1 if the partition type, name or UUID of @a and @b differ.
+ */
+static int partition_ids_differ(struct fdisk_partition *a, struct fdisk_partition *b)
+{
+	struct fdisk_parttype *x = a->type, *y = b->type;
+
+	if (!x || !y) {
+		if (x != y)
+			return 1;
+	} else if (x->code != y->code || strings_differ(x->typestr, y->typestr, 1))
+		return 1;
+
+	return strings_differ(a->name, b->name, 0)
+	       || strings_differ(a->uuid, b->uuid, 1);
+}
+
+/*
+ * The BLKPG ioctls generate uevents for the removed and added partitions
+ * only. Send the "change" uevent to the disk (the label may be modified) and
+ * to the kept partitions listed in @chg (type, name or UUID modified) to keep
+ * the udev database and /dev/disk/by-* links up to date. The other partitions
+ * are not touched to avoid a useless udev re-probe of the whole disk.
+ */
+static void send_change_uevents(struct fdisk_context *cxt,
+				struct fdisk_partition **chg, size_t nchgs)
+{
+	struct path_cxt *pc;
+	struct dirent *d;
+	DIR *dir;
+	size_t i, n = 0;
+
+	pc = ul_new_sysfs_path(fdisk_get_devno(cxt), NULL, NULL);
+	if (!pc)
+		return;
+
+	dir = nchgs ? ul_path_opendir(pc, NULL) : NULL;
+	if (dir) {
+		while ((d = xreaddir(dir))) {
+			int partno;
+
+			if (!sysfs_blkdev_is_partition_dirent(dir, d, NULL)
+			    || ul_path_readf_s32(pc, &partno, "%s/partition", d->d_name) != 0)
+				continue;
+			for (i = 0; i < nchgs; i++) {
+				if (chg[i]->partno + 1 != (size_t) partno)
+					continue;
+				if (ul_path_writef_string(pc, "change", "%s/uevent", d->d_name) == 0)
+					n++;
+				break;
+			}
+		}
+		closedir(dir);
+	}
+	if (ul_path_write_string(pc, "change", "uevent") == 0)
+		n++;
+
+	DBG(CXT, ul_debugobj(cxt, "change uevents sent [%zu]", n));
+	ul_unref_path(pc);
+}
 #endif
 
 /**
  * fdisk_reread_changes:
  * @cxt: context
- * @org: original layout (on disk)
+ * @org: original layout (on disk) or NULL
  *
  * Like fdisk_reread_partition_table() but don't forces kernel re-read all
- * partition table. The BLKPG_* ioctls are used for individual partitions. The
- * advantage is that unmodified partitions maybe mounted.
+ * partition table if the device is used by system. The BLKPG_* ioctls are
+ * used for individual partitions. The advantage is that unmodified
+ * partitions maybe mounted.
+ *
+ * If the device is not used by system (see fdisk_device_is_used()) or @org
+ * is NULL, then the partition table is re-read by kernel like
+ * fdisk_reread_partition_table() does. Note that kernel removes and adds
+ * all the partitions in this case (remove and add uevents are generated for
+ * unmodified partitions too). Only if the re-read fails because the device
+ * is busy, the partitions as used by kernel (from /sys) are compared with
+ * the current layout and updated by the BLKPG_* ioctls (GPT and DOS only).
+ *
+ * If the device is used by system, the @org layout is compared with the
+ * current layout and only removed, moved, resized and new partitions are
+ * updated in kernel. The partitions are removed first, then resized and the
+ * new (or moved) partitions are added at the end, so the kernel never sees
+ * overlapping partitions.
+ *
+ * The BLKPG_* ioctls don't inform udev about modified type, name or UUID,
+ * so the "change" uevent is sent for the disk and for the kept partitions
+ * where the type, name or UUID differs from @org after the BLKPG_* update.
+ * Without @org only the disk gets the uevent. Note that kernel does not know
+ * the name and UUID (PARTNAME and PARTUUID) of the partitions added by
+ * BLKPG_* ioctls.
  *
  * The function behaves like fdisk_reread_partition_table() on systems where
  * are no available BLKPG_* ioctls.
@@ -904,14 +1114,47 @@ static inline int add_to_partitions_array(
 #ifdef __linux__
 int fdisk_reread_changes(struct fdisk_context *cxt, struct fdisk_table *org)
 {
-	struct fdisk_table *tb = NULL;
+	struct fdisk_table *tb = NULL, *kern = NULL, *base = org;
 	struct fdisk_iter itr;
 	struct fdisk_partition *pa;
-	struct fdisk_partition **rem = NULL, **add = NULL, **upd = NULL;
+	struct fdisk_partition **rem = NULL, **add = NULL, **upd = NULL, **chg = NULL;
+	struct timeval start, end, diff;
 	int change, rc = 0, err = 0;
-	size_t nparts, i, nadds = 0, nupds = 0, nrems = 0;
+	size_t nparts, i, nadds = 0, nupds = 0, nrems = 0, nsame = 0, nchgs = 0;
 	unsigned int ssf;
 
+	assert(cxt);
+	assert(cxt->dev_fd >= 0);
+
+	if (!S_ISBLK(cxt->dev_st.st_mode))
+		return 0;
+
+	gettime_monotonic(&start);
+
+	if (!org || !fdisk_device_is_used(cxt)) {
+		rc = reread_ioctl(cxt);
+
+		/* kernel parses some labels in a different way than libfdisk
+		 * (whole-disk and nested partitions) */
+		if (rc == -EBUSY
+		    && (fdisk_is_label(cxt, GPT) || fdisk_is_label(cxt, DOS))) {
+			DBG(CXT, ul_debugobj(cxt, "device is busy, using kernel layout"));
+			rc = get_kernel_partitions(cxt, &kern);
+			if (rc) {
+				DBG(CXT, ul_debugobj(cxt, "cannot read kernel partitions [rc=%d]", rc));
+				fdisk_unref_table(kern);
+				rc = -EBUSY;
+			}
+		}
+		if (rc) {
+			reread_failed(cxt, rc);
+			return rc;
+		}
+		if (!kern)
+			return 0;
+		base = kern;
+	}
+
 	DBG(CXT, ul_debugobj(cxt, "rereading changes"));
 
 	fdisk_reset_iter(&itr, FDISK_ITER_FORWARD);
@@ -919,12 +1162,23 @@ int fdisk_reread_changes(struct fdisk_context *cxt, struct fdisk_table *org)
 	/* the current layout */
 	fdisk_get_partitions(cxt, &tb);
 	/* maximal number of partitions */
-	nparts = max(fdisk_table_get_nents(tb), fdisk_table_get_nents(org));
-
-	while (fdisk_diff_tables(org, tb, &itr, &pa, &change) == 0) {
-		if (change == FDISK_DIFF_UNCHANGED)
-			continue;
+	nparts = max(fdisk_table_get_nents(tb), fdisk_table_get_nents(base));
+
+	while (fdisk_diff_tables(base, tb, &itr, &pa, &change) == 0) {
+		/* kept partition, check type, name and UUID */
+		if (org && (change == FDISK_DIFF_UNCHANGED || change == FDISK_DIFF_RESIZED)) {
+			struct fdisk_partition *o = fdisk_table_get_partition_by_partno(org, pa->partno),
+					       *n = fdisk_table_get_partition_by_partno(tb, pa->partno);
+
+			if (o && n && o->start == n->start && partition_ids_differ(o, n))
+				rc = add_to_partitions_array(&chg, n, &nchgs, nparts);
+			if (rc != 0)
+				goto done;
+		}
 		switch (change) {
+		case FDISK_DIFF_UNCHANGED:
+			nsame++;
+			break;
 		case FDISK_DIFF_REMOVED:
 			rc = add_to_partitions_array(&rem, pa, &nrems, nparts);
 			break;
@@ -932,7 +1186,12 @@ int fdisk_reread_changes(struct fdisk_context *cxt, struct fdisk_table *org)
 			rc = add_to_partitions_array(&add, pa, &nadds, nparts);
 			break;
 		case FDISK_DIFF_RESIZED:
-			rc = add_to_partitions_array(&upd, pa, &nupds, nparts);
+			/* kernel uses 1 or 2 sectors for DOS extended
+			 * partition, the size is irrelevant */
+			if (fdisk_is_label(cxt, DOS) && fdisk_partition_is_container(pa))
+				nsame++;
+			else
+				rc = add_to_partitions_array(&upd, pa, &nupds, nparts);
 			break;
 		case FDISK_DIFF_MOVED:
 			rc = add_to_partitions_array(&rem, pa, &nrems, nparts);
@@ -949,17 +1208,15 @@ int fdisk_reread_changes(struct fdisk_context *cxt, struct fdisk_table *org)
 
 	for (i = 0; i < nrems; i++) {
 		pa = rem[i];
-		DBG(PART, ul_debugobj(pa, "#%zu calling BLKPG_DEL_PARTITION", pa->partno));
-		if (partx_del_partition(cxt->dev_fd, pa->partno + 1) != 0) {
+		if (blkpg_sync_partition(cxt, BLKPG_SYNC_DEL, pa->partno + 1, 0, 0) != 0) {
 			fdisk_warn(cxt, _("Failed to remove partition %zu from system"), pa->partno + 1);
 			err++;
 		}
 	}
 	for (i = 0; i < nupds; i++) {
 		pa = upd[i];
-		DBG(PART, ul_debugobj(pa, "#%zu calling BLKPG_RESIZE_PARTITION", pa->partno));
-		if (partx_resize_partition(cxt->dev_fd, pa->partno + 1,
-					   pa->start * ssf, pa->size * ssf) != 0) {
+		if (blkpg_sync_partition(cxt, BLKPG_SYNC_RESIZE, pa->partno + 1,
+					 pa->start * ssf, pa->size * ssf) != 0) {
 			fdisk_warn(cxt, _("Failed to update system information about partition %zu"), pa->partno + 1);
 			err++;
 		}
@@ -970,20 +1227,27 @@ int fdisk_reread_changes(struct fdisk_context *cxt, struct fdisk_table *org)
 		pa = add[i];
 		sz = pa->size * ssf;
 
-		DBG(PART, ul_debugobj(pa, "#%zu calling BLKPG_ADD_PARTITION", pa->partno));
-
 		if (fdisk_is_label(cxt, DOS) && fdisk_partition_is_container(pa))
 			/* Let's follow the Linux kernel and reduce
                          * DOS extended partition to 1 or 2 sectors.
 			 */
 			sz = min(sz, (uint64_t) 2);
 
-		if (partx_add_partition(cxt->dev_fd, pa->partno + 1,
-					pa->start * ssf, sz) != 0) {
+		if (blkpg_sync_partition(cxt, BLKPG_SYNC_ADD, pa->partno + 1,
+					 pa->start * ssf, sz) != 0) {
 			fdisk_warn(cxt, _("Failed to add partition %zu to system"), pa->partno + 1);
 			err++;
 		}
 	}
+
+	send_change_uevents(cxt, chg, nchgs);
+
+	gettime_monotonic(&end);
+	timersub(&end, &start, &diff);
+	DBG(CXT, ul_debugobj(cxt, "changes synced [removed=%zu, resized=%zu, added=%zu, "
+				  "unchanged=%zu, relabeled=%zu, failed=%d]: %ld usec",
+			nrems, nupds, nadds, nsame, nchgs, err,
+			(long) (diff.tv_sec * 1000000 + diff.tv_usec)));
 	if (err)
 		fdisk_info(cxt,	_(
 			"The kernel still uses the old partitions. The new "
@@ -992,7 +1256,9 @@ done:
 	free(rem);
 	free(add);
 	free(upd);
+	free(chg);
 	fdisk_unref_table(tb);
+	fdisk_unref_table(kern);
 	return rc;
 }
 #else
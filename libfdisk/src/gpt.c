@@ -173,6 +173,8 @@ static const struct fdisk_shortcut gpt_parttype_cuts[] =
 #define gpt_partition_start(_e)		le64_to_cpu((_e)->lba_start)
 #define gpt_partition_end(_e)		le64_to_cpu((_e)->lba_end)
 
+struct gpt_layout;
+
 /*
  * in-memory fdisk GPT stuff
  */
@@ -185,8 +187,18 @@ struct fdisk_gpt_label {
 
 	unsigned char *ents;			/* entries (partitions) */
 
+	/* entries as stored on disk in both primary and backup arrays, used to
+	 * write only modified sectors, see gpt_write_partitions() */
+	unsigned char *ondisk_ents;
+	size_t ondisk_esz;
+	uint64_t ondisk_plba;			/* primary entries LBA */
+	uint64_t ondisk_blba;			/* backup entries LBA */
+
 	unsigned int no_relocate :1,		/* do not fix backup location */
-		     minimize :1;
+		     minimize :1,
+		     crc_stale :1;		/* CRCs not updated after change */
+
+	struct gpt_layout *layout;		/* sorted partitions, see gpt_get_layout() */
 };
 
 static void gpt_deinit(struct fdisk_label *lb);
@@ -1085,6 +1097,31 @@ static void gpt_recompute_crc(struct gpt_header *header, unsigned char *ents)
 	header->crc32 = cpu_to_le32( gpt_header_count_crc32(header) );
 }
 
+static void gpt_free_layout(struct gpt_layout *ly);
+
+/*
+ * Marks CRCs of both headers and the layout as out of date. The CRCs are
+ * recomputed by gpt_update_crc() when needed (verify and write) rather than
+ * after every change, because the whole entries array is checksummed.
+ */
+static void gpt_mark_modified(struct fdisk_gpt_label *gpt)
+{
+	gpt->crc_stale = 1;
+
+	gpt_free_layout(gpt->layout);
+	gpt->layout = NULL;
+}
+
+static void gpt_update_crc(struct fdisk_gpt_label *gpt)
+{
+	if (!gpt->crc_stale)
+		return;
+
+	gpt_recompute_crc(gpt->pheader, gpt->ents);
+	gpt_recompute_crc(gpt->bheader, gpt->ents);
+	gpt->crc_stale = 0;
+}
+
 /*
  * Compute the 32bit CRC checksum of the partition table header.
  * Returns 1 if it is valid, otherwise 0.
@@ -1415,94 +1452,255 @@ static uint32_t check_start_after_end_partitions(struct fdisk_gpt_label *gpt)
 }
 
 /*
- * Check if partition e1 overlaps with partition e2.
+ * The layout of the used entries. The free space is searched in sorted arrays
+ * rather than by scanning all entries (again and again), so the searches are
+ * O(log n) and the layout is built only once for all the searches.
  */
-static inline int partition_overlap(struct gpt_entry *e1, struct gpt_entry *e2)
+struct gpt_layout_seg {
+	uint64_t start;
+	uint64_t end;
+	size_t	 partno;
+};
+
+struct gpt_layout {
+	uint64_t fu;			/* first usable LBA */
+	uint64_t lu;			/* last usable LBA */
+
+	uint64_t *starts;		/* sorted partitions starts */
+	size_t	 nstarts;
+
+	struct gpt_layout_seg *segs;	/* sorted used areas (merged partitions) */
+	size_t	 nsegs;
+};
+
+static int cmp_layout_seg(const void *a, const void *b)
 {
-	uint64_t start1 = gpt_partition_start(e1);
-	uint64_t end1   = gpt_partition_end(e1);
-	uint64_t start2 = gpt_partition_start(e2);
-	uint64_t end2   = gpt_partition_end(e2);
+	const struct gpt_layout_seg *x = (const struct gpt_layout_seg *) a,
+				    *y = (const struct gpt_layout_seg *) b;
 
-	return (start1 && start2 && (start1 <= end2) != (end1 < start2));
+	if (x->start != y->start)
+		return x->start < y->start ? -1 : 1;
+	return x->partno < y->partno ? -1 : x->partno > y->partno ? 1 : 0;
 }
 
 /*
- * Find any partitions that overlap.
+ * Returns used partitions sorted by start, the partitions with invalid range
+ * are ignored.
  */
-static uint32_t check_overlap_partitions(struct fdisk_gpt_label *gpt)
+static struct gpt_layout_seg *gpt_sorted_partitions(struct fdisk_gpt_label *gpt,
+						    size_t *nsegs)
 {
-	size_t i, j;
+	struct gpt_layout_seg *segs;
+	size_t i, n = 0;
+
+	segs = malloc(max(gpt_get_nentries(gpt), (size_t) 1) * sizeof(*segs));
+	if (!segs)
+		return NULL;
+
+	for (i = 0; i < gpt_get_nentries(gpt); i++) {
+		struct gpt_entry *e = gpt_get_entry(gpt, i);
+
+		if (!gpt_entry_is_used(e) || !gpt_partition_start(e)
+		    || gpt_partition_end(e) < gpt_partition_start(e))
+			continue;
+		segs[n].start = gpt_partition_start(e);
+		segs[n].end = gpt_partition_end(e);
+		segs[n].partno = i;
+		n++;
+	}
+
+	qsort(segs, n, sizeof(*segs), cmp_layout_seg);
+	*nsegs = n;
+	return segs;
+}
+
+static void gpt_free_layout(struct gpt_layout *ly)
+{
+	if (!ly)
+		return;
+	free(ly->starts);
+	free(ly->segs);
+	free(ly);
+}
+
+/*
+ * Returns the layout of the current entries. The layout is kept until the
+ * entries are modified, see gpt_mark_modified().
+ */
+static struct gpt_layout *gpt_get_layout(struct fdisk_gpt_label *gpt)
+{
+	struct gpt_layout *ly = gpt->layout;
+	size_t i, n = 0;
 
 	assert(gpt);
 	assert(gpt->pheader);
 	assert(gpt->ents);
 
-	for (i = 0; i < gpt_get_nentries(gpt); i++)
-		for (j = 0; j < i; j++) {
-			struct gpt_entry *ei = gpt_get_entry(gpt, i);
-			struct gpt_entry *ej = gpt_get_entry(gpt, j);
+	if (ly)
+		goto done;
 
-			if (!gpt_entry_is_used(ei) || !gpt_entry_is_used(ej))
-				continue;
-			if (partition_overlap(ei, ej)) {
-				DBG(GPT, ul_debug("partitions overlap detected [%zu vs. %zu]", i, j));
-				return i + 1;
-			}
-		}
+	ly = calloc(1, sizeof(*ly));
+	if (!ly)
+		return NULL;
 
-	return 0;
+	ly->segs = gpt_sorted_partitions(gpt, &n);
+	ly->starts = malloc(max(gpt_get_nentries(gpt), (size_t) 1) * sizeof(uint64_t));
+	if (!ly->segs || !ly->starts) {
+		gpt_free_layout(ly);
+		return NULL;
+	}
+
+	for (i = 0; i < n; i++)
+		ly->starts[i] = ly->segs[i].start;
+	ly->nstarts = n;
+
+	/* merge overlapping and adjacent partitions to the used areas */
+	for (i = 0; i < n; i++) {
+		struct gpt_layout_seg *last = ly->nsegs ? &ly->segs[ly->nsegs - 1] : NULL;
+
+		if (last && ly->segs[i].start <= last->end + 1) {
+			if (ly->segs[i].end > last->end)
+				last->end = ly->segs[i].end;
+		} else
+			ly->segs[ly->nsegs++] = ly->segs[i];
+	}
+
+	DBG(GPT, ul_debug("new layout: %zu partitions, %zu used areas", ly->nstarts, ly->nsegs));
+	gpt->layout = ly;
+done:
+	/* the usable area is not part of the entries */
+	ly->fu = le64_to_cpu(gpt->pheader->first_usable_lba);
+	ly->lu = le64_to_cpu(gpt->pheader->last_usable_lba);
+	return ly;
+}
+
+/* returns index of the first used area which ends at or behind @lba */
+static size_t layout_find_seg(const struct gpt_layout *ly, uint64_t lba)
+{
+	size_t lo = 0, hi = ly->nsegs;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (ly->segs[mid].end < lba)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* returns index of the first partition which starts behind @lba */
+static size_t layout_find_start(const struct gpt_layout *ly, uint64_t lba)
+{
+	size_t lo = 0, hi = ly->nstarts;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (ly->starts[mid] <= lba)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
 }
 
 /*
- * Find the first available block after the starting point; returns 0 if
- * there are no available blocks left, or error. From gdisk.
+ * Adds a new partition to the layout, the arrays are allocated for all
+ * entries, so there is always space for the partition.
  */
-static uint64_t find_first_available(struct fdisk_gpt_label *gpt, uint64_t start)
+static void layout_add_partition(struct gpt_layout *ly, uint64_t start, uint64_t end)
 {
-	int first_moved = 0;
-	uint64_t first;
-	uint64_t fu, lu;
+	size_t i, j;
+
+	/* insert to the starts */
+	i = layout_find_start(ly, start);
+	memmove(&ly->starts[i + 1], &ly->starts[i],
+			(ly->nstarts - i) * sizeof(uint64_t));
+	ly->starts[i] = start;
+	ly->nstarts++;
+
+	/* the used areas <i, j) overlap or are adjacent to the partition */
+	i = layout_find_seg(ly, start ? start - 1 : 0);
+	for (j = i; j < ly->nsegs && ly->segs[j].start <= end + 1; j++);
+
+	if (i == j) {
+		memmove(&ly->segs[i + 1], &ly->segs[i],
+				(ly->nsegs - i) * sizeof(struct gpt_layout_seg));
+		ly->nsegs++;
+	} else {
+		start = min(start, ly->segs[i].start);
+		end = max(end, ly->segs[j - 1].end);
+
+		memmove(&ly->segs[i + 1], &ly->segs[j],
+				(ly->nsegs - j) * sizeof(struct gpt_layout_seg));
+		ly->nsegs -= j - i - 1;
+	}
+	ly->segs[i].start = start;
+	ly->segs[i].end = end;
+}
+
+/*
+ * Find any partitions that overlap. Returns the partition number and the
+ * number of the overlapping partition in @other.
+ */
+static uint32_t check_overlap_partitions(struct fdisk_gpt_label *gpt, uint32_t *other)
+{
+	struct gpt_layout_seg *segs, *prev = NULL;
+	size_t i, n = 0;
+	uint32_t rc = 0;
 
 	assert(gpt);
 	assert(gpt->pheader);
 	assert(gpt->ents);
 
-	fu = le64_to_cpu(gpt->pheader->first_usable_lba);
-	lu = le64_to_cpu(gpt->pheader->last_usable_lba);
+	segs = gpt_sorted_partitions(gpt, &n);
+	if (!segs)
+		return 0;
+
+	/* @prev is the partition with the highest end */
+	for (i = 0; i < n; i++) {
+		if (prev && segs[i].start <= prev->end) {
+			DBG(GPT, ul_debug("partitions overlap detected [%zu vs. %zu]",
+					prev->partno, segs[i].partno));
+			rc = max(prev->partno, segs[i].partno) + 1;
+			if (other)
+				*other = min(prev->partno, segs[i].partno) + 1;
+			break;
+		}
+		if (!prev || segs[i].end > prev->end)
+			prev = &segs[i];
+	}
+
+	free(segs);
+	return rc;
+}
+
+/*
+ * Find the first available block after the starting point; returns 0 if
+ * there are no available blocks left, or error. From gdisk.
+ */
+static uint64_t find_first_available(const struct gpt_layout *ly, uint64_t start)
+{
+	uint64_t first;
+	size_t i;
 
 	/*
 	 * Begin from the specified starting point or from the first usable
 	 * LBA, whichever is greater...
 	 */
-	first = start < fu ? fu : start;
+	first = start < ly->fu ? ly->fu : start;
 
 	/*
-	 * Now search through all partitions; if first is within an
-	 * existing partition, move it to the next sector after that
-	 * partition and repeat. If first was moved, set firstMoved
-	 * flag; repeat until firstMoved is not set, so as to catch
-	 * cases where partitions are out of sequential order....
+	 * ...and if first is within an used area, move it to the next sector
+	 * after the area. The areas are merged, so the sector is free.
 	 */
-	do {
-		size_t i;
-
-		first_moved = 0;
-		for (i = 0; i < gpt_get_nentries(gpt); i++) {
-			struct gpt_entry *e = gpt_get_entry(gpt, i);
-
-			if (!gpt_entry_is_used(e))
-				continue;
-			if (first < gpt_partition_start(e))
-				continue;
-			if (first <= gpt_partition_end(e)) {
-				first = gpt_partition_end(e) + 1;
-				first_moved = 1;
-			}
-		}
-	} while (first_moved == 1);
+	i = layout_find_seg(ly, first);
+	if (i < ly->nsegs && ly->segs[i].start <= first)
+		first = ly->segs[i].end + 1;
 
-	if (first > lu)
+	if (first > ly->lu)
 		first = 0;
 
 	return first;
@@ -1510,54 +1708,26 @@ static uint64_t find_first_available(struct fdisk_gpt_label *gpt, uint64_t start
 
 
 /* Returns last available sector in the free space pointed to by start. From gdisk. */
-static uint64_t find_last_free(struct fdisk_gpt_label *gpt, uint64_t start)
+static uint64_t find_last_free(const struct gpt_layout *ly, uint64_t start)
 {
-	size_t i;
-	uint64_t nearest_start;
-
-	assert(gpt);
-	assert(gpt->pheader);
-	assert(gpt->ents);
+	/* the nearest partition start behind @start */
+	size_t i = layout_find_start(ly, start);
 
-	nearest_start = le64_to_cpu(gpt->pheader->last_usable_lba);
+	if (i < ly->nstarts && ly->starts[i] < ly->lu)
+		return ly->starts[i] - 1ULL;
 
-	for (i = 0; i < gpt_get_nentries(gpt); i++) {
-		struct gpt_entry *e = gpt_get_entry(gpt, i);
-		uint64_t ps = gpt_partition_start(e);
-
-		if (nearest_start > ps && ps > start)
-			nearest_start = ps - 1ULL;
-	}
-
-	return nearest_start;
+	return ly->lu;
 }
 
 /* Returns the last free sector on the disk. From gdisk. */
-static uint64_t find_last_free_sector(struct fdisk_gpt_label *gpt)
+static uint64_t find_last_free_sector(const struct gpt_layout *ly)
 {
-	int last_moved;
-	uint64_t last = 0;
-
-	assert(gpt);
-	assert(gpt->pheader);
-	assert(gpt->ents);
-
 	/* start by assuming the last usable LBA is available */
-	last = le64_to_cpu(gpt->pheader->last_usable_lba);
-	do {
-		size_t i;
+	uint64_t last = ly->lu;
+	size_t i = layout_find_seg(ly, last);
 
-		last_moved = 0;
-		for (i = 0; i < gpt_get_nentries(gpt); i++) {
-			struct gpt_entry *e = gpt_get_entry(gpt, i);
-
-			if (last >= gpt_partition_start(e) &&
-			    last <= gpt_partition_end(e)) {
-				last = gpt_partition_start(e) - 1ULL;
-				last_moved = 1;
-			}
-		}
-	} while (last_moved == 1);
+	if (i < ly->nsegs && ly->segs[i].start <= last)
+		last = ly->segs[i].start - 1ULL;
 
 	return last;
 }
@@ -1567,19 +1737,15 @@ static uint64_t find_last_free_sector(struct fdisk_gpt_label *gpt)
  * space on the disk. Returns 0 if there are no available blocks left.
  * From gdisk.
  */
-static uint64_t find_first_in_largest(struct fdisk_gpt_label *gpt)
+static uint64_t find_first_in_largest(const struct gpt_layout *ly)
 {
 	uint64_t start = 0, first_sect, last_sect;
 	uint64_t segment_size, selected_size = 0, selected_segment = 0;
 
-	assert(gpt);
-	assert(gpt->pheader);
-	assert(gpt->ents);
-
 	do {
-		first_sect = find_first_available(gpt, start);
+		first_sect = find_first_available(ly, start);
 		if (first_sect != 0) {
-			last_sect = find_last_free(gpt, first_sect);
+			last_sect = find_last_free(ly, first_sect);
 			segment_size = last_sect - first_sect + 1ULL;
 
 			if (segment_size > selected_size) {
@@ -1598,7 +1764,7 @@ static uint64_t find_first_in_largest(struct fdisk_gpt_label *gpt)
  * they reside, and the size of the largest of those segments. From gdisk.
  */
 static uint64_t get_free_sectors(struct fdisk_context *cxt,
-				 struct fdisk_gpt_label *gpt,
+				 const struct gpt_layout *ly,
 				 uint32_t *nsegments,
 				 uint64_t *largest_segment)
 {
@@ -1610,14 +1776,10 @@ static uint64_t get_free_sectors(struct fdisk_context *cxt,
 	if (!cxt->total_sectors)
 		goto done;
 
-	assert(gpt);
-	assert(gpt->pheader);
-	assert(gpt->ents);
-
 	do {
-		first_sect = find_first_available(gpt, start);
+		first_sect = find_first_available(ly, start);
 		if (first_sect) {
-			last_sect = find_last_free(gpt, first_sect);
+			last_sect = find_last_free(ly, first_sect);
 			segment_sz = last_sect - first_sect + 1;
 
 			if (segment_sz > largest_seg)
@@ -1637,10 +1799,35 @@ done:
 	return totfound;
 }
 
+/*
+ * Remembers the current entries as the on-disk content of both primary and
+ * backup entries arrays.
+ */
+static void gpt_set_ondisk_entries(struct fdisk_gpt_label *gpt)
+{
+	size_t esz = 0;
+
+	free(gpt->ondisk_ents);
+	gpt->ondisk_ents = NULL;
+	gpt->ondisk_esz = 0;
+
+	if (gpt_sizeof_entries(gpt->pheader, &esz) != 0)
+		return;
+	gpt->ondisk_ents = malloc(esz);
+	if (!gpt->ondisk_ents)
+		return;
+
+	memcpy(gpt->ondisk_ents, gpt->ents, esz);
+	gpt->ondisk_esz = esz;
+	gpt->ondisk_plba = le64_to_cpu(gpt->pheader->partition_entry_lba);
+	gpt->ondisk_blba = le64_to_cpu(gpt->bheader->partition_entry_lba);
+}
+
 static int gpt_probe_label(struct fdisk_context *cxt)
 {
 	int mbr_type;
 	struct fdisk_gpt_label *gpt;
+	unsigned char *bents = NULL;
 
 	assert(cxt);
 	assert(cxt->label);
@@ -1662,7 +1849,7 @@ static int gpt_probe_label(struct fdisk_context *cxt)
 		/* primary OK, try backup from alternative LBA */
 		gpt->bheader = gpt_read_header(cxt,
 					le64_to_cpu(gpt->pheader->alternative_lba),
-					NULL);
+					&bents);
 	else
 		/* primary corrupted -- try last LBA */
 		gpt->bheader = gpt_read_header(cxt, last_lba(cxt), &gpt->ents);
@@ -1670,6 +1857,18 @@ static int gpt_probe_label(struct fdisk_context *cxt)
 	if (!gpt->pheader && !gpt->bheader)
 		goto failed;
 
+	/* both arrays are the same on disk, later write may skip unmodified sectors */
+	if (gpt->pheader && gpt->bheader && bents) {
+		size_t pesz = 0, besz = 0;
+
+		if (gpt_sizeof_entries(gpt->pheader, &pesz) == 0
+		    && gpt_sizeof_entries(gpt->bheader, &besz) == 0
+		    && pesz == besz && memcmp(gpt->ents, bents, pesz) == 0)
+			gpt_set_ondisk_entries(gpt);
+	}
+	free(bents);
+	bents = NULL;
+
 	/* primary OK, backup corrupted -- recovery */
 	if (gpt->pheader && !gpt->bheader) {
 		fdisk_warnx(cxt, _("The backup GPT table is corrupt, but the "
@@ -1720,6 +1919,7 @@ static int gpt_probe_label(struct fdisk_context *cxt)
 	return 1;
 failed:
 	DBG(GPT, ul_debug("probe failed"));
+	free(bents);
 	gpt_deinit(cxt->label);
 	return 0;
 }
@@ -2017,14 +2217,14 @@ static int gpt_set_partition(struct fdisk_context *cxt, size_t n,
 		}
 		e->lba_end = cpu_to_le64(end);
 	}
-	gpt_recompute_crc(gpt->pheader, gpt->ents);
-	gpt_recompute_crc(gpt->bheader, gpt->ents);
+	gpt_mark_modified(gpt);
 
 	fdisk_label_set_changed(cxt->label, 1);
 	return rc;
 }
 
-static int gpt_write(struct fdisk_context *cxt, off_t offset, void *buf, size_t count)
+static int gpt_write_nosync(struct fdisk_context *cxt, off_t offset,
+			    const void *buf, size_t count)
 {
 	if (offset != lseek(cxt->dev_fd, offset, SEEK_SET))
 		return -errno;
@@ -2032,30 +2232,66 @@ static int gpt_write(struct fdisk_context *cxt, off_t offset, void *buf, size_t
 	if (write_all(cxt->dev_fd, buf, count))
 		return -errno;
 
-	fsync(cxt->dev_fd);
-
 	DBG(GPT, ul_debug("  write OK [offset=%zu, size=%zu]",
 				(size_t) offset, count));
 	return 0;
 }
 
+static int gpt_write(struct fdisk_context *cxt, off_t offset, void *buf, size_t count)
+{
+	int rc = gpt_write_nosync(cxt, offset, buf, count);
+
+	if (!rc)
+		fsync(cxt->dev_fd);
+	return rc;
+}
+
 /*
- * Write partitions.
+ * Write partitions. If @old (the current on-disk entries) is specified, only
+ * the sectors that differ from @old are written.
+ *
  * Returns 0 on success, or corresponding error otherwise.
  */
 static int gpt_write_partitions(struct fdisk_context *cxt,
-				struct gpt_header *header, unsigned char *ents)
+				struct gpt_header *header, unsigned char *ents,
+				const unsigned char *old)
 {
-	size_t esz = 0;
+	size_t esz = 0, ssz = cxt->sector_size, off = 0;
+	off_t start;
 	int rc;
 
 	rc = gpt_sizeof_entries(header, &esz);
 	if (rc)
 		return rc;
 
-	return gpt_write(cxt,
-			(off_t) le64_to_cpu(header->partition_entry_lba) * cxt->sector_size,
-			ents, esz);
+	start = (off_t) le64_to_cpu(header->partition_entry_lba) * ssz;
+	if (!old)
+		return gpt_write(cxt, start, ents, esz);
+
+	while (off < esz) {
+		size_t end;
+
+		/* skip unmodified sectors */
+		while (off < esz && memcmp(ents + off, old + off, min(ssz, esz - off)) == 0)
+			off += ssz;
+		if (off >= esz)
+			break;
+
+		/* write all modified sectors at once */
+		end = off;
+		while (end < esz && memcmp(ents + end, old + end, min(ssz, esz - end)) != 0)
+			end += ssz;
+		if (end > esz)
+			end = esz;
+
+		rc = gpt_write_nosync(cxt, start + off, ents + off, end - off);
+		if (rc)
+			return rc;
+		off = end;
+	}
+
+	fsync(cxt->dev_fd);
+	return 0;
 }
 
 /*
@@ -2120,6 +2356,8 @@ static int gpt_write_pmbr(struct fdisk_context *cxt)
 static int gpt_write_disklabel(struct fdisk_context *cxt)
 {
 	struct fdisk_gpt_label *gpt;
+	unsigned char *old = NULL;
+	size_t esz = 0;
 	int mbr_type;
 
 	assert(cxt);
@@ -2139,7 +2377,7 @@ static int gpt_write_disklabel(struct fdisk_context *cxt)
 	if (le64_to_cpu(gpt->pheader->alternative_lba) < cxt->total_sectors - 1ULL)
 		goto err0;
 
-	if (check_overlap_partitions(gpt))
+	if (check_overlap_partitions(gpt, NULL))
 		goto err0;
 
 	if (gpt->minimize)
@@ -2148,6 +2386,17 @@ static int gpt_write_disklabel(struct fdisk_context *cxt)
 	/* recompute CRCs for both headers */
 	gpt_recompute_crc(gpt->pheader, gpt->ents);
 	gpt_recompute_crc(gpt->bheader, gpt->ents);
+	gpt->crc_stale = 0;
+
+	/* write only modified entries if the arrays are still on the same place */
+	if (gpt->ondisk_ents
+	    && gpt_sizeof_entries(gpt->pheader, &esz) == 0
+	    && esz == gpt->ondisk_esz
+	    && le64_to_cpu(gpt->pheader->partition_entry_lba) == gpt->ondisk_plba
+	    && le64_to_cpu(gpt->bheader->partition_entry_lba) == gpt->ondisk_blba)
+		old = gpt->ondisk_ents;
+
+	DBG(GPT, ul_debug(" entries: %s", old ? "modified only" : "all"));
 
 	/*
 	 * UEFI requires writing in this specific order:
@@ -2159,12 +2408,12 @@ static int gpt_write_disklabel(struct fdisk_context *cxt)
 	 *
 	 * If any write fails, we abort the rest.
 	 */
-	if (gpt_write_partitions(cxt, gpt->bheader, gpt->ents) != 0)
+	if (gpt_write_partitions(cxt, gpt->bheader, gpt->ents, old) != 0)
 		goto err1;
 	if (gpt_write_header(cxt, gpt->bheader,
 			     le64_to_cpu(gpt->pheader->alternative_lba)) != 0)
 		goto err1;
-	if (gpt_write_partitions(cxt, gpt->pheader, gpt->ents) != 0)
+	if (gpt_write_partitions(cxt, gpt->pheader, gpt->ents, old) != 0)
 		goto err1;
 	if (gpt_write_header(cxt, gpt->pheader, GPT_PRIMARY_PARTITION_TABLE_LBA) != 0)
 		goto err1;
@@ -2174,6 +2423,8 @@ static int gpt_write_disklabel(struct fdisk_context *cxt)
 	else if (gpt_write_pmbr(cxt) != 0)
 		goto err1;
 
+	gpt_set_ondisk_entries(gpt);
+
 	DBG(GPT, ul_debug("...write success"));
 	return 0;
 err0:
@@ -2193,7 +2444,7 @@ err1:
 static int gpt_verify_disklabel(struct fdisk_context *cxt)
 {
 	int nerror = 0;
-	unsigned int ptnum;
+	uint32_t ptnum, ptnum2 = 0;
 	struct fdisk_gpt_label *gpt;
 
 	assert(cxt);
@@ -2204,6 +2455,8 @@ static int gpt_verify_disklabel(struct fdisk_context *cxt)
 	if (!gpt)
 		return -EINVAL;
 
+	gpt_update_crc(gpt);
+
 	if (!gpt->bheader) {
 		nerror++;
 		fdisk_warnx(cxt, _("Disk does not contain a valid backup header."));
@@ -2256,11 +2509,11 @@ static int gpt_verify_disklabel(struct fdisk_context *cxt)
 		fdisk_warnx(cxt, _("Primary and backup header mismatch."));
 	}
 
-	ptnum = check_overlap_partitions(gpt);
+	ptnum = check_overlap_partitions(gpt, &ptnum2);
 	if (ptnum) {
 		nerror++;
 		fdisk_warnx(cxt, _("Partition %u overlaps with partition %u."),
-				ptnum, ptnum+1);
+				ptnum2, ptnum);
 	}
 
 	ptnum = check_too_big_partitions(gpt, cxt->total_sectors);
@@ -2288,7 +2541,10 @@ static int gpt_verify_disklabel(struct fdisk_context *cxt)
 		       partitions_in_use(gpt),
 		       gpt_get_nentries(gpt));
 
-		free_sectors = get_free_sectors(cxt, gpt, &nsegments, &largest_segment);
+		struct gpt_layout *ly = gpt_get_layout(gpt);
+
+		if (ly)
+			free_sectors = get_free_sectors(cxt, ly, &nsegments, &largest_segment);
 		if (largest_segment)
 			strsz = size_to_human_string(SIZE_SUFFIX_SPACE | SIZE_SUFFIX_3LETTER,
 					largest_segment * cxt->sector_size);
@@ -2329,8 +2585,7 @@ static int gpt_delete_partition(struct fdisk_context *cxt,
 	/* hasta la vista, baby! */
 	gpt_zeroize_entry(gpt, partnum);
 
-	gpt_recompute_crc(gpt->pheader, gpt->ents);
-	gpt_recompute_crc(gpt->bheader, gpt->ents);
+	gpt_mark_modified(gpt);
 	cxt->label->nparts_cur--;
 	fdisk_label_set_changed(cxt->label, 1);
 
@@ -2352,6 +2607,7 @@ static int gpt_add_partition(
 	struct gpt_header *pheader;
 	struct gpt_entry *e;
 	struct fdisk_ask *ask = NULL;
+	struct gpt_layout *ly;
 	size_t partnum;
 	int rc;
 
@@ -2384,18 +2640,24 @@ static int gpt_add_partition(
 		fdisk_warnx(cxt, _("All partitions are already in use."));
 		return -ENOSPC;
 	}
-	if (!get_free_sectors(cxt, gpt, NULL, NULL)) {
+
+	ly = gpt_get_layout(gpt);
+	if (!ly)
+		return -ENOMEM;
+
+	if (!get_free_sectors(cxt, ly, NULL, NULL)) {
 		fdisk_warnx(cxt, _("No free sectors available."));
-		return -ENOSPC;
+		rc = -ENOSPC;
+		goto done;
 	}
 
 	rc = string_to_guid(pa && pa->type && pa->type->typestr ?
 				pa->type->typestr:
 				GPT_DEFAULT_ENTRY_TYPE, &typeid);
 	if (rc)
-		return rc;
+		goto done;
 
-	disk_f = find_first_available(gpt, le64_to_cpu(pheader->first_usable_lba));
+	disk_f = find_first_available(ly, le64_to_cpu(pheader->first_usable_lba));
 	e = gpt_get_entry(gpt, 0);
 
 	/* if first sector no explicitly defined then ignore small gaps before
@@ -2407,10 +2669,10 @@ static int gpt_add_partition(
 		do {
 			uint64_t x;
 			DBG(GPT, ul_debug("testing first sector %"PRIu64"", disk_f));
-			disk_f = find_first_available(gpt, disk_f);
+			disk_f = find_first_available(ly, disk_f);
 			if (!disk_f)
 				break;
-			x = find_last_free(gpt, disk_f);
+			x = find_last_free(ly, disk_f);
 			if (x - disk_f >= cxt->grain / cxt->sector_size)
 				break;
 			DBG(GPT, ul_debug("first sector %"PRIu64" addresses to small space, continue...", disk_f));
@@ -2418,22 +2680,23 @@ static int gpt_add_partition(
 		} while(1);
 
 		if (disk_f == 0)
-			disk_f = find_first_available(gpt, le64_to_cpu(pheader->first_usable_lba));
+			disk_f = find_first_available(ly, le64_to_cpu(pheader->first_usable_lba));
 	}
 
 	e = NULL;
-	disk_l = find_last_free_sector(gpt);
+	disk_l = find_last_free_sector(ly);
 
 	/* the default is the largest free space */
-	dflt_f = find_first_in_largest(gpt);
-	dflt_l = find_last_free(gpt, dflt_f);
+	dflt_f = find_first_in_largest(ly);
+	dflt_l = find_last_free(ly, dflt_f);
 
 	/* don't offer too small free space by default, this is possible to
 	 * bypass by sfdisk script */
 	if ((!pa || !fdisk_partition_has_start(pa))
 	    && dflt_l - dflt_f + 1 < cxt->grain / cxt->sector_size) {
 		fdisk_warnx(cxt, _("No enough free sectors available."));
-		return -ENOSPC;
+		rc = -ENOSPC;
+		goto done;
 	}
 
 	/* align the default in range <dflt_f,dflt_l>*/
@@ -2445,9 +2708,10 @@ static int gpt_add_partition(
 
 	} else if (pa && fdisk_partition_has_start(pa)) {
 		DBG(GPT, ul_debug("first sector defined: %ju",  (uintmax_t)pa->start));
-		if (pa->start != find_first_available(gpt, pa->start)) {
+		if (pa->start != find_first_available(ly, pa->start)) {
 			fdisk_warnx(cxt, _("Sector %ju already used."),  (uintmax_t)pa->start);
-			return -ERANGE;
+			rc = -ERANGE;
+			goto done;
 		}
 		user_f = pa->start;
 	} else {
@@ -2457,8 +2721,10 @@ static int gpt_add_partition(
 				ask = fdisk_new_ask();
 			else
 				fdisk_reset_ask(ask);
-			if (!ask)
-				return -ENOMEM;
+			if (!ask) {
+				rc = -ENOMEM;
+				goto done;
+			}
 
 			/* First sector */
 			fdisk_ask_set_query(ask, _("First sector"));
@@ -2472,7 +2738,7 @@ static int gpt_add_partition(
 				goto done;
 
 			user_f = fdisk_ask_number_get_result(ask);
-			if (user_f != find_first_available(gpt, user_f)) {
+			if (user_f != find_first_available(ly, user_f)) {
 				fdisk_warnx(cxt, _("Sector %ju already used."), user_f);
 				continue;
 			}
@@ -2482,7 +2748,7 @@ static int gpt_add_partition(
 
 
 	/* Last sector */
-	dflt_l = max_l = find_last_free(gpt, user_f);
+	dflt_l = max_l = find_last_free(ly, user_f);
 
 	/* Make sure the last partition has aligned size by default because
 	 * range specified by LastUsableLBA may be unaligned on disks where
@@ -2515,8 +2781,10 @@ static int gpt_add_partition(
 				ask = fdisk_new_ask();
 			else
 				fdisk_reset_ask(ask);
-			if (!ask)
-				return -ENOMEM;
+			if (!ask) {
+				rc = -ENOMEM;
+				goto done;
+			}
 
 			fdisk_ask_set_query(ask, _("Last sector, +/-sectors or +/-size{K,M,G,T,P}"));
 			fdisk_ask_set_type(ask, FDISK_ASKTYPE_OFFSET);
@@ -2607,8 +2875,9 @@ static int gpt_add_partition(
 				gpt_partition_end(e),
 				gpt_partition_size(e)));
 
-	gpt_recompute_crc(gpt->pheader, gpt->ents);
-	gpt_recompute_crc(gpt->bheader, gpt->ents);
+	/* CRCs are out of date, but the layout is possible to update */
+	gpt->crc_stale = 1;
+	layout_add_partition(ly, user_f, user_l);
 
 	/* report result */
 	{
@@ -2691,8 +2960,7 @@ static int gpt_create_disklabel(struct fdisk_context *cxt)
 		rc = -ENOMEM;
 		goto done;
 	}
-	gpt_recompute_crc(gpt->pheader, gpt->ents);
-	gpt_recompute_crc(gpt->bheader, gpt->ents);
+	gpt_mark_modified(gpt);
 
 	cxt->label->nparts_max = gpt_get_nentries(gpt);
 	cxt->label->nparts_cur = 0;
@@ -2742,8 +3010,7 @@ static int gpt_set_disklabel_id(struct fdisk_context *cxt, const char *str)
 	gpt->pheader->disk_guid = uuid;
 	gpt->bheader->disk_guid = uuid;
 
-	gpt_recompute_crc(gpt->pheader, gpt->ents);
-	gpt_recompute_crc(gpt->bheader, gpt->ents);
+	gpt_mark_modified(gpt);
 
 	new = gpt_get_header_id(gpt->pheader);
 
@@ -2878,8 +3145,7 @@ int fdisk_gpt_set_npartitions(struct fdisk_context *cxt, uint32_t nents)
 	gpt_mknew_header_common(cxt, gpt->bheader, le64_to_cpu(gpt->pheader->alternative_lba));
 
 	/* CRCs will have changed */
-	gpt_recompute_crc(gpt->pheader, gpt->ents);
-	gpt_recompute_crc(gpt->bheader, gpt->ents);
+	gpt_mark_modified(gpt);
 
 	/* update library info */
 	cxt->label->nparts_max = gpt_get_nentries(gpt);
@@ -2997,8 +3263,7 @@ int fdisk_gpt_set_partition_attrs(
 	fdisk_info(cxt, _("The attributes on partition %zu changed to 0x%016" PRIx64 "."),
 			partnum + 1, attrs);
 
-	gpt_recompute_crc(gpt->pheader, gpt->ents);
-	gpt_recompute_crc(gpt->bheader, gpt->ents);
+	gpt_mark_modified(gpt);
 	fdisk_label_set_changed(cxt->label, 1);
 	return 0;
 }
@@ -3081,8 +3346,7 @@ static int gpt_toggle_partition_flag(
 			_("The %s flag on partition %zu is disabled now."),
 			name, i + 1);
 
-	gpt_recompute_crc(gpt->pheader, gpt->ents);
-	gpt_recompute_crc(gpt->bheader, gpt->ents);
+	gpt_mark_modified(gpt);
 	fdisk_label_set_changed(cxt->label, 1);
 	return 0;
 }
@@ -3128,8 +3392,7 @@ static int gpt_reorder(struct fdisk_context *cxt)
 	qsort(gpt->ents, nparts, sizeof(struct gpt_entry),
 			gpt_entry_cmp_start);
 
-	gpt_recompute_crc(gpt->pheader, gpt->ents);
-	gpt_recompute_crc(gpt->bheader, gpt->ents);
+	gpt_mark_modified(gpt);
 	fdisk_label_set_changed(cxt->label, 1);
 
 	return 0;
@@ -3177,10 +3440,17 @@ static void gpt_deinit(struct fdisk_label *lb)
 	free(gpt->ents);
 	free(gpt->pheader);
 	free(gpt->bheader);
+	free(gpt->ondisk_ents);
 
 	gpt->ents = NULL;
 	gpt->pheader = NULL;
 	gpt->bheader = NULL;
+	gpt->ondisk_ents = NULL;
+	gpt->ondisk_esz = 0;
+	gpt->crc_stale = 0;
+
+	gpt_free_layout(gpt->layout);
+	gpt->layout = NULL;
 }
 
 static const struct fdisk_label_operations gpt_operations =
@@ -3337,11 +3607,60 @@ static int test_setattr(struct fdisk_test *ts, int argc, char *argv[])
 	return 0;
 }
 
+/*
+ * Sets start and end of the partition without any check and writes the
+ * entries and headers only. It's the way to create overlapping partitions
+ * for --verify tests.
+ */
+static int test_setrange(struct fdisk_test *ts, int argc, char *argv[])
+{
+	const char *disk = argv[1];
+	size_t part = strtoul(argv[2], NULL, 0) - 1;
+	uint64_t start = strtoull(argv[3], NULL, 0),
+		 end = strtoull(argv[4], NULL, 0);
+	struct fdisk_context *cxt;
+	struct fdisk_gpt_label *gpt;
+	struct gpt_entry *e;
+	int rc = EXIT_FAILURE;
+
+	cxt = fdisk_new_context();
+	fdisk_assign_device(cxt, disk, 0);
+
+	if (!fdisk_is_label(cxt, GPT))
+		goto done;
+
+	gpt = self_label(cxt);
+	if (part >= gpt_get_nentries(gpt))
+		goto done;
+	e = gpt_get_entry(gpt, part);
+	if (!gpt_entry_is_used(e))
+		goto done;
+
+	e->lba_start = cpu_to_le64(start);
+	e->lba_end = cpu_to_le64(end);
+
+	gpt_recompute_crc(gpt->pheader, gpt->ents);
+	gpt_recompute_crc(gpt->bheader, gpt->ents);
+
+	if (gpt_write_partitions(cxt, gpt->bheader, gpt->ents, NULL) != 0
+	    || gpt_write_header(cxt, gpt->bheader,
+			le64_to_cpu(gpt->pheader->alternative_lba)) != 0
+	    || gpt_write_partitions(cxt, gpt->pheader, gpt->ents, NULL) != 0
+	    || gpt_write_header(cxt, gpt->pheader, GPT_PRIMARY_PARTITION_TABLE_LBA) != 0)
+		goto done;
+
+	rc = fdisk_deassign_device(cxt, 0) == 0 ? 0 : EXIT_FAILURE;
+done:
+	fdisk_unref_context(cxt);
+	return rc;
+}
+
 int main(int argc, char *argv[])
 {
 	struct fdisk_test tss[] = {
 		{ "--getattr",  test_getattr,  "<disk> <partition>             print attributes" },
 		{ "--setattr",  test_setattr,  "<disk> <partition> <value>     set attributes" },
+		{ "--setrange", test_setrange, "<disk> <partition> <start> <end> set range, don't check overlaps" },
 		{ NULL }
 	};
 
@@ -921,6 +921,11 @@ int mnt_context_set_fs(struct libmnt_context *cxt, struct libmnt_fs *fs)
 		return -EINVAL;
 
 	DBG(CXT, ul_debugobj(cxt, "setting new FS"));
+
+	/* the context modifies the strings in-place */
+	if (__mnt_fs_unshare_strings(fs))
+		return -ENOMEM;
+
 	mnt_ref_fs(fs);			/* new */
 	mnt_unref_fs(cxt->fs);		/* old */
 	cxt->fs = fs;
@@ -220,7 +220,7 @@ static int has_utab_entry(struct libmnt_context *cxt, const char *target)
 	if (!cxt->utab) {
 		const char *path = mnt_get_utab_path();
 
-		if (!path || is_file_empty(path))
+		if (!path || mnt_utab_is_empty(path))
 			return 0;
 		cxt->utab = mnt_new_table();
 		if (!cxt->utab)
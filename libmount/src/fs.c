@@ -63,6 +63,81 @@ void mnt_free_fs(struct libmnt_fs *fs)
 	free(fs);
 }
 
+/* Forgets strings owned by the strings pool */
+static void fs_drop_strpool(struct libmnt_fs *fs)
+{
+	if (!fs->strpool)
+		return;
+
+	fs->root = NULL;
+	fs->fstype = NULL;
+	fs->opt_fields = NULL;
+	fs->optstr = NULL;
+	fs->vfs_optstr = NULL;
+	fs->fs_optstr = NULL;
+
+	mnt_unref_strpool(fs->strpool);
+	fs->strpool = NULL;
+}
+
+static int strdup_from_strpool(char **str)
+{
+	if (*str) {
+		*str = strdup(*str);
+		if (!*str)
+			return -ENOMEM;
+	}
+	return 0;
+}
+
+/*
+ * Copy-on-write for strings from the strings pool (see strpool.c). This
+ * function has to be called before @fs strings are modified or deallocated.
+ * All strings are converted to private copies.
+ *
+ * Returns: 0 on success or negative number in case of error.
+ */
+int __mnt_fs_unshare_strings(struct libmnt_fs *fs)
+{
+	struct libmnt_fs x;
+
+	if (!fs || !fs->strpool)
+		return 0;
+
+	DBG(FS, ul_debugobj(fs, "unshare strings"));
+
+	x = *fs;
+	if (strdup_from_strpool(&x.root) ||
+	    strdup_from_strpool(&x.fstype) ||
+	    strdup_from_strpool(&x.opt_fields) ||
+	    strdup_from_strpool(&x.optstr) ||
+	    strdup_from_strpool(&x.vfs_optstr) ||
+	    strdup_from_strpool(&x.fs_optstr))
+		goto err;
+
+	fs_drop_strpool(fs);
+
+	fs->root = x.root;
+	fs->fstype = x.fstype;
+	fs->opt_fields = x.opt_fields;
+	fs->optstr = x.optstr;
+	fs->vfs_optstr = x.vfs_optstr;
+	fs->fs_optstr = x.fs_optstr;
+	return 0;
+err:
+	if (x.root != fs->root)
+		free(x.root);
+	if (x.fstype != fs->fstype)
+		free(x.fstype);
+	if (x.opt_fields != fs->opt_fields)
+		free(x.opt_fields);
+	if (x.optstr != fs->optstr)
+		free(x.optstr);
+	if (x.vfs_optstr != fs->vfs_optstr)
+		free(x.vfs_optstr);
+	return -ENOMEM;
+}
+
 /**
  * mnt_reset_fs:
  * @fs: fs pointer
@@ -79,6 +154,7 @@ void mnt_reset_fs(struct libmnt_fs *fs)
 	ref = fs->refcount;
 
 	list_del(&fs->ents);
+	fs_drop_strpool(fs);
 	free(fs->source);
 	free(fs->bindsrc);
 	free(fs->tagname);
@@ -192,7 +268,8 @@ struct libmnt_fs *mnt_copy_fs(struct libmnt_fs *dest,
 			return NULL;
 
 		dest->tab	 = NULL;
-	}
+	} else if (__mnt_fs_unshare_strings(dest))
+		return NULL;
 
 	dest->id         = src->id;
 	dest->parent     = src->parent;
@@ -667,8 +744,11 @@ int __mnt_fs_set_fstype_ptr(struct libmnt_fs *fs, char *fstype)
 {
 	assert(fs);
 
-	if (fstype != fs->fstype)
+	if (fstype != fs->fstype) {
+		if (__mnt_fs_unshare_strings(fs))
+			return -ENOMEM;
 		free(fs->fstype);
+	}
 
 	fs->fstype = fstype;
 	fs->flags &= ~MNT_FS_PSEUDO;
@@ -834,6 +914,8 @@ int mnt_fs_set_options(struct libmnt_fs *fs, const char *optstr)
 
 	if (!fs)
 		return -EINVAL;
+	if (__mnt_fs_unshare_strings(fs))
+		return -ENOMEM;
 	if (optstr) {
 		int rc = mnt_split_optstr(optstr, &u, &v, &f, 0, 0);
 		if (rc)
@@ -881,6 +963,8 @@ int mnt_fs_append_options(struct libmnt_fs *fs, const char *optstr)
 		return -EINVAL;
 	if (!optstr)
 		return 0;
+	if (__mnt_fs_unshare_strings(fs))
+		return -ENOMEM;
 
 	rc = mnt_split_optstr(optstr, &u, &v, &f, 0, 0);
 	if (rc)
@@ -923,6 +1007,8 @@ int mnt_fs_prepend_options(struct libmnt_fs *fs, const char *optstr)
 		return -EINVAL;
 	if (!optstr)
 		return 0;
+	if (__mnt_fs_unshare_strings(fs))
+		return -ENOMEM;
 
 	rc = mnt_split_optstr(optstr, &u, &v, &f, 0, 0);
 	if (rc)
@@ -1149,6 +1235,8 @@ const char *mnt_fs_get_root(struct libmnt_fs *fs)
  */
 int mnt_fs_set_root(struct libmnt_fs *fs, const char *path)
 {
+	if (__mnt_fs_unshare_strings(fs))
+		return -ENOMEM;
 	return strdup_to_struct_member(fs, root, path);
 }
 
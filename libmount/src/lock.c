@@ -197,7 +197,7 @@ static void unlock_simplelock(struct libmnt_lock *ml)
 	}
 }
 
-static int lock_simplelock(struct libmnt_lock *ml)
+static int lock_simplelock(struct libmnt_lock *ml, int op)
 {
 	const char *lfile;
 	int rc;
@@ -209,7 +209,9 @@ static int lock_simplelock(struct libmnt_lock *ml)
 
 	lfile = mnt_lock_get_lockfile(ml);
 
-	DBG(LOCKS, ul_debugobj(ml, "%s: locking", lfile));
+	DBG(LOCKS, ul_debugobj(ml, "%s: locking%s%s", lfile,
+				op & LOCK_SH ? " [shared]" : "",
+				op & LOCK_NB ? " [nowait]" : ""));
 
 	if (ml->sigblock) {
 		sigset_t sigs;
@@ -239,9 +241,9 @@ static int lock_simplelock(struct libmnt_lock *ml)
 		}
 	}
 
-	while (flock(ml->lockfile_fd, LOCK_EX) < 0) {
+	while (flock(ml->lockfile_fd, op) < 0) {
 		int errsv;
-		if ((errno == EAGAIN) || (errno == EINTR))
+		if ((errno == EAGAIN && !(op & LOCK_NB)) || (errno == EINTR))
 			continue;
 		errsv = errno;
 		close(ml->lockfile_fd);
@@ -542,11 +544,26 @@ int mnt_lock_file(struct libmnt_lock *ml)
 		return -EINVAL;
 
 	if (ml->simplelock)
-		return lock_simplelock(ml);
+		return lock_simplelock(ml, LOCK_EX);
 
 	return lock_mtab(ml);
 }
 
+/*
+ * Private API to lock the file by flock() in shared mode (LOCK_SH) or to try
+ * the lock without waiting (LOCK_NB). It's supported for simple lock only.
+ *
+ * Returns: 0 on success, -EWOULDBLOCK if LOCK_NB requested and the file is
+ * already locked, or another negative number in case of error.
+ */
+int __mnt_lock_file(struct libmnt_lock *ml, int op)
+{
+	if (!ml || !ml->simplelock)
+		return -EINVAL;
+
+	return lock_simplelock(ml, op);
+}
+
 /**
  * mnt_unlock_file:
  * @ml: lock struct
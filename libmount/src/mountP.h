@@ -82,6 +82,11 @@ UL_DEBUG_DECLARE_MASK(libmount);
 
 #define MNT_UTAB_HEADER	"# libmount utab file\n"
 
+/* utab changes appended by mnt_update_table(), see tab_update.c */
+#define MNT_UTAB_JOURNAL_EXT	".journal"
+/* the first utab line, journal records from other generations are ignored */
+#define MNT_UTAB_JOURNAL_GEN	"# libmount utab generation "
+
 #ifdef TEST_PROGRAM
 struct libmnt_test {
 	const char	*name;
@@ -115,6 +120,8 @@ extern int mnt_open_uniq_filename(const char *filename, char **name);
 
 extern int mnt_has_regular_utab(const char **utab, int *writable);
 extern const char *mnt_get_utab_path(void);
+extern char *mnt_get_utab_journal_path(const char *utab);
+extern int mnt_utab_is_empty(const char *utab);
 
 extern int mnt_get_filesystems(char ***filesystems, const char *pattern);
 extern void mnt_free_filesystems(char **filesystems);
@@ -128,13 +135,14 @@ extern int mnt_tmptgt_cleanup(int old_ns_fd);
 
 /* tab.c */
 extern int is_mountinfo(struct libmnt_table *tb);
-extern int mnt_table_set_parser_fltrcb(	struct libmnt_table *tb,
-					int (*cb)(struct libmnt_fs *, void *),
-					void *data);
 
 extern int __mnt_table_parse_mtab(struct libmnt_table *tb,
 					const char *filename,
 					struct libmnt_table *u_tb);
+extern int __mnt_table_parse_utab(struct libmnt_table *tb,
+					const char *filename, int journal_fd,
+					uint64_t *gen);
+extern uint64_t __mnt_utab_read_generation(FILE *f);
 
 extern struct libmnt_fs *mnt_table_get_fs_root(struct libmnt_table *tb,
 					struct libmnt_fs *fs,
@@ -217,6 +225,9 @@ struct libmnt_fs {
 
 	char		*comment;	/* fstab comment */
 
+	struct libmnt_strpool *strpool;	/* owner of root, fstype, opt_fields and
+					 * *optstr (except user_optstr) strings */
+
 	void		*userdata;	/* library independent data */
 };
 
@@ -241,6 +252,7 @@ struct libmnt_table {
 	char		*comm_tail;	/* Last comment in file */
 
 	struct libmnt_cache *cache;		/* canonicalized paths/tags cache */
+	struct libmnt_strpool *strpool;		/* strings shared by entries */
 
         int		(*errcb)(struct libmnt_table *tb,
 				 const char *filename, int line);
@@ -389,6 +401,7 @@ struct libmnt_context
 
 /* lock.c */
 extern int mnt_lock_use_simplelock(struct libmnt_lock *ml, int enable);
+extern int __mnt_lock_file(struct libmnt_lock *ml, int op);
 
 /* optmap.c */
 extern const struct libmnt_optmap *mnt_optmap_get_entry(
@@ -413,6 +426,15 @@ extern int __mnt_fs_set_source_ptr(struct libmnt_fs *fs, char *source)
 			__attribute__((nonnull(1)));
 extern int __mnt_fs_set_fstype_ptr(struct libmnt_fs *fs, char *fstype)
 			__attribute__((nonnull(1)));
+extern int __mnt_fs_unshare_strings(struct libmnt_fs *fs);
+
+/* strpool.c */
+struct libmnt_strpool;
+
+extern struct libmnt_strpool *mnt_new_strpool(void);
+extern void mnt_ref_strpool(struct libmnt_strpool *pool);
+extern void mnt_unref_strpool(struct libmnt_strpool *pool);
+extern char *mnt_strpool_add(struct libmnt_strpool *pool, const char *str, size_t len);
 
 /* context.c */
 extern struct libmnt_context *mnt_copy_context(struct libmnt_context *o);
@@ -476,6 +498,8 @@ extern int mnt_update_set_filename(struct libmnt_update *upd,
 				   const char *filename, int userspace_only);
 extern int mnt_update_already_done(struct libmnt_update *upd,
 				   struct libmnt_lock *lc);
+extern int __mnt_table_move_targets(struct libmnt_table *tb,
+				   const char *oldtgt, const char *newtgt);
 
 #if __linux__
 /* btrfs.c */
@@ -0,0 +1,225 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+/*
+ * This file is part of libmount from util-linux project.
+ *
+ * libmount is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * Strings pool -- private libmount API
+ *
+ * The pool is used by mountinfo parser to store strings shared by many
+ * filesystems (FS type, mount options, FS root). The strings are deduplicated
+ * and allocated in large chunks, so a huge mount table does not require
+ * hundreds of thousands of small allocations and all the pool is deallocated
+ * by a few free() calls.
+ *
+ * The strings in the pool are read-only. The pool is reference counted, the
+ * table and all entries (libmnt_fs) with strings from the pool hold a reference.
+ * See __mnt_fs_unshare_strings() for copy-on-write in libmnt_fs setters.
+ */
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "mountP.h"
+
+#define MNT_STRPOOL_CHUNKSZ	(16 * 1024)
+#define MNT_STRPOOL_HASHSZ	256		/* initial size, power of 2 */
+
+struct strpool_chunk {
+	struct strpool_chunk	*next;
+	size_t			size;		/* size of data[] */
+	size_t			used;		/* used bytes in data[] */
+	char			data[];
+};
+
+struct strpool_entry {
+	const char	*str;
+	size_t		len;
+	uint32_t	hash;
+};
+
+struct libmnt_strpool {
+	int			refcount;
+
+	struct strpool_chunk	*chunks;	/* the first chunk is the current */
+
+	struct strpool_entry	*ents;		/* open addressing hash table */
+	size_t			nents;
+	size_t			hashsz;		/* size of ents[], power of 2 */
+
+	size_t			nhits;		/* number of deduplicated strings */
+};
+
+/* FNV-1a */
+static uint32_t strpool_hash(const char *str, size_t len)
+{
+	uint32_t h = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		h ^= (unsigned char) str[i];
+		h *= 16777619U;
+	}
+	return h;
+}
+
+struct libmnt_strpool *mnt_new_strpool(void)
+{
+	struct libmnt_strpool *pool = calloc(1, sizeof(*pool));
+
+	if (!pool)
+		return NULL;
+
+	pool->ents = calloc(MNT_STRPOOL_HASHSZ, sizeof(struct strpool_entry));
+	if (!pool->ents) {
+		free(pool);
+		return NULL;
+	}
+	pool->hashsz = MNT_STRPOOL_HASHSZ;
+	pool->refcount = 1;
+
+	DBG(TAB, ul_debugobj(pool, "alloc strpool"));
+	return pool;
+}
+
+void mnt_ref_strpool(struct libmnt_strpool *pool)
+{
+	if (pool)
+		pool->refcount++;
+}
+
+void mnt_unref_strpool(struct libmnt_strpool *pool)
+{
+	struct strpool_chunk *ch;
+
+	if (!pool)
+		return;
+
+	pool->refcount--;
+	if (pool->refcount > 0)
+		return;
+
+	DBG(TAB, ul_debugobj(pool, "free strpool [strings=%zu, deduplicated=%zu]",
+				pool->nents, pool->nhits));
+
+	ch = pool->chunks;
+	while (ch) {
+		struct strpool_chunk *next = ch->next;
+
+		free(ch);
+		ch = next;
+	}
+	free(pool->ents);
+	free(pool);
+}
+
+/* copies @str to the pool memory */
+static char *strpool_copy(struct libmnt_strpool *pool, const char *str, size_t len)
+{
+	struct strpool_chunk *ch = pool->chunks;
+	char *p;
+
+	if (!ch || ch->size - ch->used < len + 1) {
+		size_t sz = MNT_STRPOOL_CHUNKSZ;
+
+		if (len + 1 > sz / 4)
+			sz = len + 1;	/* huge string, use extra chunk */
+
+		ch = malloc(sizeof(*ch) + sz);
+		if (!ch)
+			return NULL;
+		ch->size = sz;
+		ch->used = 0;
+
+		if (sz == MNT_STRPOOL_CHUNKSZ || !pool->chunks) {
+			ch->next = pool->chunks;
+			pool->chunks = ch;
+		} else {
+			/* don't waste the current chunk */
+			ch->next = pool->chunks->next;
+			pool->chunks->next = ch;
+		}
+	}
+
+	p = ch->data + ch->used;
+	memcpy(p, str, len);
+	p[len] = '\0';
+	ch->used += len + 1;
+
+	return p;
+}
+
+static int strpool_grow(struct libmnt_strpool *pool)
+{
+	size_t i, sz = pool->hashsz * 2;
+	struct strpool_entry *ents = calloc(sz, sizeof(struct strpool_entry));
+
+	if (!ents)
+		return -ENOMEM;
+
+	for (i = 0; i < pool->hashsz; i++) {
+		struct strpool_entry *e = &pool->ents[i];
+		size_t x;
+
+		if (!e->str)
+			continue;
+		for (x = e->hash & (sz - 1); ents[x].str; x = (x + 1) & (sz - 1));
+		ents[x] = *e;
+	}
+
+	free(pool->ents);
+	pool->ents = ents;
+	pool->hashsz = sz;
+	return 0;
+}
+
+/*
+ * Returns pointer to the (read-only) string in the pool. The @str does not have
+ * to be terminated, @len is the string length.
+ */
+char *mnt_strpool_add(struct libmnt_strpool *pool, const char *str, size_t len)
+{
+	uint32_t hash;
+	size_t x;
+	char *p;
+
+	if (!pool || !str)
+		return NULL;
+
+	hash = strpool_hash(str, len);
+
+	for (x = hash & (pool->hashsz - 1); pool->ents[x].str;
+	     x = (x + 1) & (pool->hashsz - 1)) {
+		struct strpool_entry *e = &pool->ents[x];
+
+		if (e->hash == hash && e->len == len
+		    && memcmp(e->str, str, len) == 0) {
+			pool->nhits++;
+			return (char *) e->str;
+		}
+	}
+
+	if (pool->nents + 1 >= pool->hashsz)
+		return NULL;		/* strpool_grow() failed */
+
+	p = strpool_copy(pool, str, len);
+	if (!p)
+		return NULL;
+
+	pool->ents[x].str = p;
+	pool->ents[x].len = len;
+	pool->ents[x].hash = hash;
+	pool->nents++;
+
+	/* keep load factor < 0.75 */
+	if (pool->nents * 4 >= pool->hashsz * 3)
+		strpool_grow(pool);
+
+	return p;
+}
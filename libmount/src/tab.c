@@ -115,6 +115,10 @@ int mnt_reset_table(struct libmnt_table *tb)
 		mnt_table_remove_fs(tb, fs);
 	}
 
+	/* the removed entries (if still used) hold their own references */
+	mnt_unref_strpool(tb->strpool);
+	tb->strpool = NULL;
+
 	tb->nents = 0;
 	return 0;
 }
@@ -174,9 +174,43 @@ fail:
 
 
 /*
- * Parses one line from a mountinfo file
+ * The same as unmangle(), but the result is stored in the strings pool. The
+ * @pool may be NULL, then it returns allocated string.
  */
-static int mnt_parse_mountinfo_line(struct libmnt_fs *fs, const char *s)
+static char *unmangle_to_strpool(struct libmnt_strpool *pool,
+				 const char *s, const char **end)
+{
+	char *p, *res;
+	size_t sz;
+
+	if (!pool)
+		return unmangle(s, end);
+	if (!s)
+		return NULL;
+
+	sz = strcspn(s, " \t");
+	if (end)
+		*end = s + sz;
+	if (!sz)
+		return NULL;	/* empty string */
+
+	if (!memchr(s, '\\', sz))
+		return mnt_strpool_add(pool, s, sz);
+
+	p = unmangle(s, NULL);
+	if (!p)
+		return NULL;
+	res = mnt_strpool_add(pool, p, strlen(p));
+	free(p);
+	return res;
+}
+
+/*
+ * Parses one line from a mountinfo file. If @pool is not NULL, then
+ * root, options and FS type strings are stored in the pool.
+ */
+static int mnt_parse_mountinfo_line(struct libmnt_fs *fs, const char *s,
+				    struct libmnt_strpool *pool)
 {
 	int rc = 0;
 	unsigned int maj, min;
@@ -184,6 +218,12 @@ static int mnt_parse_mountinfo_line(struct libmnt_fs *fs, const char *s)
 
 	fs->flags |= MNT_FS_KERNEL;
 
+	if (pool && !fs->strpool) {
+		fs->strpool = pool;
+		mnt_ref_strpool(pool);
+	} else
+		pool = fs->strpool;
+
 	/* (1) id */
 	s = next_s32(s, &fs->id, &rc);
 	if (!s || !*s || rc) {
@@ -212,7 +252,7 @@ static int mnt_parse_mountinfo_line(struct libmnt_fs *fs, const char *s)
 	s = skip_separator(s);
 
 	/* (4) mountroot */
-	fs->root = unmangle(s, &s);
+	fs->root = unmangle_to_strpool(pool, s, &s);
 	if (!fs->root) {
 		DBG(TAB, ul_debug("tab parse error: [mountroot]"));
 		goto fail;
@@ -230,7 +270,7 @@ static int mnt_parse_mountinfo_line(struct libmnt_fs *fs, const char *s)
 	s = skip_separator(s);
 
 	/* (6) vfs options (fs-independent) */
-	fs->vfs_optstr = unmangle(s, &s);
+	fs->vfs_optstr = unmangle_to_strpool(pool, s, &s);
 	if (!fs->vfs_optstr) {
 		DBG(TAB, ul_debug("tab parse error: [VFS options]"));
 		goto fail;
@@ -243,15 +283,21 @@ static int mnt_parse_mountinfo_line(struct libmnt_fs *fs, const char *s)
 		return -EINVAL;
 	}
 	if (p > s + 1)
-		fs->opt_fields = strndup(s + 1, p - s - 1);
+		fs->opt_fields = pool ? mnt_strpool_add(pool, s + 1, p - s - 1) :
+					strndup(s + 1, p - s - 1);
 
 	s = skip_separator(p + 3);
 
 	/* (8) FS type */
-	p = unmangle(s, &s);
+	if (pool) {
+		fs->fstype = unmangle_to_strpool(pool, s, &s);
+		p = fs->fstype;		/* update FS flags only */
+	} else
+		p = unmangle(s, &s);
 	if (!p || (rc = __mnt_fs_set_fstype_ptr(fs, p))) {
 		DBG(TAB, ul_debug("tab parse error: [fstype]"));
-		free(p);
+		if (!pool)
+			free(p);
 		goto fail;
 	}
 
@@ -277,14 +323,19 @@ static int mnt_parse_mountinfo_line(struct libmnt_fs *fs, const char *s)
 	s = skip_separator(s);
 
 	/* (10) fs options (fs specific) */
-	fs->fs_optstr = unmangle(s, &s);
+	fs->fs_optstr = unmangle_to_strpool(pool, s, &s);
 	if (!fs->fs_optstr) {
 		DBG(TAB, ul_debug("tab parse error: [FS options]"));
 		goto fail;
 	}
 
 	/* merge VFS and FS options to one string */
-	fs->optstr = mnt_fs_strdup_options(fs);
+	p = mnt_fs_strdup_options(fs);
+	if (p && pool) {
+		fs->optstr = mnt_strpool_add(pool, p, strlen(p));
+		free(p);
+	} else
+		fs->optstr = p;
 	if (!fs->optstr) {
 		rc = -ENOMEM;
 		DBG(TAB, ul_debug("tab parse error: [merge VFS and FS options]"));
@@ -594,7 +645,9 @@ next_line:
 		rc = mnt_parse_table_line(fs, s);
 		break;
 	case MNT_FMT_MOUNTINFO:
-		rc = mnt_parse_mountinfo_line(fs, s);
+		if (!tb->strpool)
+			tb->strpool = mnt_new_strpool();
+		rc = mnt_parse_mountinfo_line(fs, s, tb->strpool);
 		break;
 	case MNT_FMT_UTAB:
 		rc = mnt_parse_utab_line(fs, s);
@@ -739,21 +792,22 @@ int mnt_table_parse_stream(struct libmnt_table *tb, FILE *f, const char *filenam
 		/* parse */
 		rc = mnt_table_parse_next(&pa, tb, fs);
 
-		if (rc == 0 && tb->fltrcb && tb->fltrcb(fs, tb->fltrcb_data))
-			rc = 1;	/* filtered out by callback... */
-
-		/* add to the table */
 		if (rc == 0) {
-			rc = mnt_table_add_fs(tb, fs);
 			fs->flags |= flags;
 
-			if (rc == 0 && tb->fmt == MNT_FMT_MOUNTINFO) {
+			/* finalize the entry before the filter callback, so
+			 * the callback gets the same data as the table */
+			if (tb->fmt == MNT_FMT_MOUNTINFO)
 				rc = kernel_fs_postparse(tb, fs, &tid, filename);
-				if (rc)
-					mnt_table_remove_fs(tb, fs);
-			}
 		}
 
+		if (rc == 0 && tb->fltrcb && tb->fltrcb(fs, tb->fltrcb_data))
+			rc = 1;	/* filtered out by callback... */
+
+		/* add to the table */
+		if (rc == 0)
+			rc = mnt_table_add_fs(tb, fs);
+
 		/* remove reference (or deallocate on error) */
 		mnt_unref_fs(fs);
 
@@ -800,6 +854,9 @@ int mnt_table_parse_file(struct libmnt_table *tb, const char *filename)
 	if (!filename || !tb)
 		return -EINVAL;
 
+	if (tb->fmt == MNT_FMT_UTAB)
+		return __mnt_table_parse_utab(tb, filename, -1, NULL);
+
 	f = fopen(filename, "r" UL_CLOEXECSTR);
 	if (f) {
 		rc = mnt_table_parse_stream(tb, f, filename);
@@ -811,6 +868,237 @@ int mnt_table_parse_file(struct libmnt_table *tb, const char *filename)
 	return rc;
 }
 
+/*
+ * Returns utab generation from the first utab line, or 0. The stream is
+ * rewinded.
+ */
+uint64_t __mnt_utab_read_generation(FILE *f)
+{
+	char buf[64];
+	uint64_t gen = 0;
+	const char *p;
+
+	if (fgets(buf, sizeof(buf), f)
+	    && (p = startswith(buf, MNT_UTAB_JOURNAL_GEN)))
+		gen = strtoumax(p, NULL, 10);
+	rewind(f);
+	return gen;
+}
+
+/*
+ * Applies one utab journal record to @tb. The record is utab line with
+ * "GEN=<generation> OP=<operation>" prefix:
+ *
+ *   OP=add <utab line>              add a new entry (mount)
+ *   OP=del TARGET=<path>            remove the last entry for the target (umount)
+ *   OP=move SRC=<old> TARGET=<new>  rename target and its subdirectories (MS_MOVE)
+ *   OP=remount <utab line>          modify attributes and options (MS_REMOUNT),
+ *                                   or add a new entry if the target not found
+ *
+ * The generation is the utab generation when the record has been appended.
+ * The compaction increments the utab generation, so records already merged to
+ * utab (e.g. the compaction has been interrupted before journal truncate) are
+ * ignored. All records are applied if utab has no generation (@gen is 0), it
+ * has been written by libmount without the journal support.
+ *
+ * Returns: 0 on success, 1 if the record is from another generation, <0 on error.
+ */
+static int replay_utab_record(struct libmnt_table *tb, const char *s, uint64_t gen)
+{
+	struct libmnt_fs *fs, *cur = NULL;
+	const char *p;
+	char *end = NULL;
+	uint64_t rgen;
+	int rc;
+
+	s = startswith(s, "GEN=");
+	if (!s)
+		return -EINVAL;
+	errno = 0;
+	rgen = strtoumax(s, &end, 10);
+	if (errno || end == s || *end != ' ')
+		return -EINVAL;
+	if (gen && rgen != gen)
+		return 1;
+
+	s = startswith(end + 1, "OP=");
+	if (!s)
+		return -EINVAL;
+	p = strchr(s, ' ');
+	if (!p)
+		return -EINVAL;
+
+	fs = mnt_new_fs();
+	if (!fs)
+		return -ENOMEM;
+
+	rc = mnt_parse_utab_line(fs, p + 1);
+	if (rc)
+		goto done;
+	if (!mnt_fs_get_target(fs)) {
+		rc = -EINVAL;
+		goto done;
+	}
+
+	if (strncmp(s, "del ", 4) == 0) {
+		cur = mnt_table_find_target(tb, mnt_fs_get_target(fs), MNT_ITER_BACKWARD);
+		if (cur)
+			rc = mnt_table_remove_fs(tb, cur);
+
+	} else if (strncmp(s, "move ", 5) == 0) {
+		if (mnt_fs_get_srcpath(fs))
+			rc = __mnt_table_move_targets(tb, mnt_fs_get_srcpath(fs),
+							  mnt_fs_get_target(fs));
+		else
+			rc = -EINVAL;
+
+	} else if (strncmp(s, "remount ", 8) == 0
+		   && (cur = mnt_table_find_target(tb, mnt_fs_get_target(fs),
+						   MNT_ITER_BACKWARD))) {
+		rc = mnt_fs_set_attributes(cur, mnt_fs_get_attributes(fs));
+		if (!rc)
+			rc = mnt_fs_set_options(cur, mnt_fs_get_user_options(fs));
+
+	} else if (strncmp(s, "add ", 4) == 0 || strncmp(s, "remount ", 8) == 0) {
+		if (!tb->fltrcb || !tb->fltrcb(fs, tb->fltrcb_data))
+			rc = mnt_table_add_fs(tb, fs);
+	} else
+		rc = -EINVAL;
+done:
+	mnt_unref_fs(fs);
+	return rc;
+}
+
+static int replay_utab_journal(struct libmnt_table *tb, int fd,
+			       const char *filename, uint64_t gen)
+{
+	FILE *f;
+	char *buf = NULL;
+	size_t bufsz = 0, line = 0, stale = 0;
+	ssize_t len;
+	int rc = 0;
+
+	fd = dup(fd);
+	if (fd < 0)
+		return -errno;
+	f = fdopen(fd, "r" UL_CLOEXECSTR);
+	if (!f) {
+		close(fd);
+		return -errno;
+	}
+	rewind(f);
+
+	while ((len = getline(&buf, &bufsz, f)) > 0) {
+		line++;
+		if (buf[len - 1] != '\n') {
+			/* incomplete record, the writer is probably still active */
+			DBG(TAB, ul_debugobj(tb, "%s:%zu: incomplete record", filename, line));
+			break;
+		}
+		buf[len - 1] = '\0';
+
+		rc = replay_utab_record(tb, buf, gen);
+		if (rc == -ENOMEM)
+			break;
+		if (rc == 1)
+			stale++;
+		else if (rc)
+			DBG(TAB, ul_debugobj(tb, "%s:%zu: bad record, ignore", filename, line));
+		rc = 0;
+	}
+
+	DBG(TAB, ul_debugobj(tb, "%s: %zu records, %zu from old generation [gen=%ju, rc=%d]",
+				filename, line, stale, gen, rc));
+	free(buf);
+	fclose(f);
+	return rc;
+}
+
+/* returns the current utab generation or 0 */
+static uint64_t utab_read_generation(const char *filename)
+{
+	uint64_t gen = 0;
+	FILE *f;
+
+	f = fopen(filename, "r" UL_CLOEXECSTR);
+	if (f) {
+		gen = __mnt_utab_read_generation(f);
+		fclose(f);
+	}
+	return gen;
+}
+
+#define MNT_UTAB_PARSE_RETRIES	8
+
+/*
+ * Parses utab @filename and replays the changes from its journal. The
+ * @journal_fd is already opened journal (the caller holds the exclusive utab
+ * lock) or -1. The utab generation is returned in @gen (optional).
+ *
+ * The readers don't lock the journal. If the journal has been compacted in
+ * the middle of the parsing (the utab generation is not the same after the
+ * journal is read), an empty @tb is parsed again.
+ *
+ * See also update_utab_journal() in tab_update.c.
+ */
+int __mnt_table_parse_utab(struct libmnt_table *tb, const char *filename,
+			   int journal_fd, uint64_t *gen)
+{
+	char *jname = NULL;
+	int fd = journal_fd, rc, tries = 0;
+	int retry = journal_fd < 0 && mnt_table_is_empty(tb);
+	uint64_t g = 0;
+	FILE *f;
+
+	assert(tb);
+	assert(filename);
+
+	if (fd < 0) {
+		jname = mnt_get_utab_journal_path(filename);
+		if (!jname)
+			return -ENOMEM;
+	}
+again:
+	if (jname) {
+		struct stat st;
+
+		/* without the journal, utab is always atomically replaced */
+		if (stat(jname, &st) == 0 && st.st_size > 0)
+			fd = open(jname, O_RDONLY|O_CLOEXEC);
+	}
+
+	f = fopen(filename, "r" UL_CLOEXECSTR);
+	if (f) {
+		g = __mnt_utab_read_generation(f);
+		rc = mnt_table_parse_stream(tb, f, filename);
+		fclose(f);
+	} else
+		rc = errno == ENOENT && fd >= 0 ? 0 : -errno;
+
+	if (!rc && fd >= 0)
+		rc = replay_utab_journal(tb, fd, jname ? jname : filename, g);
+
+	if (fd >= 0 && fd != journal_fd) {
+		close(fd);
+		fd = -1;
+
+		if (!rc && retry && utab_read_generation(filename) != g) {
+			if (++tries < MNT_UTAB_PARSE_RETRIES) {
+				DBG(TAB, ul_debugobj(tb, "%s: compacted while parsing, retry", filename));
+				mnt_reset_table(tb);
+				goto again;
+			}
+			DBG(TAB, ul_debugobj(tb, "%s: compacted while parsing, give up", filename));
+		}
+	}
+	if (!rc && gen)
+		*gen = g;
+	free(jname);
+
+	DBG(TAB, ul_debugobj(tb, "parsing done [filename=%s, rc=%d]", filename, rc));
+	return rc;
+}
+
 static int mnt_table_parse_dir_filter(const struct dirent *d)
 {
 	size_t namesz;
@@ -943,7 +1231,7 @@ struct libmnt_table *__mnt_new_table_from_file(const char *filename, int fmt, in
 
 	if (!filename)
 		return NULL;
-	if (stat(filename, &st))
+	if (stat(filename, &st) && (fmt != MNT_FMT_UTAB || mnt_utab_is_empty(filename)))
 		return empty_for_enoent ? mnt_new_table() : NULL;
 
 	tb = mnt_new_table();
@@ -1022,9 +1310,20 @@ int mnt_table_set_parser_errcb(struct libmnt_table *tb,
 	return 0;
 }
 
-/*
- * Filter out entries during tab file parsing. If @cb returns 1, then the entry
- * is ignored.
+/**
+ * mnt_table_set_parser_fltrcb:
+ * @tb: pointer to table
+ * @cb: pointer to callback function
+ * @data: callback private data
+ *
+ * The filter callback function is called by table parser for each successfully
+ * parsed entry. If the callback returns 1, then the entry is not added to the
+ * table. The callback is also usable to process entries on-the-fly (for
+ * example to print them) without keeping the whole table in memory.
+ *
+ * Since: 2.39
+ *
+ * Returns: 0 on success or negative number in case of error.
  */
 int mnt_table_set_parser_fltrcb(struct libmnt_table *tb,
 		int (*cb)(struct libmnt_fs *, void *),
@@ -1225,7 +1524,7 @@ read_utab:
 	if (!u_tb) {
 		const char *utab = mnt_get_utab_path();
 
-		if (!utab || is_file_empty(utab))
+		if (!utab || mnt_utab_is_empty(utab))
 			return 0;
 
 		u_tb = mnt_new_table();
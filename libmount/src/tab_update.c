@@ -29,6 +29,7 @@
 
 #include "mountP.h"
 #include "mangle.h"
+#include "all-io.h"
 #include "pathnames.h"
 #include "strutils.h"
 
@@ -40,6 +41,8 @@ struct libmnt_update {
 	int		userspace_only;
 	int		ready;
 
+	uint64_t	utab_gen;	/* utab generation written by update_table() */
+
 	struct libmnt_table *mountinfo;
 };
 
@@ -532,6 +535,8 @@ static int update_table(struct libmnt_update *upd, struct libmnt_table *tb)
 
 		mnt_reset_iter(&itr, MNT_ITER_FORWARD);
 
+		if (upd->userspace_only && upd->utab_gen)
+			fprintf(f, MNT_UTAB_JOURNAL_GEN "%ju\n", (uintmax_t) upd->utab_gen);
 		if (tb->comms && mnt_table_get_intro_comment(tb))
 			fputs(mnt_table_get_intro_comment(tb), f);
 
@@ -747,6 +752,45 @@ static int update_remove_entry(struct libmnt_update *upd, struct libmnt_lock *lc
 	return rc;
 }
 
+/*
+ * Replaces @oldtgt by @newtgt in targets of all entries mounted on @oldtgt
+ * or on its subdirectories (MS_MOVE). The @newtgt has to be canonicalized.
+ */
+int __mnt_table_move_targets(struct libmnt_table *tb,
+			     const char *oldtgt, const char *newtgt)
+{
+	struct libmnt_iter itr;
+	struct libmnt_fs *fs;
+	int rc = 0;
+
+	mnt_reset_iter(&itr, MNT_ITER_BACKWARD);
+	while (mnt_table_next_fs(tb, &itr, &fs) == 0) {
+		char *p;
+		const char *e;
+
+		e = startswith(mnt_fs_get_target(fs), oldtgt);
+		if (!e || (*e && *e != '/'))
+			continue;
+		if (*e == '/')
+			e++;		/* remove extra '/' */
+
+		/* no subdirectory, replace entire path */
+		if (!*e)
+			rc = mnt_fs_set_target(fs, newtgt);
+
+		/* update start of the path, keep subdirectory */
+		else if (asprintf(&p, "%s/%s", newtgt, e) > 0) {
+			rc = mnt_fs_set_target(fs, p);
+			free(p);
+		} else
+			rc = -ENOMEM;
+
+		if (rc < 0)
+			break;
+	}
+	return rc;
+}
+
 static int update_modify_target(struct libmnt_update *upd, struct libmnt_lock *lc)
 {
 	struct libmnt_table *tb = NULL;
@@ -763,43 +807,14 @@ static int update_modify_target(struct libmnt_update *upd, struct libmnt_lock *l
 	tb = __mnt_new_table_from_file(upd->filename,
 			upd->userspace_only ? MNT_FMT_UTAB : MNT_FMT_MTAB, 1);
 	if (tb) {
-		const char *upd_source = mnt_fs_get_srcpath(upd->fs);
-		const char *upd_target = mnt_fs_get_target(upd->fs);
-		struct libmnt_iter itr;
-		struct libmnt_fs *fs;
-		char *cn_target = mnt_resolve_path(upd_target, NULL);
+		char *cn_target = mnt_resolve_path(mnt_fs_get_target(upd->fs), NULL);
 
 		if (!cn_target) {
 			rc = -ENOMEM;
 			goto done;
 		}
 
-		mnt_reset_iter(&itr, MNT_ITER_BACKWARD);
-		while (mnt_table_next_fs(tb, &itr, &fs) == 0) {
-			char *p;
-			const char *e;
-
-			e = startswith(mnt_fs_get_target(fs), upd_source);
-			if (!e || (*e && *e != '/'))
-				continue;
-			if (*e == '/')
-				e++;		/* remove extra '/' */
-
-			/* no subdirectory, replace entire path */
-			if (!*e)
-				rc = mnt_fs_set_target(fs, cn_target);
-
-			/* update start of the path, keep subdirectory */
-			else if (asprintf(&p, "%s/%s", cn_target, e) > 0) {
-				rc = mnt_fs_set_target(fs, p);
-				free(p);
-			} else
-				rc = -ENOMEM;
-
-			if (rc < 0)
-				break;
-		}
-
+		rc = __mnt_table_move_targets(tb, mnt_fs_get_srcpath(upd->fs), cn_target);
 		if (!rc)
 			rc = update_table(upd, tb);
 		free(cn_target);
@@ -855,6 +870,206 @@ static int update_modify_options(struct libmnt_update *upd, struct libmnt_lock *
 	return rc;
 }
 
+/*
+ * utab journal
+ *
+ * The utab file is not rewritten for each mount/umount. The change is appended
+ * as one record (see replay_utab_record() in tab_parse.c) to utab.journal by
+ * one write(2) call under the shared utab lock, so concurrent mount processes
+ * do not wait for each other.
+ *
+ * The journal is merged into utab (compacted) under the exclusive lock before
+ * mnt_update_table() returns. The processes which have appended their records
+ * at the same time wait for the lock one after another, the first one merges
+ * all the records and the others find the journal empty. So utab is up to date
+ * after the update, and libmount versions which don't know the journal (e.g.
+ * statically linked) miss only the updates still in progress.
+ *
+ * Every record starts with "GEN=<n>", the utab generation (the first utab
+ * line) when the record has been appended. The compaction writes utab with
+ * the next generation before it truncates the journal, so the records are
+ * not applied twice if the truncate does not happen.
+ *
+ * The readers don't lock anything (the journal is readable for everyone, so a
+ * lock would allow any user to block the compaction). They read utab and the
+ * journal again if the utab generation has been changed in the meantime.
+ */
+static int utab_journal_record(struct libmnt_update *upd, char **rec, size_t *recsz)
+{
+	FILE *f;
+	char *m1 = NULL, *m2 = NULL, *cn_target = NULL;
+	int rc = 0;
+
+	f = open_memstream(rec, recsz);
+	if (!f)
+		return -errno;
+
+	if (!upd->fs && upd->target) {
+		/* umount */
+		m1 = mangle(upd->target);
+		if (m1)
+			fprintf(f, "OP=del TARGET=%s\n", m1);
+		else
+			rc = -ENOMEM;
+
+	} else if (upd->mountflags & MS_MOVE) {
+		const char *src = mnt_fs_get_srcpath(upd->fs);
+
+		cn_target = mnt_resolve_path(mnt_fs_get_target(upd->fs), NULL);
+		if (src && cn_target) {
+			m1 = mangle(src);
+			m2 = mangle(cn_target);
+		}
+		if (m1 && m2)
+			fprintf(f, "OP=move SRC=%s TARGET=%s\n", m1, m2);
+		else
+			rc = src ? -ENOMEM : -EINVAL;
+
+	} else if (upd->fs) {
+		/* remount or mount */
+		fputs(upd->mountflags & MS_REMOUNT ? "OP=remount " : "OP=add ", f);
+		rc = fprintf_utab_fs(f, upd->fs);
+	} else
+		rc = -EINVAL;
+
+	if (fclose(f) != 0 && !rc)
+		rc = -errno;
+
+	free(m1);
+	free(m2);
+	free(cn_target);
+	return rc;
+}
+
+/* returns the current utab generation, the utab lock is expected to be locked */
+static uint64_t utab_get_generation(const char *filename)
+{
+	uint64_t gen = 0;
+	FILE *f;
+
+	f = fopen(filename, "r" UL_CLOEXECSTR);
+	if (f) {
+		gen = __mnt_utab_read_generation(f);
+		fclose(f);
+	}
+	return gen;
+}
+
+/* appends the record to the journal */
+static int utab_journal_append(const char *jname, uint64_t gen, const char *rec)
+{
+	char *buf = NULL;
+	int fd, len, rc = 0;
+
+	/* one write(2) for the whole record */
+	len = asprintf(&buf, "GEN=%ju %s", (uintmax_t) gen, rec);
+	if (len < 0)
+		return -ENOMEM;
+
+	fd = open(jname, O_WRONLY|O_APPEND|O_CREAT|O_CLOEXEC,
+			 S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH);
+	if (fd < 0) {
+		rc = -errno;
+		goto done;
+	}
+
+	if (write_all(fd, buf, len) != 0)
+		rc = -errno;
+
+	close(fd);
+done:
+	free(buf);
+	return rc;
+}
+
+/* merges the journal to utab, the utab lock is expected to be exclusively locked */
+static int utab_journal_compact(struct libmnt_update *upd, const char *jname)
+{
+	struct libmnt_table *tb = NULL;
+	struct stat st;
+	uint64_t gen = 0;
+	int fd, rc = 0;
+
+	fd = open(jname, O_RDWR|O_CLOEXEC);
+	if (fd < 0)
+		return errno == ENOENT ? 0 : -errno;
+
+	if (fstat(fd, &st) != 0) {
+		rc = -errno;
+		goto done;
+	}
+	if (st.st_size == 0)
+		goto done;		/* already compacted by another process */
+
+	DBG(UPDATE, ul_debugobj(upd, "%s: compacting %jd bytes",
+				jname, (intmax_t) st.st_size));
+
+	tb = mnt_new_table();
+	if (!tb) {
+		rc = -ENOMEM;
+		goto done;
+	}
+	tb->fmt = MNT_FMT_UTAB;
+
+	rc = __mnt_table_parse_utab(tb, upd->filename, fd, &gen);
+	if (!rc) {
+		upd->utab_gen = gen + 1;
+		rc = update_table(upd, tb);
+	}
+	if (!rc && ftruncate(fd, 0) != 0)
+		rc = -errno;
+done:
+	close(fd);
+	mnt_unref_table(tb);
+	DBG(UPDATE, ul_debugobj(upd, "%s: compaction done [rc=%d]", jname, rc));
+	return rc;
+}
+
+static int update_utab_journal(struct libmnt_update *upd, struct libmnt_lock *lc)
+{
+	char *rec = NULL, *jname;
+	size_t recsz = 0;
+	int rc;
+
+	assert(upd);
+	assert(upd->userspace_only);
+
+	DBG(UPDATE, ul_debugobj(upd, "%s: append to journal", upd->filename));
+
+	jname = mnt_get_utab_journal_path(upd->filename);
+	if (!jname)
+		return -ENOMEM;
+
+	rc = utab_journal_record(upd, &rec, &recsz);
+	if (rc)
+		goto done;
+
+	if (lc && __mnt_lock_file(lc, LOCK_SH) != 0) {
+		rc = -MNT_ERR_LOCK;
+		goto done;
+	}
+	rc = utab_journal_append(jname, utab_get_generation(upd->filename), rec);
+	if (lc)
+		mnt_unlock_file(lc);
+	if (rc || !lc)
+		goto done;
+
+	/* The update is already in the journal, so the compaction errors are
+	 * not reported to the caller; the next update will try it again. */
+	if (mnt_lock_file(lc) == 0) {
+		utab_journal_compact(upd, jname);
+		mnt_unlock_file(lc);
+	} else
+		DBG(UPDATE, ul_debugobj(upd, "%s: cannot lock utab, compaction postponed",
+					upd->filename));
+done:
+	free(rec);
+	free(jname);
+	DBG(UPDATE, ul_debugobj(upd, "%s: journal update done [rc=%d]",
+				upd->filename, rc));
+	return rc;
+}
+
 /**
  * mnt_update_table:
  * @upd: update
@@ -865,6 +1080,11 @@ static int update_modify_options(struct libmnt_update *upd, struct libmnt_lock *
  * The @lc lock is optional and will be created if necessary. Note that
  * an automatically created lock blocks all signals.
  *
+ * The private utab file is not rewritten for each update, the change is
+ * appended to the utab journal under the shared lock and the journal is merged
+ * to utab under the exclusive lock, together with the changes appended by
+ * other processes in the meantime.
+ *
  * See also mnt_lock_block_signals() and mnt_context_get_lock().
  *
  * Returns: 0 on success, negative number on error.
@@ -891,7 +1111,9 @@ int mnt_update_table(struct libmnt_update *upd, struct libmnt_lock *lc)
 	if (lc && upd->userspace_only)
 		mnt_lock_use_simplelock(lc, TRUE);	/* use flock */
 
-	if (!upd->fs && upd->target)
+	if (upd->userspace_only)
+		rc = update_utab_journal(upd, lc);	/* utab */
+	else if (!upd->fs && upd->target)
 		rc = update_remove_entry(upd, lc);	/* umount */
 	else if (upd->mountflags & MS_MOVE)
 		rc = update_modify_target(upd, lc);	/* move */
@@ -926,7 +1148,8 @@ int mnt_update_already_done(struct libmnt_update *upd, struct libmnt_lock *lc)
 	}
 	if (lc && upd->userspace_only)
 		mnt_lock_use_simplelock(lc, TRUE);	/* use flock */
-	if (lc) {
+	if (lc && !upd->userspace_only) {
+		/* utab journal is locked by the utab parser */
 		rc = mnt_lock_file(lc);
 		if (rc) {
 			rc = -MNT_ERR_LOCK;
@@ -936,7 +1159,7 @@ int mnt_update_already_done(struct libmnt_update *upd, struct libmnt_lock *lc)
 
 	tb = __mnt_new_table_from_file(upd->filename,
 			upd->userspace_only ? MNT_FMT_UTAB : MNT_FMT_MTAB, 1);
-	if (lc)
+	if (lc && !upd->userspace_only)
 		mnt_unlock_file(lc);
 	if (!tb)
 		goto done;
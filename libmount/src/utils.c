@@ -867,6 +867,39 @@ const char *mnt_get_utab_path(void)
 	return p ? : MNT_PATH_UTAB;
 }
 
+/*
+ * Don't export this to libmount API -- utab is private library stuff.
+ *
+ * Returns: newly allocated path to the utab journal (e.g. /run/mount/utab.journal).
+ */
+char *mnt_get_utab_journal_path(const char *utab)
+{
+	char *path = NULL;
+
+	if (!utab || asprintf(&path, "%s" MNT_UTAB_JOURNAL_EXT, utab) < 0)
+		return NULL;
+	return path;
+}
+
+/*
+ * Returns: 1 if there is nothing in the @utab file and in its journal.
+ */
+int mnt_utab_is_empty(const char *utab)
+{
+	char *journal;
+	int rc;
+
+	assert(utab);
+
+	if (!is_file_empty(utab))
+		return 0;
+
+	journal = mnt_get_utab_journal_path(utab);
+	rc = journal ? is_file_empty(journal) : 1;
+	free(journal);
+	return rc;
+}
+
 
 /* returns file descriptor or -errno, @name returns a unique filename
  */
@@ -0,0 +1,234 @@
+/*
+ * This file may be redistributed under the terms of the
+ * GNU Lesser General Public License.
+ *
+ * Generates a huge table and measures time of the table operations.
+ */
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "c.h"
+#include "nls.h"
+#include "strutils.h"
+#include "closestream.h"
+#include "libsmartcols.h"
+
+static const char *words[] = {
+	"sda", "nvme0n1p1", "/dev/mapper/root", "ext4", "xfs", "tmpfs",
+	"rw,relatime", "ro,nosuid,nodev", "/", "/home/user/data", "/run/user/1000",
+	"1.5G", "931.5G", "0", "4096", "disk", "part", "lvm", "crypt", "loop"
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned int next_random(unsigned int *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return (*seed >> 16) & 0x7fff;
+}
+
+static void __attribute__((__noreturn__)) usage(void)
+{
+	FILE *out = stdout;
+	fprintf(out,
+		"\n %s [options]\n\n", program_invocation_short_name);
+
+	fputs(" -n, --nlines <num>             number of lines (default 500000)\n", out);
+	fputs(" -c, --ncolumns <num>           number of columns (default 6)\n", out);
+	fputs(" -t, --threads <num>            number of threads (default 0, see LIBSMARTCOLS_THREADS)\n", out);
+	fputs(" -S, --colstore                 use column store for cells\n", out);
+	fputs(" -k, --sortkey                  sort by numeric keys rather than strings\n", out);
+	fputs(" -N, --nosort                   don't sort the table\n", out);
+	fputs(" -s, --streaming                print lines immediately (implies --nosort)\n", out);
+	fputs(" -T, --tree <size>              print trees of <size> nested lines (implies --nosort)\n", out);
+	fputs(" -J, --json                     JSON output format\n", out);
+	fputs(" -r, --raw                      RAW output format\n", out);
+	fputs(" -o, --output <file>            output file (default /dev/null)\n", out);
+	fputs(" -h, --help                     this help\n", out);
+	fputs("\n", out);
+
+	exit(EXIT_SUCCESS);
+}
+
+int main(int argc, char *argv[])
+{
+	struct libscols_table *tb;
+	struct libscols_column *sortcl = NULL;
+	struct libscols_line *prev = NULL;
+	size_t i, n, nlines = 500000, ncols = 6, treesz = 0;
+	const char *outname = "/dev/null";
+	unsigned int seed = 1;
+	double t0, t1;
+	FILE *out;
+	int c, sortkey = 0, nosort = 0;
+
+	static const struct option longopts[] = {
+		{ "nlines",   1, NULL, 'n' },
+		{ "ncolumns", 1, NULL, 'c' },
+		{ "threads",  1, NULL, 't' },
+		{ "colstore", 0, NULL, 'S' },
+		{ "sortkey",  0, NULL, 'k' },
+		{ "nosort",   0, NULL, 'N' },
+		{ "streaming", 0, NULL, 's' },
+		{ "tree",     1, NULL, 'T' },
+		{ "json",     0, NULL, 'J' },
+		{ "raw",      0, NULL, 'r' },
+		{ "output",   1, NULL, 'o' },
+		{ "help",     0, NULL, 'h' },
+		{ NULL, 0, NULL, 0 },
+	};
+
+	setlocale(LC_ALL, "");	/* just to have enable UTF8 chars */
+	scols_init_debug(0);
+
+	tb = scols_new_table();
+	if (!tb)
+		err(EXIT_FAILURE, "failed to create output table");
+
+	while((c = getopt_long(argc, argv, "c:hJkNn:o:rSsT:t:", longopts, NULL)) != -1) {
+		switch(c) {
+		case 'n':
+			nlines = strtou32_or_err(optarg, "failed to parse number of lines");
+			break;
+		case 'c':
+			ncols = strtou32_or_err(optarg, "failed to parse number of columns");
+			break;
+		case 't':
+			scols_table_set_nthreads(tb, strtou32_or_err(optarg, "failed to parse number of threads"));
+			break;
+		case 'S':
+			scols_table_enable_colstore(tb, TRUE);
+			break;
+		case 'k':
+			sortkey = 1;
+			break;
+		case 'N':
+			nosort = 1;
+			break;
+		case 's':
+			scols_table_enable_streaming(tb, TRUE);
+			nosort = 1;
+			break;
+		case 'T':
+			treesz = strtou32_or_err(optarg, "failed to parse tree size");
+			nosort = 1;
+			break;
+		case 'J':
+			scols_table_enable_json(tb, TRUE);
+			scols_table_set_name(tb, "benchmark");
+			break;
+		case 'r':
+			scols_table_enable_raw(tb, TRUE);
+			break;
+		case 'o':
+			outname = optarg;
+			break;
+		case 'h':
+			usage();
+		default:
+			errtryhelp(EXIT_FAILURE);
+		}
+	}
+
+	if (!ncols)
+		errx(EXIT_FAILURE, "--ncolumns must be greater than zero");
+
+	out = fopen(outname, "w" UL_CLOEXECSTR);
+	if (!out)
+		err(EXIT_FAILURE, "%s: open failed", outname);
+	scols_table_set_stream(tb, out);
+
+	for (i = 0; i < ncols; i++) {
+		char name[32];
+		struct libscols_column *cl;
+
+		snprintf(name, sizeof(name), "COL%zu", i);
+		cl = scols_table_new_column(tb, name, 0,
+				i == 0 && treesz ? SCOLS_FL_TREE : 0);
+		if (!cl)
+			err(EXIT_FAILURE, "failed to create output column");
+		if (i == 0) {
+			/* numbers, sorted by keys or as strings */
+			if (sortkey)
+				scols_column_set_sortkey_type(cl, SCOLS_SORTKEY_U64);
+			else
+				scols_column_set_cmpfunc(cl, scols_cmpstr_cells, NULL);
+			sortcl = cl;
+		}
+	}
+
+	t0 = now();
+	for (n = 0; n < nlines; n++) {
+		struct libscols_line *ln;
+
+		/* trees of @treesz lines, about every 4th line is a sibling of
+		 * the previous line parent, others are nested */
+		if (treesz && n % treesz) {
+			struct libscols_line *parent = prev;
+
+			if (next_random(&seed) % 4 == 0
+			    && scols_line_get_parent(prev)
+			    && scols_line_get_parent(scols_line_get_parent(prev)))
+				parent = scols_line_get_parent(scols_line_get_parent(prev));
+			ln = scols_table_new_line(tb, parent);
+		} else
+			ln = scols_table_new_line(tb, NULL);
+		if (!ln)
+			err(EXIT_FAILURE, "failed to create output line");
+		prev = ln;
+
+		for (i = 0; i < ncols; i++) {
+			char buf[64];
+
+			if (i == 0) {
+				unsigned int num = next_random(&seed) << 15 | next_random(&seed);
+
+				snprintf(buf, sizeof(buf), "%u", num);
+				if (scols_line_set_data(ln, i, buf))
+					err(EXIT_FAILURE, "failed to set data");
+				scols_cell_set_sortkey_u64(scols_line_get_cell(ln, i), num);
+				continue;
+			}
+			snprintf(buf, sizeof(buf), "%s-%u",
+				words[next_random(&seed) % ARRAY_SIZE(words)],
+				next_random(&seed));
+			if (scols_line_set_data(ln, i, buf))
+				err(EXIT_FAILURE, "failed to set data");
+		}
+	}
+	t1 = now();
+	printf("fill:  %8.3f s (%zu lines, %zu columns)\n", t1 - t0, nlines, ncols);
+
+	if (sortcl && !nosort) {
+		t0 = now();
+		if (scols_sort_table(tb, sortcl))
+			err(EXIT_FAILURE, "failed to sort table");
+		t1 = now();
+		printf("sort:  %8.3f s\n", t1 - t0);
+	}
+
+	t0 = now();
+	scols_print_table(tb);
+	fflush(out);
+	t1 = now();
+	printf("print: %8.3f s\n", t1 - t0);
+
+	t0 = now();
+	scols_unref_table(tb);
+	t1 = now();
+	printf("free:  %8.3f s\n", t1 - t0);
+
+	if (close_stream(out) != 0)
+		err(EXIT_FAILURE, "%s: write failed", outname);
+	return EXIT_SUCCESS;
+}
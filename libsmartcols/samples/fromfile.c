@@ -107,9 +107,17 @@ static struct libscols_column *parse_column(FILE *f)
 			break;
 		}
 		case 3: /* COLOR */
-			if (scols_column_set_color(cl, line))
+			if (*line && scols_column_set_color(cl, line))
 				goto fail;
 			break;
+		case 4: /* JSON TYPE */
+			if (strcmp(line, "number") == 0)
+				scols_column_set_json_type(cl, SCOLS_JSON_NUMBER);
+			else if (strcmp(line, "boolean") == 0)
+				scols_column_set_json_type(cl, SCOLS_JSON_BOOLEAN);
+			else if (strcmp(line, "array-string") == 0)
+				scols_column_set_json_type(cl, SCOLS_JSON_ARRAY_STRING);
+			break;
 		default:
 			break;
 		}
@@ -205,12 +213,14 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(" -c, --column <file>            column definition\n", out);
 	fputs(" -n, --nlines <num>             number of lines\n", out);
 	fputs(" -J, --json                     JSON output format\n", out);
+	fputs(" -B, --cbor                     CBOR (binary JSON) output format\n", out);
 	fputs(" -r, --raw                      RAW output format\n", out);
 	fputs(" -E, --export                   use key=\"value\" output format\n", out);
 	fputs(" -C, --colsep <str>             set columns separator\n", out);
 	fputs(" -w, --width <num>              hardcode terminal width\n", out);
 	fputs(" -p, --tree-parent-column <n>   parent column\n", out);
 	fputs(" -i, --tree-id-column <n>       id column\n", out);
+	fputs(" -S, --colstore                 use column store for cells\n", out);
 	fputs(" -h, --help                     this help\n", out);
 	fputs("\n", out);
 
@@ -232,15 +242,17 @@ int main(int argc, char *argv[])
 		{ "tree-parent-column", 1, NULL, 'p' },
 		{ "tree-id-column",	1, NULL, 'i' },
 		{ "json",   0, NULL, 'J' },
+		{ "cbor",   0, NULL, 'B' },
 		{ "raw",    0, NULL, 'r' },
 		{ "export", 0, NULL, 'E' },
 		{ "colsep",  1, NULL, 'C' },
+		{ "colstore", 0, NULL, 'S' },
 		{ "help",   0, NULL, 'h' },
 		{ NULL, 0, NULL, 0 },
 	};
 
 	static const ul_excl_t excl[] = {       /* rows and cols in ASCII order */
-		{ 'E', 'J', 'r' },
+		{ 'B', 'E', 'J', 'r' },
 		{ 'M', 'm' },
 		{ 0 }
 	};
@@ -253,7 +265,7 @@ int main(int argc, char *argv[])
 	if (!tb)
 		err(EXIT_FAILURE, "failed to create output table");
 
-	while((c = getopt_long(argc, argv, "hCc:Ei:JMmn:p:rw:", longopts, NULL)) != -1) {
+	while((c = getopt_long(argc, argv, "BhCc:Ei:JMmn:p:rSw:", longopts, NULL)) != -1) {
 
 		err_exclusive_options(c, longopts, excl, excl_st);
 
@@ -282,6 +294,10 @@ int main(int argc, char *argv[])
 			scols_table_enable_json(tb, 1);
 			scols_table_set_name(tb, "testtable");
 			break;
+		case 'B':
+			scols_table_enable_cbor(tb, 1);
+			scols_table_set_name(tb, "testtable");
+			break;
 		case 'm':
 			scols_table_enable_maxout(tb, TRUE);
 			break;
@@ -297,6 +313,10 @@ int main(int argc, char *argv[])
 		case 'C':
 			scols_table_set_column_separator(tb, optarg);
 			break;
+		case 'S':
+			if (scols_table_enable_colstore(tb, TRUE))
+				err(EXIT_FAILURE, "failed to enable column store");
+			break;
 		case 'n':
 			nlines = strtou32_or_err(optarg, "failed to parse number of lines");
 			break;
@@ -32,6 +32,51 @@ static void dbg_columns(struct libscols_table *tb)
 		dbg_column(tb, cl);
 }
 
+/*
+ * Returns width of the cell data. The width is cached in the cell and
+ * invalidated when the data are modified, so for tables printed repeatedly
+ * (e.g. irqtop) only the changed cells are counted.
+ */
+static size_t cell_data_width(struct libscols_table *tb,
+			      struct libscols_cell *ce)
+{
+	int noenc = scols_table_is_noencoding(tb) ? 1 : 0;
+
+	if (!ce->has_width || ce->width_noenc != noenc) {
+		size_t len;
+
+		if (!ce->data)
+			len = 0;
+		else if (noenc)
+			len = mbs_width(ce->data);
+		else
+			len = mbs_safe_width(ce->data);
+
+		if (len == (size_t) -1)	/* ignore broken multibyte strings */
+			len = 0;
+		ce->width = len;
+		ce->width_noenc = noenc;
+		ce->has_width = 1;
+	}
+	return ce->width;
+}
+
+/* returns 1 if the width is ignored as extreme */
+static int count_width(struct libscols_column *cl, size_t len)
+{
+	cl->width_max = max(len, cl->width_max);
+
+	if (cl->is_extreme && cl->width_avg && len > cl->width_avg * 2)
+		return 1;
+
+	if (scols_column_is_noextremes(cl)) {
+		cl->extreme_sum += len;
+		cl->extreme_count++;
+	}
+	cl->width = max(len, cl->width);
+	return 0;
+}
+
 static int count_cell_width(struct libscols_table *tb,
 		struct libscols_line *ln,
 		struct libscols_column *cl,
@@ -41,6 +86,14 @@ static int count_cell_width(struct libscols_table *tb,
 	char *data;
 	int rc;
 
+	/* the buffer is the same as cell data for standard columns */
+	if (!scols_column_is_tree(cl) && !scols_column_is_customwrap(cl)) {
+		struct libscols_cell *ce = scols_line_get_cell(ln, cl->seqnum);
+
+		count_width(cl, ce ? cell_data_width(tb, ce) : 0);
+		return 0;
+	}
+
 	rc = __cell_to_buffer(tb, ln, cl, buf);
 	if (rc)
 		return rc;
@@ -57,16 +110,9 @@ static int count_cell_width(struct libscols_table *tb,
 
 	if (len == (size_t) -1)		/* ignore broken multibyte strings */
 		len = 0;
-	cl->width_max = max(len, cl->width_max);
-
-	if (cl->is_extreme && cl->width_avg && len > cl->width_avg * 2)
+	if (count_width(cl, len))
 		return 0;
 
-	if (scols_column_is_noextremes(cl)) {
-		cl->extreme_sum += len;
-		cl->extreme_count++;
-	}
-	cl->width = max(len, cl->width);
 	if (scols_column_is_tree(cl)) {
 		size_t treewidth = ul_buffer_get_safe_pointer_width(buf, SCOLS_BUFPTR_TREEEND);
 		cl->width_treeart = max(cl->width_treeart, treewidth);
@@ -74,6 +120,33 @@ static int count_cell_width(struct libscols_table *tb,
 	return 0;
 }
 
+/*
+ * Count width for list from column store. All the cells of the column are in
+ * contiguous memory, and for non-tree columns the cell data is the same as
+ * __cell_to_buffer() output, so we don't need to walk the lines and copy
+ * the data to the buffer.
+ */
+static int colstore_count_column_width(struct libscols_table *tb,
+			      struct libscols_column *cl)
+{
+	struct libscols_cell *ce;
+	size_t row = 0;
+
+	while ((ce = scols_colstore_next_cell(tb->colstore, cl->seqnum, &row)))
+		count_width(cl, cell_data_width(tb, ce));
+	return 0;
+}
+
+static int has_colstore_cells(struct libscols_table *tb,
+			      struct libscols_column *cl)
+{
+	return tb->colstore
+		&& !scols_table_is_tree(tb)
+		&& !scols_column_is_tree(cl)
+		&& !scols_column_is_customwrap(cl)
+		&& cl->seqnum < tb->colstore->ncols
+		&& tb->colstore->nactive == tb->nlines;
+}
 
 static int walk_count_cell_width(struct libscols_table *tb,
 		struct libscols_line *ln,
@@ -128,6 +201,10 @@ static int count_column_width(struct libscols_table *tb,
 		rc = scols_walk_tree(tb, cl, walk_count_cell_width, (void *) buf);
 		if (rc)
 			goto done;
+	} else if (has_colstore_cells(tb, cl)) {
+		rc = colstore_count_column_width(tb, cl);
+		if (rc)
+			goto done;
 	} else {
 		/* Count width for list */
 		struct libscols_iter itr;
@@ -183,6 +260,47 @@ done:
 /*
  * This is core of the scols_* voodoo...
  */
+static int count_column_job(size_t job, void *data)
+{
+	struct libscols_column **cols = (struct libscols_column **) data;
+
+	/* the buffer is not used for list non-tree columns */
+	return count_column_width(cols[job]->table, cols[job], NULL);
+}
+
+/*
+ * Counts width of the columns by more threads. The columns which use the
+ * buffer or walk the tree are counted later by __scols_calculate() as usual.
+ */
+static void parallel_count_columns(struct libscols_table *tb, size_t nthreads)
+{
+	struct libscols_column **cols, *cl;
+	struct libscols_iter itr;
+	size_t i, n = 0;
+
+	if (scols_table_is_tree(tb))
+		return;
+
+	cols = malloc(tb->ncols * sizeof(struct libscols_column *));
+	if (!cols)
+		return;
+
+	scols_reset_iter(&itr, SCOLS_ITER_FORWARD);
+	while (scols_table_next_column(tb, &itr, &cl) == 0) {
+		if (scols_column_is_hidden(cl)
+		    || scols_column_is_tree(cl)
+		    || scols_column_is_customwrap(cl))
+			continue;
+		cols[n++] = cl;
+	}
+
+	if (n > 1 && __scols_parallel_run(nthreads, n, count_column_job, cols) == 0) {
+		for (i = 0; i < n; i++)
+			cols[i]->is_counted = 1;
+	}
+	free(cols);
+}
+
 int __scols_calculate(struct libscols_table *tb, struct ul_buffer *buf)
 {
 	struct libscols_column *cl;
@@ -190,7 +308,7 @@ int __scols_calculate(struct libscols_table *tb, struct ul_buffer *buf)
 	size_t width = 0, width_min = 0;	/* output width */
 	int stage, rc = 0;
 	int extremes = 0, group_ncolumns = 0;
-	size_t colsepsz;
+	size_t colsepsz, nthreads;
 
 
 	DBG(TAB, ul_debugobj(tb, "-----calculate-(termwidth=%zu)-----", tb->termwidth));
@@ -203,6 +321,10 @@ int __scols_calculate(struct libscols_table *tb, struct ul_buffer *buf)
 	if (has_groups(tb))
 		group_ncolumns = 1;
 
+	nthreads = __scols_table_nthreads(tb);
+	if (nthreads > 1)
+		parallel_count_columns(tb, nthreads);
+
 	/* set basic columns width
 	 */
 	scols_reset_iter(&itr, SCOLS_ITER_FORWARD);
@@ -218,9 +340,13 @@ int __scols_calculate(struct libscols_table *tb, struct ul_buffer *buf)
 			group_ncolumns++;
 		}
 
-		rc = count_column_width(tb, cl, buf);
-		if (rc)
-			goto done;
+		if (cl->is_counted)
+			cl->is_counted = 0;
+		else {
+			rc = count_column_width(tb, cl, buf);
+			if (rc)
+				goto done;
+		}
 
 		is_last = is_last_column(cl);
 
@@ -452,3 +578,42 @@ done:
 
 	return rc;
 }
+
+/*
+ * Sets the columns width for streaming mode, where the lines are not known
+ * in advance. The width is the column width hint or the header width.
+ */
+void __scols_calculate_fixed(struct libscols_table *tb)
+{
+	struct libscols_column *cl;
+	struct libscols_iter itr;
+
+	DBG(TAB, ul_debugobj(tb, "-----calculate fixed-----"));
+
+	scols_reset_iter(&itr, SCOLS_ITER_FORWARD);
+	while (scols_table_next_column(tb, &itr, &cl) == 0) {
+		const char *data = scols_cell_get_data(&cl->header);
+		size_t len = 0;
+
+		if (scols_column_is_hidden(cl))
+			continue;
+
+		if (data && !scols_table_is_noheadings(tb))
+			len = scols_table_is_noencoding(tb) ?
+					mbs_width(data) : mbs_safe_width(data);
+
+		if (cl->width_hint >= 1)
+			cl->width = (size_t) cl->width_hint;
+		else if (cl->width_hint > 0)
+			cl->width = (size_t) (cl->width_hint * scols_table_get_termwidth(tb));
+		else
+			cl->width = 0;
+
+		cl->width = max(cl->width, len);
+		if (!cl->width)
+			cl->width = 1;
+		cl->width_min = cl->width;
+
+		ON_DBG(COL, dbg_column(tb, cl));
+	}
+}
@@ -45,7 +45,8 @@ int scols_reset_cell(struct libscols_cell *ce)
 		return -EINVAL;
 
 	/*DBG(CELL, ul_debugobj(ce, "reset"));*/
-	free(ce->data);
+	if (!ce->is_arena)
+		free(ce->data);
 	free(ce->color);
 	memset(ce, 0, sizeof(*ce));
 	return 0;
@@ -62,6 +63,18 @@ int scols_reset_cell(struct libscols_cell *ce)
  */
 int scols_cell_set_data(struct libscols_cell *ce, const char *data)
 {
+	if (!ce)
+		return -EINVAL;
+
+	/* unchanged data, keep the cached width */
+	if (data && ce->data && strcmp(ce->data, data) == 0)
+		return 0;
+
+	ce->has_width = 0;
+	if (ce->is_arena) {
+		ce->data = NULL;	/* owned by column store */
+		ce->is_arena = 0;
+	}
 	return strdup_to_struct_member(ce, data, data);
 }
 
@@ -81,8 +94,11 @@ int scols_cell_refer_data(struct libscols_cell *ce, char *data)
 {
 	if (!ce)
 		return -EINVAL;
-	free(ce->data);
+	if (!ce->is_arena)
+		free(ce->data);
 	ce->data = data;
+	ce->is_arena = 0;
+	ce->has_width = 0;
 	return 0;
 }
 
@@ -155,6 +171,101 @@ int scols_cmpstr_cells(struct libscols_cell *a,
 	return strcmp(adata, bdata);
 }
 
+/**
+ * scols_cell_set_sortkey_u64:
+ * @ce: a pointer to a struct libscols_cell instance
+ * @num: sort key
+ *
+ * Sets the number used to sort the table by the column with the
+ * SCOLS_SORTKEY_U64 sort key type, see scols_column_set_sortkey_type(). The
+ * key is independent on the cell data and it is not printed. The cells
+ * without the key are ordered before the other cells.
+ *
+ * Returns: 0, a negative value in case of an error.
+ *
+ * Since: 2.39
+ */
+int scols_cell_set_sortkey_u64(struct libscols_cell *ce, uint64_t num)
+{
+	if (!ce)
+		return -EINVAL;
+	ce->sortkey.u64 = num;
+	ce->has_sortkey = 1;
+	return 0;
+}
+
+/**
+ * scols_cell_set_sortkey_s64:
+ * @ce: a pointer to a struct libscols_cell instance
+ * @num: sort key
+ *
+ * The same as scols_cell_set_sortkey_u64(), but for SCOLS_SORTKEY_S64 columns.
+ *
+ * Returns: 0, a negative value in case of an error.
+ *
+ * Since: 2.39
+ */
+int scols_cell_set_sortkey_s64(struct libscols_cell *ce, int64_t num)
+{
+	if (!ce)
+		return -EINVAL;
+	ce->sortkey.s64 = num;
+	ce->has_sortkey = 1;
+	return 0;
+}
+
+/**
+ * scols_cell_set_sortkey_double:
+ * @ce: a pointer to a struct libscols_cell instance
+ * @num: sort key
+ *
+ * The same as scols_cell_set_sortkey_u64(), but for SCOLS_SORTKEY_DOUBLE columns.
+ *
+ * Returns: 0, a negative value in case of an error.
+ *
+ * Since: 2.39
+ */
+int scols_cell_set_sortkey_double(struct libscols_cell *ce, double num)
+{
+	if (!ce)
+		return -EINVAL;
+	ce->sortkey.dbl = num;
+	ce->has_sortkey = 1;
+	return 0;
+}
+
+/*
+ * Compares cells by sort keys of the @type (SCOLS_SORTKEY_*). The cells
+ * without the key (or data for SCOLS_SORTKEY_STRING) are ordered first.
+ */
+int __scols_cmp_sortkeys(int type, struct libscols_cell *a, struct libscols_cell *b)
+{
+	int ahas, bhas;
+
+	if (type == SCOLS_SORTKEY_STRING) {
+		ahas = a && a->data;
+		bhas = b && b->data;
+	} else {
+		ahas = a && a->has_sortkey;
+		bhas = b && b->has_sortkey;
+	}
+
+	if (!ahas || !bhas)
+		return ahas - bhas;
+
+	switch (type) {
+	case SCOLS_SORTKEY_U64:
+		return cmp_numbers(a->sortkey.u64, b->sortkey.u64);
+	case SCOLS_SORTKEY_S64:
+		return cmp_numbers(a->sortkey.s64, b->sortkey.s64);
+	case SCOLS_SORTKEY_DOUBLE:
+		return cmp_numbers(a->sortkey.dbl, b->sortkey.dbl);
+	case SCOLS_SORTKEY_STRING:
+		return strcoll(a->data, b->data);
+	}
+	return 0;
+}
+
 /**
  * scols_cell_set_color:
  * @ce: a pointer to a struct libscols_cell instance
@@ -249,8 +360,11 @@ int scols_cell_copy_content(struct libscols_cell *dest,
 	rc = scols_cell_set_data(dest, scols_cell_get_data(src));
 	if (!rc)
 		rc = scols_cell_set_color(dest, scols_cell_get_color(src));
-	if (!rc)
+	if (!rc) {
 		dest->userdata = src->userdata;
+		dest->sortkey = src->sortkey;
+		dest->has_sortkey = src->has_sortkey;
+	}
 
 	DBG(CELL, ul_debugobj(src, "copy"));
 	return rc;
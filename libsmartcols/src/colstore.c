@@ -0,0 +1,384 @@
+/*
+ * colstore.c - column-major cells storage
+ *
+ * This file may be redistributed under the terms of the
+ * GNU Lesser General Public License.
+ */
+
+/*
+ * The column store is optional table storage for lines cells, see
+ * scols_table_enable_colstore(). The cells are not allocated for each line
+ * separately, but in large per-column chunks, so all cells of the column are
+ * in contiguous memory. The cells data added by scols_line_set_data() are
+ * copied to the string arena rather than allocated by strdup().
+ *
+ * The store is reference counted. The table and all lines with cells in the
+ * store hold the reference, so lines could be used after the table is
+ * deallocated. The row of the deallocated line is reused by the next new
+ * line. The memory used by the arena strings is released when all rows are
+ * free, or when the store is deallocated.
+ *
+ * The strings of the replaced or reset cells are not released from the arena
+ * immediately. The arena is compacted (the strings still used by cells are
+ * copied to a new arena) when it has to grow and its size is twice the size
+ * after the last compaction, so the unused strings never use more than half
+ * of the arena and the copying cost is amortized.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "smartcolsP.h"
+
+#define SCOLS_ARENA_CHUNKSZ	(32 * 1024)
+
+struct colstore_arena {
+	struct colstore_arena	*next;
+	size_t			size;		/* size of data[] */
+	size_t			used;		/* used bytes in data[] */
+	char			data[];
+};
+
+static void colstore_free_arena(struct libscols_colstore *cs)
+{
+	struct colstore_arena *ar = cs->arena;
+
+	while (ar) {
+		struct colstore_arena *next = ar->next;
+
+		free(ar);
+		ar = next;
+	}
+	cs->arena = NULL;
+	cs->arena_size = 0;
+	cs->arena_limit = 0;
+}
+
+struct libscols_colstore *scols_new_colstore(size_t ncols)
+{
+	struct libscols_colstore *cs = calloc(1, sizeof(*cs));
+
+	if (!cs)
+		return NULL;
+
+	cs->refcount = 1;
+	if (ncols && scols_colstore_alloc_columns(cs, ncols) != 0) {
+		free(cs);
+		return NULL;
+	}
+
+	DBG(TAB, ul_debugobj(cs, "alloc column store"));
+	return cs;
+}
+
+void scols_ref_colstore(struct libscols_colstore *cs)
+{
+	if (cs)
+		cs->refcount++;
+}
+
+void scols_unref_colstore(struct libscols_colstore *cs)
+{
+	size_t i, x;
+
+	if (!cs || --cs->refcount > 0)
+		return;
+
+	DBG(TAB, ul_debugobj(cs, "dealloc column store [rows=%zu, cols=%zu]",
+				cs->nrows, cs->ncols));
+
+	for (i = 0; i < cs->ncols; i++) {
+		for (x = 0; x < cs->nchunks; x++)
+			free(cs->cols[i][x]);
+		free(cs->cols[i]);
+	}
+	free(cs->cols);
+	free(cs->active);
+	free(cs->freerows);
+
+	colstore_free_arena(cs);
+	free(cs);
+}
+
+/* allocates chunks for all rows for the columns <cs->ncols, @ncols) */
+int scols_colstore_alloc_columns(struct libscols_colstore *cs, size_t ncols)
+{
+	struct libscols_cell ***cols;
+	size_t i, x;
+
+	if (ncols <= cs->ncols)
+		return 0;
+
+	cols = realloc(cs->cols, ncols * sizeof(struct libscols_cell **));
+	if (!cols)
+		return -ENOMEM;
+	cs->cols = cols;
+
+	for (i = cs->ncols; i < ncols; i++) {
+		cols[i] = calloc(cs->nchunks ? : 1, sizeof(struct libscols_cell *));
+		if (!cols[i])
+			return -ENOMEM;
+		for (x = 0; x < cs->nchunks; x++) {
+			cols[i][x] = calloc(SCOLS_COLSTORE_CHUNK, sizeof(struct libscols_cell));
+			if (!cols[i][x]) {
+				while (x > 0)
+					free(cols[i][--x]);
+				free(cols[i]);
+				return -ENOMEM;
+			}
+		}
+		cs->ncols = i + 1;
+	}
+
+	DBG(TAB, ul_debugobj(cs, "column store: %zu columns", cs->ncols));
+	return 0;
+}
+
+/* adds SCOLS_COLSTORE_CHUNK rows to all columns */
+static int colstore_add_chunk(struct libscols_colstore *cs)
+{
+	size_t i, n = cs->nchunks + 1, *freerows;
+	char *active;
+
+	active = realloc(cs->active, n * SCOLS_COLSTORE_CHUNK);
+	if (!active)
+		return -ENOMEM;
+	memset(active + cs->nchunks * SCOLS_COLSTORE_CHUNK, 0, SCOLS_COLSTORE_CHUNK);
+	cs->active = active;
+
+	/* allocated for all rows, so scols_colstore_remove_line() cannot fail */
+	freerows = realloc(cs->freerows, n * SCOLS_COLSTORE_CHUNK * sizeof(size_t));
+	if (!freerows)
+		return -ENOMEM;
+	cs->freerows = freerows;
+
+	for (i = 0; i < cs->ncols; i++) {
+		struct libscols_cell **chunks;
+
+		chunks = realloc(cs->cols[i], n * sizeof(struct libscols_cell *));
+		if (!chunks)
+			return -ENOMEM;
+		cs->cols[i] = chunks;
+
+		chunks[cs->nchunks] = calloc(SCOLS_COLSTORE_CHUNK, sizeof(struct libscols_cell));
+		if (!chunks[cs->nchunks])
+			goto err;
+	}
+
+	cs->nchunks = n;
+	return 0;
+err:
+	while (i > 0)
+		free(cs->cols[--i][cs->nchunks]);
+	return -ENOMEM;
+}
+
+/*
+ * Allocates a new row in the store for the line and sets the line number of
+ * cells to @ncells.
+ */
+int scols_colstore_add_line(struct libscols_colstore *cs,
+			    struct libscols_line *ln, size_t ncells)
+{
+	int rc;
+
+	assert(cs);
+	assert(ln);
+	assert(!ln->cells);
+	assert(!ln->store);
+
+	rc = scols_colstore_alloc_columns(cs, ncells);
+	if (rc)
+		return rc;
+
+	if (cs->nfree)
+		ln->storerow = cs->freerows[--cs->nfree];
+	else {
+		if (cs->nrows == cs->nchunks * SCOLS_COLSTORE_CHUNK) {
+			rc = colstore_add_chunk(cs);
+			if (rc)
+				return rc;
+		}
+		ln->storerow = cs->nrows++;
+	}
+	ln->ncells = ncells;
+	ln->store = cs;
+	scols_ref_colstore(cs);
+	return 0;
+}
+
+/*
+ * Releases the line row for reuse. The line cells are expected to be already
+ * reset by scols_reset_cell(); the cells of the columns added after the line
+ * cells allocation have never been used.
+ */
+void scols_colstore_remove_line(struct libscols_colstore *cs,
+				struct libscols_line *ln)
+{
+	assert(cs);
+	assert(ln->store == cs);
+
+	scols_colstore_set_active(cs, ln, 0);
+	cs->freerows[cs->nfree++] = ln->storerow;
+
+	if (cs->nfree == cs->nrows) {
+		/* all lines deallocated, start from the first row and
+		 * release the strings */
+		DBG(TAB, ul_debugobj(cs, "column store: all %zu rows free", cs->nrows));
+		cs->nfree = cs->nrows = 0;
+		colstore_free_arena(cs);
+	}
+}
+
+/* marks line row as a member of the table (used by scols_colstore_next_cell()) */
+void scols_colstore_set_active(struct libscols_colstore *cs,
+			       struct libscols_line *ln, int enable)
+{
+	if (!cs || ln->store != cs || !!cs->active[ln->storerow] == !!enable)
+		return;
+
+	cs->active[ln->storerow] = enable ? 1 : 0;
+	if (enable)
+		cs->nactive++;
+	else
+		cs->nactive--;
+}
+
+/*
+ * Iterates over cells of the column @colnum in rows used by table lines. The
+ * @row is the current position, initialize it to zero.
+ *
+ * Returns: cell or NULL at the end.
+ */
+struct libscols_cell *scols_colstore_next_cell(struct libscols_colstore *cs,
+					       size_t colnum, size_t *row)
+{
+	while (*row < cs->nrows) {
+		size_t n = (*row)++;
+
+		if (cs->active[n])
+			return &cs->cols[colnum][n / SCOLS_COLSTORE_CHUNK]
+						[n % SCOLS_COLSTORE_CHUNK];
+	}
+	return NULL;
+}
+
+/* copies @str to the arena memory, never compacts the arena */
+static char *colstore_arena_strdup(struct libscols_colstore *cs, const char *str)
+{
+	struct colstore_arena *ar = cs->arena;
+	size_t len = strlen(str) + 1;
+	char *p;
+
+	if (!ar || ar->size - ar->used < len) {
+		size_t sz = max((size_t) SCOLS_ARENA_CHUNKSZ, len);
+
+		ar = malloc(sizeof(*ar) + sz);
+		if (!ar)
+			return NULL;
+		ar->size = sz;
+		ar->used = 0;
+		ar->next = cs->arena;
+		cs->arena = ar;
+		cs->arena_size += sz;
+	}
+
+	p = memcpy(ar->data + ar->used, str, len);
+	ar->used += len;
+	return p;
+}
+
+/*
+ * Copies the strings used by the cells of the allocated rows to a new arena
+ * and releases the old arena. On error the old arena is kept (linked after
+ * the new one), so all the cells are still valid.
+ */
+static int colstore_compact_arena(struct libscols_colstore *cs)
+{
+	struct colstore_arena *old = cs->arena, *ar;
+	size_t oldsz = cs->arena_size, r, i;
+	char *isfree;
+	int rc = 0;
+
+	isfree = calloc(cs->nrows ? : 1, sizeof(char));
+	if (!isfree)
+		return -ENOMEM;
+	for (r = 0; r < cs->nfree; r++)
+		isfree[cs->freerows[r]] = 1;
+
+	cs->arena = NULL;
+	cs->arena_size = 0;
+
+	for (r = 0; rc == 0 && r < cs->nrows; r++) {
+		if (isfree[r])
+			continue;
+		for (i = 0; i < cs->ncols; i++) {
+			struct libscols_cell *ce = scols_colstore_get_cell(cs, i, r);
+			char *p;
+
+			if (!ce->is_arena || !ce->data)
+				continue;
+			p = colstore_arena_strdup(cs, ce->data);
+			if (!p) {
+				rc = -ENOMEM;
+				break;
+			}
+			ce->data = p;
+		}
+	}
+	free(isfree);
+
+	if (rc) {
+		for (ar = cs->arena; ar && ar->next; ar = ar->next);
+		if (ar)
+			ar->next = old;
+		else
+			cs->arena = old;
+		cs->arena_size += oldsz;
+		return rc;
+	}
+
+	DBG(TAB, ul_debugobj(cs, "column store: arena compacted %zu -> %zu bytes",
+				oldsz, cs->arena_size));
+	while (old) {
+		ar = old->next;
+		free(old);
+		old = ar;
+	}
+	return 0;
+}
+
+/* copies @str to the arena memory */
+static char *colstore_strdup(struct libscols_colstore *cs, const char *str)
+{
+	struct colstore_arena *ar = cs->arena;
+
+	if (ar && ar->size - ar->used < strlen(str) + 1
+	    && cs->arena_size >= cs->arena_limit) {
+		colstore_compact_arena(cs);
+		cs->arena_limit = max((size_t) SCOLS_ARENA_CHUNKSZ, cs->arena_size) * 2;
+	}
+	return colstore_arena_strdup(cs, str);
+}
+
+/* like scols_cell_set_data(), but the copy of @data is in the arena */
+int scols_colstore_set_data(struct libscols_colstore *cs,
+			    struct libscols_cell *ce, const char *data)
+{
+	char *p = NULL;
+
+	/* unchanged data, keep the cached width and don't waste the arena */
+	if (data && ce->data && strcmp(ce->data, data) == 0)
+		return 0;
+
+	ce->has_width = 0;
+	if (data) {
+		p = colstore_strdup(cs, data);
+		if (!p)
+			return -ENOMEM;
+	}
+	if (!ce->is_arena)
+		free(ce->data);
+	ce->data = p;
+	ce->is_arena = p ? 1 : 0;
+	return 0;
+}
@@ -195,6 +195,44 @@ int scols_column_set_json_type(struct libscols_column *cl, int type)
 
 }
 
+/**
+ * scols_column_set_sortkey_type:
+ * @cl: a pointer to a struct libscols_column instance
+ * @type: SCOLS_SORTKEY_* type
+ *
+ * Sets the type of the sort keys. If the type is not SCOLS_SORTKEY_NONE, then
+ * scols_sort_table() ignores the function specified by
+ * scols_column_set_cmpfunc() and compares the keys set by
+ * scols_cell_set_sortkey_u64() (or _s64 and _double) without callbacks. The
+ * SCOLS_SORTKEY_STRING sorts the cell data according to the current locale
+ * collation.
+ *
+ * Returns: 0, a negative value in case of an error.
+ *
+ * Since: 2.39
+ */
+int scols_column_set_sortkey_type(struct libscols_column *cl, int type)
+{
+	if (!cl || type < SCOLS_SORTKEY_NONE || type > SCOLS_SORTKEY_STRING)
+		return -EINVAL;
+
+	cl->sortkey_type = type;
+	return 0;
+}
+
+/**
+ * scols_column_get_sortkey_type:
+ * @cl: a pointer to a struct libscols_column instance
+ *
+ * Returns: SCOLS_SORTKEY_* type or a negative value in case of an error.
+ *
+ * Since: 2.39
+ */
+int scols_column_get_sortkey_type(const struct libscols_column *cl)
+{
+	return cl ? cl->sortkey_type : -EINVAL;
+}
+
 /**
  * scols_column_get_json_type:
  * @cl: a pointer to a struct libscols_column instance
@@ -95,14 +95,19 @@ void scols_line_free_cells(struct libscols_line *ln)
 {
 	size_t i;
 
-	if (!ln || !ln->cells)
+	if (!ln || (!ln->cells && !ln->store))
 		return;
 
 	DBG(LINE, ul_debugobj(ln, "free cells"));
 
 	for (i = 0; i < ln->ncells; i++)
-		scols_reset_cell(&ln->cells[i]);
+		scols_reset_cell(scols_line_get_cell(ln, i));
 
+	if (ln->store) {
+		scols_colstore_remove_line(ln->store, ln);
+		scols_unref_colstore(ln->store);
+		ln->store = NULL;
+	}
 	free(ln->cells);
 	ln->ncells = 0;
 	ln->cells = NULL;
@@ -136,6 +141,21 @@ int scols_line_alloc_cells(struct libscols_line *ln, size_t n)
 
 	DBG(LINE, ul_debugobj(ln, "alloc %zu cells", n));
 
+	if (ln->store) {
+		/* cells in column store; unused columns are reset only */
+		size_t i;
+
+		if (n > ln->ncells) {
+			int rc = scols_colstore_alloc_columns(ln->store, n);
+			if (rc)
+				return rc;
+		}
+		for (i = n; i < ln->ncells; i++)
+			scols_reset_cell(scols_line_get_cell(ln, i));
+		ln->ncells = n;
+		return 0;
+	}
+
 	ce = realloc(ln->cells, n * sizeof(struct libscols_cell));
 	if (!ce)
 		return -errno;
@@ -152,6 +172,7 @@ int scols_line_alloc_cells(struct libscols_line *ln, size_t n)
 int scols_line_move_cells(struct libscols_line *ln, size_t newn, size_t oldn)
 {
 	struct libscols_cell ce;
+	size_t i;
 
 	if (!ln || newn >= ln->ncells || oldn >= ln->ncells)
 		return -EINVAL;
@@ -161,20 +182,24 @@ int scols_line_move_cells(struct libscols_line *ln, size_t newn, size_t oldn)
 	DBG(LINE, ul_debugobj(ln, "move cells[%zu] -> cells[%zu]", oldn, newn));
 
 	/* remember data from old position */
-	memcpy(&ce, &ln->cells[oldn], sizeof(struct libscols_cell));
-
-	/* remove old position (move data behind oldn to oldn) */
-	if (oldn + 1 < ln->ncells)
-		memmove(ln->cells + oldn, ln->cells + oldn + 1,
-			(ln->ncells - oldn - 1) * sizeof(struct libscols_cell));
-
-	/* create a space for new position */
-	if (newn + 1 < ln->ncells)
-		memmove(ln->cells + newn + 1, ln->cells + newn,
-			(ln->ncells - newn - 1) * sizeof(struct libscols_cell));
+	memcpy(&ce, scols_line_get_cell(ln, oldn), sizeof(struct libscols_cell));
+
+	/* shift cells between old and new position, the cells
+	 * do not have to be in contiguous memory (see colstore.c) */
+	if (oldn < newn) {
+		for (i = oldn; i < newn; i++)
+			memcpy(scols_line_get_cell(ln, i),
+			       scols_line_get_cell(ln, i + 1),
+			       sizeof(struct libscols_cell));
+	} else {
+		for (i = oldn; i > newn; i--)
+			memcpy(scols_line_get_cell(ln, i),
+			       scols_line_get_cell(ln, i - 1),
+			       sizeof(struct libscols_cell));
+	}
 
 	/* copy original data to new position */
-	memcpy(&ln->cells[newn], &ce, sizeof(struct libscols_cell));
+	memcpy(scols_line_get_cell(ln, newn), &ce, sizeof(struct libscols_cell));
 	return 0;
 }
 
@@ -406,6 +431,8 @@ struct libscols_cell *scols_line_get_cell(struct libscols_line *ln,
 {
 	if (!ln || n >= ln->ncells)
 		return NULL;
+	if (ln->store)
+		return scols_colstore_get_cell(ln->store, n, ln->storerow);
 	return &ln->cells[n];
 }
 
@@ -442,6 +469,8 @@ int scols_line_set_data(struct libscols_line *ln, size_t n, const char *data)
 
 	if (!ce)
 		return -EINVAL;
+	if (ln->store)
+		return scols_colstore_set_data(ln->store, ce, data);
 	return scols_cell_set_data(ce, data);
 }
 
@@ -549,7 +578,8 @@ struct libscols_line *scols_copy_line(const struct libscols_line *ln)
 	DBG(LINE, ul_debugobj(ln, "copy"));
 
 	for (i = 0; i < ret->ncells; ++i) {
-		if (scols_cell_copy_content(&ret->cells[i], &ln->cells[i]))
+		if (scols_cell_copy_content(scols_line_get_cell(ret, i),
+			    scols_line_get_cell((struct libscols_line *) ln, i)))
 			goto err;
 	}
 
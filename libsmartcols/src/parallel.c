@@ -0,0 +1,316 @@
+/*
+ * parallel.c - threads for tables with huge number of lines
+ *
+ * This file may be redistributed under the terms of the
+ * GNU Lesser General Public License.
+ */
+
+/*
+ * The table sort and the columns width calculation use more threads if the
+ * threads are enabled by scols_table_set_nthreads() or by the
+ * LIBSMARTCOLS_THREADS=<num>|auto environment variable and the table contains
+ * at least SCOLS_PARALLEL_MINLINES lines. The threads are disabled by
+ * default. The threads never modify the table or lines lists, every job works
+ * with its own part of the data only.
+ */
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef HAVE_LIBPTHREAD
+# include <pthread.h>
+#endif
+
+#include "smartcolsP.h"
+
+#define SCOLS_PARALLEL_MINLINES		50000
+#define SCOLS_PARALLEL_MAXTHREADS	8
+
+/*
+ * Returns number of threads to use for the table, 1 means serial processing.
+ */
+size_t __scols_table_nthreads(struct libscols_table *tb)
+{
+#ifdef HAVE_LIBPTHREAD
+	const char *str;
+	long n;
+
+	if (tb->nthreads == 1 || tb->nlines < SCOLS_PARALLEL_MINLINES)
+		return 1;
+	if (tb->nthreads)
+		return tb->nthreads;
+
+	str = getenv("LIBSMARTCOLS_THREADS");
+	if (!str || !*str)
+		return 1;
+	if (strcmp(str, "auto") != 0) {
+		char *end = NULL;
+		unsigned long x;
+
+		errno = 0;
+		x = strtoul(str, &end, 10);
+		if (errno || !end || *end || x < 2)
+			return 1;
+		return x;
+	}
+
+	n = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n < 2)
+		return 1;
+	return min((size_t) n, (size_t) SCOLS_PARALLEL_MAXTHREADS);
+#else
+	return 1;
+#endif
+}
+
+struct parallel_ctl {
+	size_t	njobs;
+	size_t	next;		/* the next job to run */
+	int	rc;		/* the first error */
+
+	int (*fn)(size_t, void *);
+	void	*data;
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_t	lock;
+#endif
+};
+
+static int parallel_next_job(struct parallel_ctl *ctl, size_t *job)
+{
+	int rc = 0;
+
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_lock(&ctl->lock);
+#endif
+	if (!ctl->rc && ctl->next < ctl->njobs) {
+		*job = ctl->next++;
+		rc = 1;
+	}
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_unlock(&ctl->lock);
+#endif
+	return rc;
+}
+
+static void *parallel_worker(void *data)
+{
+	struct parallel_ctl *ctl = (struct parallel_ctl *) data;
+	size_t job;
+
+	while (parallel_next_job(ctl, &job)) {
+		int rc = ctl->fn(job, ctl->data);
+
+		if (rc) {
+#ifdef HAVE_LIBPTHREAD
+			pthread_mutex_lock(&ctl->lock);
+#endif
+			if (!ctl->rc)
+				ctl->rc = rc;
+#ifdef HAVE_LIBPTHREAD
+			pthread_mutex_unlock(&ctl->lock);
+#endif
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Calls @fn for jobs 0..@njobs-1 by @nthreads threads (including the current
+ * thread). The order of the jobs is undefined.
+ *
+ * Returns: 0 or the first error returned by @fn.
+ */
+int __scols_parallel_run(size_t nthreads, size_t njobs,
+			 int (*fn)(size_t, void *), void *data)
+{
+	struct parallel_ctl ctl = {
+		.njobs = njobs,
+		.fn = fn,
+		.data = data
+	};
+#ifdef HAVE_LIBPTHREAD
+	pthread_t *threads = NULL;
+	size_t i, n = 0;
+
+	pthread_mutex_init(&ctl.lock, NULL);
+
+	if (nthreads > njobs)
+		nthreads = njobs;
+	if (nthreads > 1)
+		threads = calloc(nthreads - 1, sizeof(pthread_t));
+	if (threads) {
+		for (n = 0; n < nthreads - 1; n++) {
+			if (pthread_create(&threads[n], NULL, parallel_worker, &ctl) != 0)
+				break;
+		}
+	}
+	DBG(TAB, ul_debug("parallel: %zu jobs, %zu threads", njobs, n + 1));
+
+	parallel_worker(&ctl);
+
+	for (i = 0; i < n; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+	pthread_mutex_destroy(&ctl.lock);
+#else
+	parallel_worker(&ctl);
+#endif
+	return ctl.rc;
+}
+
+/*
+ * Parallel stable merge sort of the table lines
+ */
+struct sort_ctl {
+	struct libscols_column	*cl;
+	struct libscols_line	**src, **dst;
+
+	size_t	*runs;		/* sorted runs: runs[i] .. runs[i + 1] */
+	size_t	nruns;
+};
+
+static inline int cmp_lines(struct libscols_column *cl,
+			    struct libscols_line *a,
+			    struct libscols_line *b)
+{
+	return scols_cmp_column_cells(cl, scols_line_get_cell(a, cl->seqnum),
+				      scols_line_get_cell(b, cl->seqnum));
+}
+
+/* merges two sorted arrays @a and @b to @res, keeps order of equal items */
+static void merge_lines(struct libscols_column *cl,
+			struct libscols_line **a, size_t na,
+			struct libscols_line **b, size_t nb,
+			struct libscols_line **res)
+{
+	while (na && nb) {
+		if (cmp_lines(cl, *a, *b) <= 0) {
+			*res++ = *a++;
+			na--;
+		} else {
+			*res++ = *b++;
+			nb--;
+		}
+	}
+	if (na)
+		memcpy(res, a, na * sizeof(*a));
+	if (nb)
+		memcpy(res, b, nb * sizeof(*b));
+}
+
+static void sort_lines(struct libscols_column *cl,
+		       struct libscols_line **ary,
+		       struct libscols_line **tmp, size_t n)
+{
+	size_t m;
+
+	if (n < 8) {
+		/* insertion sort */
+		size_t i, j;
+
+		for (i = 1; i < n; i++) {
+			struct libscols_line *ln = ary[i];
+
+			for (j = i; j > 0 && cmp_lines(cl, ary[j - 1], ln) > 0; j--)
+				ary[j] = ary[j - 1];
+			ary[j] = ln;
+		}
+		return;
+	}
+
+	m = n / 2;
+	sort_lines(cl, ary, tmp, m);
+	sort_lines(cl, ary + m, tmp + m, n - m);
+
+	if (cmp_lines(cl, ary[m - 1], ary[m]) <= 0)
+		return;		/* already in order */
+
+	merge_lines(cl, ary, m, ary + m, n - m, tmp);
+	memcpy(ary, tmp, n * sizeof(*ary));
+}
+
+static int sort_run_job(size_t job, void *data)
+{
+	struct sort_ctl *ctl = (struct sort_ctl *) data;
+	size_t start = ctl->runs[job];
+
+	sort_lines(ctl->cl, ctl->src + start, ctl->dst + start,
+		   ctl->runs[job + 1] - start);
+	return 0;
+}
+
+static int merge_runs_job(size_t job, void *data)
+{
+	struct sort_ctl *ctl = (struct sort_ctl *) data;
+	size_t a = ctl->runs[job * 2],
+	       b = job * 2 + 1 < ctl->nruns ? ctl->runs[job * 2 + 1] : ctl->runs[ctl->nruns],
+	       end = job * 2 + 2 < ctl->nruns ? ctl->runs[job * 2 + 2] : ctl->runs[ctl->nruns];
+
+	merge_lines(ctl->cl, ctl->src + a, b - a, ctl->src + b, end - b, ctl->dst + a);
+	return 0;
+}
+
+/*
+ * Sorts the table lines by @nthreads threads. The lines are copied to an
+ * array, sorted in @nthreads runs, and the runs are merged in parallel.
+ */
+int __scols_parallel_sort_lines(struct libscols_table *tb,
+				struct libscols_column *cl,
+				size_t nthreads)
+{
+	struct libscols_line **ary, **tmp, *ln;
+	struct libscols_iter itr;
+	struct sort_ctl ctl = { .cl = cl };
+	size_t i, n = 0, nlines = tb->nlines;
+	int rc = -ENOMEM;
+
+	ary = malloc(nlines * sizeof(*ary));
+	tmp = malloc(nlines * sizeof(*tmp));
+	ctl.runs = malloc((nthreads + 1) * sizeof(size_t));
+	if (!ary || !tmp || !ctl.runs)
+		goto done;
+
+	scols_reset_iter(&itr, SCOLS_ITER_FORWARD);
+	while (n < nlines && scols_table_next_line(tb, &itr, &ln) == 0)
+		ary[n++] = ln;
+
+	DBG(TAB, ul_debugobj(tb, "parallel sort [lines=%zu, threads=%zu]", n, nthreads));
+
+	for (i = 0; i <= nthreads; i++)
+		ctl.runs[i] = n * i / nthreads;
+	ctl.nruns = nthreads;
+	ctl.src = ary;
+	ctl.dst = tmp;
+
+	rc = __scols_parallel_run(nthreads, ctl.nruns, sort_run_job, &ctl);
+	if (rc)
+		goto done;
+
+	while (ctl.nruns > 1) {
+		size_t nmerges = (ctl.nruns + 1) / 2;
+		struct libscols_line **x;
+
+		rc = __scols_parallel_run(nthreads, nmerges, merge_runs_job, &ctl);
+		if (rc)
+			goto done;
+
+		for (i = 0; i < nmerges; i++)
+			ctl.runs[i] = ctl.runs[i * 2];
+		ctl.runs[nmerges] = n;
+		ctl.nruns = nmerges;
+
+		x = ctl.src;
+		ctl.src = ctl.dst;
+		ctl.dst = x;
+	}
+
+	/* rebuild the list in the sorted order */
+	INIT_LIST_HEAD(&tb->tb_lines);
+	for (i = 0; i < n; i++)
+		list_add_tail(&ctl.src[i]->ln_lines, &tb->tb_lines);
+done:
+	free(ary);
+	free(tmp);
+	free(ctl.runs);
+	return rc;
+}
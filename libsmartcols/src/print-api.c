@@ -98,6 +98,129 @@ int scols_table_print_range_to_string(
 }
 #endif
 
+/*
+ * Streaming mode, see scols_table_enable_streaming()
+ */
+static int stream_start(struct libscols_table *tb)
+{
+	int rc;
+
+	DBG(TAB, ul_debugobj(tb, "streaming start"));
+
+	tb->stream_started = 1;
+	tb->stream_nlines = 0;
+	tb->header_printed = 0;
+
+	rc = __scols_initialize_printing(tb, &tb->stream_buf);
+	if (rc) {
+		tb->stream_started = 0;
+		return rc;
+	}
+
+	if (is_structured_format(tb)) {
+		sfmt_root_open(tb);
+		sfmt_array_open(tb, tb->name ? tb->name : "");
+	}
+
+	if (tb->format == SCOLS_FMT_HUMAN)
+		__scols_print_title(tb);
+
+	return __scols_print_header(tb, &tb->stream_buf);
+}
+
+/*
+ * Prints and removes all lines from the table. The output is flushed if @flush
+ * is true or if stream buffering is not enabled.
+ */
+int __scols_stream_lines(struct libscols_table *tb, int flush)
+{
+	int rc = 0;
+
+	/* trees and tables without columns are printed by scols_print_table() */
+	if (scols_table_is_tree(tb) || list_empty(&tb->tb_columns)
+	    || list_empty(&tb->tb_lines))
+		return 0;
+
+	if (!tb->stream_started) {
+		rc = stream_start(tb);
+		if (rc)
+			return rc;
+	}
+
+	DBG(TAB, ul_debugobj(tb, "streaming %zu lines", tb->nlines));
+
+	while (rc == 0 && !list_empty(&tb->tb_lines)) {
+		struct libscols_line *ln = list_first_entry(&tb->tb_lines,
+					struct libscols_line, ln_lines);
+
+		if (tb->stream_nlines && tb->header_repeat
+		    && tb->header_next <= tb->termlines_used)
+			__scols_print_header(tb, &tb->stream_buf);
+
+		if (is_structured_format(tb))
+			sfmt_object_open(tb, NULL);
+
+		rc = __scols_print_line(tb, ln, &tb->stream_buf);
+
+		if (is_structured_format(tb))
+			sfmt_object_close(tb);
+		else if (tb->no_linesep == 0) {
+			/* terminate the line now, the next one may never come */
+			fputs(linesep(tb), tb->out);
+			tb->termlines_used++;
+		}
+
+		tb->stream_nlines++;
+		scols_table_remove_line(tb, ln);
+	}
+
+	if (flush || !tb->stream_buffered)
+		fflush(tb->out);
+	return rc;
+}
+
+/* prints the rest of the lines and terminates the output */
+int __scols_stream_finish(struct libscols_table *tb)
+{
+	int rc = __scols_stream_lines(tb, 1);
+
+	if (!tb->stream_started)
+		return rc;
+
+	if (is_structured_format(tb)) {
+		sfmt_array_close(tb);
+		sfmt_root_close(tb);
+	} else if (tb->no_linesep)
+		fputc('\n', tb->out);
+
+	DBG(TAB, ul_debugobj(tb, "streaming done [%zu lines]", tb->stream_nlines));
+
+	__scols_cleanup_printing(tb, &tb->stream_buf);
+	tb->stream_started = 0;
+	return rc;
+}
+
+/**
+ * scols_table_flush:
+ * @tb: table
+ *
+ * Prints and removes all lines from the table in streaming mode, see
+ * scols_table_enable_streaming(). It's unnecessary to call this function
+ * before the next line is added, it's useful to print the last line
+ * immediately, for example before the application waits for more data.
+ *
+ * Returns: 0, a negative value in case of an error.
+ *
+ * Since: 2.39
+ */
+int scols_table_flush(struct libscols_table *tb)
+{
+	if (!tb || !tb->is_streaming)
+		return -EINVAL;
+
+	return __scols_stream_lines(tb, 1);
+}
+
 static int do_print_table(struct libscols_table *tb, int *is_empty)
 {
 	int rc = 0;
@@ -116,12 +239,12 @@ static int do_print_table(struct libscols_table *tb, int *is_empty)
 	}
 	if (list_empty(&tb->tb_lines)) {
 		DBG(TAB, ul_debugobj(tb, "ignore -- no lines"));
-		if (scols_table_is_json(tb)) {
-			ul_jsonwrt_init(&tb->json, tb->out, 0);
-			ul_jsonwrt_root_open(&tb->json);
-			ul_jsonwrt_array_open(&tb->json, tb->name ? tb->name : "");
-			ul_jsonwrt_array_close(&tb->json);
-			ul_jsonwrt_root_close(&tb->json);
+		if (is_structured_format(tb)) {
+			sfmt_init(tb);
+			sfmt_root_open(tb);
+			sfmt_array_open(tb, tb->name ? tb->name : "");
+			sfmt_array_close(tb);
+			sfmt_root_close(tb);
 		} else if (is_empty)
 			*is_empty = 1;
 		return 0;
@@ -132,9 +255,9 @@ static int do_print_table(struct libscols_table *tb, int *is_empty)
 	if (rc)
 		return rc;
 
-	if (scols_table_is_json(tb)) {
-		ul_jsonwrt_root_open(&tb->json);
-		ul_jsonwrt_array_open(&tb->json, tb->name ? tb->name : "");
+	if (is_structured_format(tb)) {
+		sfmt_root_open(tb);
+		sfmt_array_open(tb, tb->name ? tb->name : "");
 	}
 
 	if (tb->format == SCOLS_FMT_HUMAN)
@@ -149,9 +272,9 @@ static int do_print_table(struct libscols_table *tb, int *is_empty)
 	else
 		rc = __scols_print_table(tb, &buf);
 
-	if (scols_table_is_json(tb)) {
-		ul_jsonwrt_array_close(&tb->json);
-		ul_jsonwrt_root_close(&tb->json);
+	if (is_structured_format(tb)) {
+		sfmt_array_close(tb);
+		sfmt_root_close(tb);
 	}
 done:
 	__scols_cleanup_printing(tb, &buf);
@@ -164,14 +287,22 @@ done:
  *
  * Prints the table to the output stream and terminate by \n.
  *
+ * In streaming mode prints the rest of the lines, see
+ * scols_table_enable_streaming().
+ *
  * Returns: 0, a negative value in case of an error.
  */
 int scols_print_table(struct libscols_table *tb)
 {
-	int empty = 0;
-	int rc = do_print_table(tb, &empty);
+	int empty = 0, rc;
+
+	if (tb && tb->is_streaming && !scols_table_is_tree(tb)
+	    && (tb->stream_started || !list_empty(&tb->tb_lines)))
+		return __scols_stream_finish(tb);
+
+	rc = do_print_table(tb, &empty);
 
-	if (rc == 0 && !empty && !scols_table_is_json(tb))
+	if (rc == 0 && !empty && !is_structured_format(tb))
 		fputc('\n', tb->out);
 	return rc;
 }
@@ -47,6 +47,25 @@
 #define cellpadding_symbol(tb)  ((tb)->padding_debug ? "." : \
 				 ((tb)->symbols->cell_padding ? (tb)->symbols->cell_padding: " "))
 
+/* prints padding for @n cells, the default space padding by large blocks */
+static void fputs_cellpadding(struct libscols_table *tb, size_t n)
+{
+	static const char spaces[] = "                                ";
+	const char *sym = cellpadding_symbol(tb);
+
+	if (sym[0] == ' ' && sym[1] == '\0') {
+		while (n) {
+			size_t x = min(n, sizeof(spaces) - 1);
+
+			fwrite(spaces, 1, x, tb->out);
+			n -= x;
+		}
+		return;
+	}
+	for (; n > 0; n--)
+		fputs(sym, tb->out);
+}
+
 #define want_repeat_header(tb)	(!(tb)->header_repeat || (tb)->header_next <= (tb)->termlines_used)
 
 static int is_next_columns_empty(
@@ -87,12 +106,83 @@ static int is_next_columns_empty(
 	return 1;
 }
 
-/* returns pointer to the end of used data */
+/* tree ASCII-art segment of the line, used in the prefix of its children */
+static inline const char *tree_art_segment(struct libscols_table *tb,
+					   struct libscols_line *ln)
+{
+	return is_last_child(ln) ? "  " : vertical_symbol(tb);
+}
+
+/* composes tb->tree_art for @ln from scratch */
+static int tree_art_rebuild(struct libscols_table *tb, struct libscols_line *ln)
+{
+	struct libscols_line *p, **chain;
+	size_t i, n = 0;
+	int rc = 0;
+
+	ul_buffer_reset_data(&tb->tree_art);
+	tb->tree_art_line = NULL;
+
+	for (p = ln; p->parent; p = p->parent)
+		n++;
+
+	chain = n ? malloc(n * sizeof(struct libscols_line *)) : NULL;
+	if (n && !chain)
+		return -ENOMEM;
+
+	for (i = n, p = ln; i > 0; p = p->parent)
+		chain[--i] = p;
+	for (i = 0; rc == 0 && i < n; i++)
+		rc = ul_buffer_append_string(&tb->tree_art, tree_art_segment(tb, chain[i]));
+	free(chain);
+
+	if (!rc)
+		tb->tree_art_line = ln;
+	return rc;
+}
+
+/*
+ * Updates tb->tree_art to the prefix of @ln. The tree is walked in pre-order,
+ * so @ln is the last line, its child, or a child of one of its parents. The
+ * prefix is modified by a few segments only and the whole tree is printed in
+ * linear time rather than in O(lines * depth).
+ */
+static int tree_art_update(struct libscols_table *tb, struct libscols_line *ln)
+{
+	struct libscols_line *last = tb->tree_art_line;
+	int rc;
+
+	while (last && last != ln && last != ln->parent) {
+		if (last->parent) {
+			size_t sz = 0;
+
+			ul_buffer_get_data(&tb->tree_art, &sz, NULL);
+			ul_buffer_truncate_data(&tb->tree_art,
+					sz - strlen(tree_art_segment(tb, last)));
+		}
+		last = last->parent;
+	}
+	if (!last)
+		return tree_art_rebuild(tb, ln);
+
+	if (last != ln) {
+		rc = ul_buffer_append_string(&tb->tree_art, tree_art_segment(tb, ln));
+		if (rc) {
+			tb->tree_art_line = NULL;
+			return rc;
+		}
+	}
+	tb->tree_art_line = ln;
+	return 0;
+}
+
+/* appends tree ASCII-art of all @ln parents and @ln to @buf */
 static int tree_ascii_art_to_buffer(struct libscols_table *tb,
 				    struct libscols_line *ln,
 				    struct ul_buffer *buf)
 {
 	const char *art;
+	size_t sz = 0;
 	int rc;
 
 	assert(ln);
@@ -101,16 +191,15 @@ static int tree_ascii_art_to_buffer(struct libscols_table *tb,
 	if (!ln->parent)
 		return 0;
 
-	rc = tree_ascii_art_to_buffer(tb, ln->parent, buf);
+	/* the lines list may be modified between walks, the last line
+	 * pointer is trusted only within scols_walk_tree() */
+	rc = tb->walk_active ? tree_art_update(tb, ln) :
+			       tree_art_rebuild(tb, ln);
 	if (rc)
 		return rc;
 
-	if (is_last_child(ln))
-		art = "  ";
-	else
-		art = vertical_symbol(tb);
-
-	return ul_buffer_append_string(buf, art);
+	art = ul_buffer_get_data(&tb->tree_art, &sz, NULL);
+	return sz ? ul_buffer_append_data(buf, art, sz) : 0;
 }
 
 static int grpset_is_empty(	struct libscols_table *tb,
@@ -376,8 +465,8 @@ done:
 	}
 
 	/* fill rest of cell with space */
-	for(; len_pad < cl->width; ++len_pad)
-		fputs(cellpadding_symbol(tb), tb->out);
+	if (len_pad < cl->width)
+		fputs_cellpadding(tb, cl->width - len_pad);
 
 	fputs_color_cell_close(tb, cl, ln, ce);
 
@@ -477,7 +566,7 @@ static int print_pending_data(
 		struct libscols_cell *ce)
 {
 	size_t width = cl->width, bytes;
-	size_t len = width, i;
+	size_t len = width;
 	char *data;
 	char *nextchunk = NULL;
 
@@ -526,8 +615,8 @@ static int print_pending_data(
 	}
 
 	/* fill rest of cell with space */
-	for(i = len; i < width; i++)
-		fputs(cellpadding_symbol(tb), tb->out);
+	if (len < width)
+		fputs_cellpadding(tb, width - len);
 
 	fputs_color_cell_close(tb, cl, ln, ce);
 
@@ -569,7 +658,7 @@ static void print_json_data(struct libscols_table *tb,
 	case SCOLS_JSON_ARRAY_STRING:
 	case SCOLS_JSON_ARRAY_NUMBER:
 		/* name: [ "aaa", "bbb", "ccc" ] */
-		ul_jsonwrt_array_open(&tb->json, name);
+		sfmt_array_open(tb, name);
 
 		if (!scols_column_is_customwrap(cl))
 			ul_jsonwrt_value_s(&tb->json, NULL, data);
@@ -583,7 +672,52 @@ static void print_json_data(struct libscols_table *tb,
 				data = next;
 		} while (data);
 
-		ul_jsonwrt_array_close(&tb->json);
+		sfmt_array_close(tb);
+		break;
+	}
+}
+
+/* the same as print_json_data(), but binary */
+static void print_cbor_data(struct libscols_table *tb,
+			    struct libscols_column *cl,
+			    const char *name,
+			    char *data)
+{
+	switch (cl->json_type) {
+	case SCOLS_JSON_STRING:
+		ul_cborwrt_value_s(&tb->cbor, name, data);
+		break;
+	case SCOLS_JSON_NUMBER:
+		ul_cborwrt_value_number(&tb->cbor, name, data);
+		break;
+	case SCOLS_JSON_BOOLEAN:
+	case SCOLS_JSON_BOOLEAN_OPTIONAL:
+		if (cl->json_type == SCOLS_JSON_BOOLEAN_OPTIONAL && (!*data || !strcmp(data, "-"))) {
+			ul_cborwrt_value_null(&tb->cbor, name);
+		} else {
+			ul_cborwrt_value_boolean(&tb->cbor, name,
+					!*data ? 0 :
+					*data == '0' ? 0 :
+					*data == 'N' || *data == 'n' ? 0 : 1);
+		}
+		break;
+	case SCOLS_JSON_ARRAY_STRING:
+	case SCOLS_JSON_ARRAY_NUMBER:
+		ul_cborwrt_array_open(&tb->cbor, name);
+
+		if (!scols_column_is_customwrap(cl))
+			ul_cborwrt_value_s(&tb->cbor, NULL, data);
+		else do {
+				char *next = cl->wrap_nextchunk(cl, data, cl->wrapfunc_data);
+
+				if (cl->json_type == SCOLS_JSON_ARRAY_STRING)
+					ul_cborwrt_value_s(&tb->cbor, NULL, data);
+				else
+					ul_cborwrt_value_number(&tb->cbor, NULL, data);
+				data = next;
+		} while (data);
+
+		ul_cborwrt_array_close(&tb->cbor);
 		break;
 	}
 }
@@ -594,7 +728,7 @@ static int print_data(struct libscols_table *tb,
 		      struct libscols_cell *ce,	/* optional */
 		      struct ul_buffer *buf)
 {
-	size_t len = 0, i, width, bytes;
+	size_t len = 0, width, bytes;
 	char *data, *nextchunk;
 	const char *name = NULL;
 	int is_last;
@@ -614,7 +748,7 @@ static int print_data(struct libscols_table *tb,
 
 	is_last = is_last_column(cl);
 
-	if (is_last && scols_table_is_json(tb) &&
+	if (is_last && is_structured_format(tb) &&
 	    scols_table_is_tree(tb) && has_children(ln))
 		/* "children": [] is the real last value */
 		is_last = 0;
@@ -638,6 +772,10 @@ static int print_data(struct libscols_table *tb,
 		print_json_data(tb, cl, name, data);
 		return 0;
 
+	case SCOLS_FMT_CBOR:
+		print_cbor_data(tb, cl, name, data);
+		return 0;
+
 	case SCOLS_FMT_HUMAN:
 		break;		/* continue below */
 	}
@@ -696,8 +834,8 @@ static int print_data(struct libscols_table *tb,
 
 	if (data && *data) {
 		if (scols_column_is_right(cl)) {
-			for (i = len; i < width; i++)
-				fputs(cellpadding_symbol(tb), tb->out);
+			if (len < width)
+				fputs_cellpadding(tb, width - len);
 			len = width;
 		}
 		fputs(data, tb->out);
@@ -717,12 +855,12 @@ static int print_data(struct libscols_table *tb,
 	}
 
 	/* fill rest of cell with space */
-	for(i = len; i < width; i++)
-		fputs(cellpadding_symbol(tb), tb->out);
+	if (len < width)
+		fputs_cellpadding(tb, width - len);
 
 	fputs_color_cell_close(tb, cl, ln, ce);
 
-	if (len > width && !scols_column_is_trunc(cl)) {
+	if (len > width && !scols_column_is_trunc(cl) && !tb->stream_started) {
 		DBG(COL, ul_debugobj(cl, "*** data len=%zu > column width=%zu", len, width));
 		print_newline_padding(tb, cl, ln, ce, ul_buffer_get_bufsiz(buf));	/* next column starts on next line */
 
@@ -758,13 +896,13 @@ int __cell_to_buffer(struct libscols_table *tb,
 	/*
 	 * Group stuff
 	 */
-	if (!scols_table_is_json(tb) && cl->is_groups)
+	if (!is_structured_format(tb) && cl->is_groups)
 		rc = groups_ascii_art_to_buffer(tb, ln, buf, 0);
 
 	/*
 	 * Tree stuff
 	 */
-	if (!rc && ln->parent && !scols_table_is_json(tb)) {
+	if (!rc && ln->parent && !is_structured_format(tb)) {
 		rc = tree_ascii_art_to_buffer(tb, ln->parent, buf);
 
 		if (!rc && is_last_child(ln))
@@ -773,7 +911,7 @@ int __cell_to_buffer(struct libscols_table *tb,
 			rc = ul_buffer_append_string(buf, branch_symbol(tb));
 	}
 
-	if (!rc && (ln->parent || cl->is_groups) && !scols_table_is_json(tb))
+	if (!rc && (ln->parent || cl->is_groups) && !is_structured_format(tb))
 		ul_buffer_save_pointer(buf, SCOLS_BUFPTR_TREEEND);
 
 	if (!rc && data)
@@ -950,7 +1088,7 @@ int __scols_print_header(struct libscols_table *tb, struct ul_buffer *buf)
 	if ((tb->header_printed == 1 && tb->header_repeat == 0) ||
 	    scols_table_is_noheadings(tb) ||
 	    scols_table_is_export(tb) ||
-	    scols_table_is_json(tb) ||
+	    is_structured_format(tb) ||
 	    list_empty(&tb->tb_lines))
 		return 0;
 
@@ -1011,13 +1149,13 @@ int __scols_print_range(struct libscols_table *tb,
 
 		int last = scols_iter_is_last(itr);
 
-		if (scols_table_is_json(tb))
-			ul_jsonwrt_object_open(&tb->json, NULL);
+		if (is_structured_format(tb))
+			sfmt_object_open(tb, NULL);
 
 		rc = print_line(tb, ln, buf);
 
-		if (scols_table_is_json(tb))
-			ul_jsonwrt_object_close(&tb->json);
+		if (is_structured_format(tb))
+			sfmt_object_close(tb);
 		else if (last == 0 && tb->no_linesep == 0) {
 			fputs(linesep(tb), tb->out);
 			tb->termlines_used++;
@@ -1042,6 +1180,13 @@ int __scols_print_table(struct libscols_table *tb, struct ul_buffer *buf)
 	return __scols_print_range(tb, buf, &itr, NULL);
 }
 
+int __scols_print_line(struct libscols_table *tb,
+		       struct libscols_line *ln,
+		       struct ul_buffer *buf)
+{
+	return print_line(tb, ln, buf);
+}
+
 /* scols_walk_tree() callback to print tree line */
 static int print_tree_line(struct libscols_table *tb,
 			   struct libscols_line *ln,
@@ -1053,16 +1198,16 @@ static int print_tree_line(struct libscols_table *tb,
 
 	DBG(LINE, ul_debugobj(ln, "   printing tree line"));
 
-	if (scols_table_is_json(tb))
-		ul_jsonwrt_object_open(&tb->json, NULL);
+	if (is_structured_format(tb))
+		sfmt_object_open(tb, NULL);
 
 	rc = print_line(tb, ln, buf);
 	if (rc)
 		return rc;
 
 	if (has_children(ln)) {
-		if (scols_table_is_json(tb))
-			ul_jsonwrt_array_open(&tb->json, "children");
+		if (is_structured_format(tb))
+			sfmt_array_open(tb, "children");
 		else {
 			/* between parent and child is separator */
 			fputs(linesep(tb), tb->out);
@@ -1072,14 +1217,14 @@ static int print_tree_line(struct libscols_table *tb,
 		int last;
 
 		/* terminate all open last children for JSON */
-		if (scols_table_is_json(tb)) {
+		if (is_structured_format(tb)) {
 			do {
 				last = (is_child(ln) && is_last_child(ln)) ||
 				       (is_tree_root(ln) && is_last_tree_root(tb, ln));
 
-				ul_jsonwrt_object_close(&tb->json);
+				sfmt_object_close(tb);
 				if (last && is_child(ln))
-					ul_jsonwrt_array_close(&tb->json);
+					sfmt_array_close(tb);
 				ln = ln->parent;
 			} while(ln && last);
 
@@ -1182,7 +1327,8 @@ int __scols_initialize_printing(struct libscols_table *tb, struct ul_buffer *buf
 		extra_bufsz += tb->ncols;			/* separator between columns */
 		break;
 	case SCOLS_FMT_JSON:
-		ul_jsonwrt_init(&tb->json, tb->out, 0);
+	case SCOLS_FMT_CBOR:
+		sfmt_init(tb);
 		extra_bufsz += tb->nlines * 3;		/* indentation */
 		/* fallthrough */
 	case SCOLS_FMT_EXPORT:
@@ -1229,7 +1375,9 @@ int __scols_initialize_printing(struct libscols_table *tb, struct ul_buffer *buf
 	if (has_groups(tb) && scols_table_is_tree(tb))
 		scols_groups_fix_members_order(tb);
 
-	if (tb->format == SCOLS_FMT_HUMAN) {
+	if (tb->format == SCOLS_FMT_HUMAN && tb->stream_started)
+		__scols_calculate_fixed(tb);
+	else if (tb->format == SCOLS_FMT_HUMAN) {
 		rc = __scols_calculate(tb, buf);
 		if (rc != 0)
 			goto err;
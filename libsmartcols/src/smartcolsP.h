@@ -16,6 +16,7 @@
 #include "strutils.h"
 #include "color-names.h"
 #include "jsonwrt.h"
+#include "cborwrt.h"
 #include "debug.h"
 #include "buffer.h"
 
@@ -78,11 +79,30 @@ struct libscols_symbols {
 /*
  * Table cells
  */
+union libscols_sortkey {
+	uint64_t	u64;
+	int64_t		s64;
+	double		dbl;
+};
+
+/*
+ * The cells are allocated for each line (or in the column store chunks), keep
+ * the struct small; the bit fields are in the padding after the flags.
+ */
 struct libscols_cell {
 	char	*data;
 	char	*color;
 	void    *userdata;
 	int	flags;
+
+	unsigned int is_arena :1,	/* data allocated in column store arena */
+		     has_width :1,	/* width is valid */
+		     width_noenc :1,	/* width counted without encoding */
+		     has_sortkey :1;	/* sortkey is set */
+
+	size_t	width;			/* cached data width, see calculate.c */
+
+	union libscols_sortkey sortkey;	/* see scols_cell_set_sortkey_u64() */
 };
 
 extern int scols_line_move_cells(struct libscols_line *ln, size_t newn, size_t oldn);
@@ -105,6 +125,7 @@ struct libscols_column {
 	int	extreme_count;
 
 	int	json_type;	/* SCOLS_JSON_* */
+	int	sortkey_type;	/* SCOLS_SORTKEY_* */
 
 	int	flags;
 	char	*color;		/* default column color */
@@ -134,7 +155,8 @@ struct libscols_column {
 	struct libscols_table	*table;
 
 	unsigned int	is_extreme : 1,		/* extreme width in the column */
-			is_groups  : 1;		/* print group chart */
+			is_groups  : 1,		/* print group chart */
+			is_counted : 1;		/* width already counted (by thread) */
 
 };
 
@@ -182,6 +204,9 @@ struct libscols_line {
 	struct libscols_cell	*cells;		/* array with data */
 	size_t			ncells;		/* number of cells */
 
+	struct libscols_colstore *store;	/* cells in column store (cells[] unused) */
+	size_t			storerow;	/* row in the store */
+
 	struct list_head	ln_lines;	/* member of table->tb_lines */
 	struct list_head	ln_branch;	/* head of line->ln_children */
 	struct list_head	ln_children;	/* member of line->ln_children or group->gr_children */
@@ -192,11 +217,58 @@ struct libscols_line {
 	struct libscols_group	*group;		/* for group members */
 };
 
+/*
+ * Column-major cells storage (colstore.c)
+ */
+#define SCOLS_COLSTORE_CHUNK	1024	/* rows per chunk */
+
+struct libscols_colstore {
+	int	refcount;
+
+	struct libscols_cell ***cols;	/* cols[column][chunk][row % SCOLS_COLSTORE_CHUNK] */
+	size_t	ncols;			/* number of columns */
+	size_t	nchunks;		/* number of chunks per column */
+	size_t	nrows;			/* number of used rows */
+
+	char	*active;		/* rows used by the table lines */
+	size_t	nactive;		/* number of active rows */
+
+	size_t	*freerows;		/* rows of deallocated lines */
+	size_t	nfree;			/* number of free rows */
+
+	struct colstore_arena *arena;	/* cells data */
+	size_t	arena_size;		/* size of all arena chunks */
+	size_t	arena_limit;		/* compact the arena if it has to grow over */
+};
+
+extern struct libscols_colstore *scols_new_colstore(size_t ncols);
+extern void scols_ref_colstore(struct libscols_colstore *cs);
+extern void scols_unref_colstore(struct libscols_colstore *cs);
+extern int scols_colstore_alloc_columns(struct libscols_colstore *cs, size_t ncols);
+extern int scols_colstore_add_line(struct libscols_colstore *cs,
+				   struct libscols_line *ln, size_t ncells);
+extern void scols_colstore_remove_line(struct libscols_colstore *cs,
+				      struct libscols_line *ln);
+extern void scols_colstore_set_active(struct libscols_colstore *cs,
+				      struct libscols_line *ln, int enable);
+extern struct libscols_cell *scols_colstore_next_cell(struct libscols_colstore *cs,
+						      size_t colnum, size_t *row);
+extern int scols_colstore_set_data(struct libscols_colstore *cs,
+				   struct libscols_cell *ce, const char *data);
+
+static inline struct libscols_cell *scols_colstore_get_cell(
+				struct libscols_colstore *cs,
+				size_t colnum, size_t row)
+{
+	return &cs->cols[colnum][row / SCOLS_COLSTORE_CHUNK][row % SCOLS_COLSTORE_CHUNK];
+}
+
 enum {
 	SCOLS_FMT_HUMAN = 0,		/* default, human readable */
 	SCOLS_FMT_RAW,			/* space separated */
 	SCOLS_FMT_EXPORT,		/* COLNAME="data" ... */
-	SCOLS_FMT_JSON			/* http://en.wikipedia.org/wiki/JSON */
+	SCOLS_FMT_JSON,			/* http://en.wikipedia.org/wiki/JSON */
+	SCOLS_FMT_CBOR			/* binary JSON, RFC 8949 */
 };
 
 /*
@@ -227,12 +299,22 @@ struct libscols_table {
 	size_t			ngrpchlds_pending;	/* groups with not yet printed children */
 	struct libscols_line	*walk_last_tree_root;	/* last root, used by scols_walk_() */
 
+	struct ul_buffer	tree_art;	/* tree ASCII-art prefix of tree_art_line */
+	struct libscols_line	*tree_art_line;	/* the last line with prefix in tree_art */
+
 	struct libscols_column	*dflt_sort_column;	/* default sort column, set by scols_sort_table() */
 
+	struct libscols_colstore *colstore;	/* column-major cells storage or NULL */
+	size_t			nthreads;	/* max threads, 0 = auto, see parallel.c */
+
+	struct ul_buffer	stream_buf;	/* print buffer for streaming mode */
+	size_t			stream_nlines;	/* already printed lines in streaming mode */
+
 	struct libscols_symbols	*symbols;
 	struct libscols_cell	title;		/* optional table title (for humans) */
 
 	struct ul_jsonwrt	json;		/* JSON formatting */
+	struct ul_cborwrt	cbor;		/* CBOR formatting */
 
 	int	format;		/* SCOLS_FMT_* */
 
@@ -254,10 +336,14 @@ struct libscols_table {
 			header_printed  :1,	/* header already printed */
 			priv_symbols	:1,	/* default private symbols */
 			walk_last_done	:1,	/* last tree root walked */
+			walk_active	:1,	/* scols_walk_tree() in progress */
 			no_headings	:1,	/* don't print header */
 			no_encode	:1,	/* don't care about control and non-printable chars */
 			no_linesep	:1,	/* don't print line separator */
-			no_wrap		:1;	/* never wrap lines */
+			no_wrap		:1,	/* never wrap lines */
+			is_streaming	:1,	/* print and remove lines when added */
+			stream_buffered	:1,	/* don't flush streamed lines */
+			stream_started	:1;	/* header already printed in streaming mode */
 };
 
 #define IS_ITER_FORWARD(_i)	((_i)->direction == SCOLS_ITER_FORWARD)
@@ -325,10 +411,42 @@ extern int scols_walk_tree(struct libscols_table *tb,
                     void *data);
 extern int scols_walk_is_last(struct libscols_table *tb, struct libscols_line *ln);
 
+/*
+ * cell.c
+ */
+extern int __scols_cmp_sortkeys(int type, struct libscols_cell *a,
+				struct libscols_cell *b);
+
+/* compares cells of the column @cl, see scols_column_set_sortkey_type() */
+static inline int scols_cmp_column_cells(struct libscols_column *cl,
+					 struct libscols_cell *a,
+					 struct libscols_cell *b)
+{
+	if (cl->sortkey_type)
+		return __scols_cmp_sortkeys(cl->sortkey_type, a, b);
+	return cl->cmpfunc(a, b, cl->cmpfunc_data);
+}
+
+static inline int scols_column_is_sortable(struct libscols_column *cl)
+{
+	return cl->sortkey_type || cl->cmpfunc;
+}
+
+/*
+ * parallel.c
+ */
+extern size_t __scols_table_nthreads(struct libscols_table *tb);
+extern int __scols_parallel_run(size_t nthreads, size_t njobs,
+				int (*fn)(size_t, void *), void *data);
+extern int __scols_parallel_sort_lines(struct libscols_table *tb,
+				       struct libscols_column *cl,
+				       size_t nthreads);
+
 /*
  * calculate.c
  */
 extern int __scols_calculate(struct libscols_table *tb, struct ul_buffer *buf);
+extern void __scols_calculate_fixed(struct libscols_table *tb);
 
 /*
  * print.c
@@ -342,6 +460,9 @@ void __scols_cleanup_printing(struct libscols_table *tb, struct ul_buffer *buf);
 int __scols_initialize_printing(struct libscols_table *tb, struct ul_buffer *buf);
 int __scols_print_tree(struct libscols_table *tb, struct ul_buffer *buf);
 int __scols_print_table(struct libscols_table *tb, struct ul_buffer *buf);
+int __scols_print_line(struct libscols_table *tb,
+                       struct libscols_line *ln,
+                       struct ul_buffer *buf);
 int __scols_print_header(struct libscols_table *tb, struct ul_buffer *buf);
 int __scols_print_title(struct libscols_table *tb);
 int __scols_print_range(struct libscols_table *tb,
@@ -349,6 +470,53 @@ int __scols_print_range(struct libscols_table *tb,
                         struct libscols_iter *itr,
                         struct libscols_line *end);
 
+/*
+ * print-api.c
+ */
+int __scols_stream_lines(struct libscols_table *tb, int flush);
+int __scols_stream_finish(struct libscols_table *tb);
+
+/*
+ * JSON and CBOR outputs have the same structure, the UL_JSON_* types are
+ * used for both.
+ */
+static inline int is_structured_format(struct libscols_table *tb)
+{
+	return tb->format == SCOLS_FMT_JSON || tb->format == SCOLS_FMT_CBOR;
+}
+
+static inline void sfmt_init(struct libscols_table *tb)
+{
+	if (tb->format == SCOLS_FMT_CBOR)
+		ul_cborwrt_init(&tb->cbor, tb->out);
+	else
+		ul_jsonwrt_init(&tb->json, tb->out, 0);
+}
+
+static inline void sfmt_open(struct libscols_table *tb, const char *name, int type)
+{
+	if (tb->format == SCOLS_FMT_CBOR)
+		ul_cborwrt_open(&tb->cbor, name,
+				type == UL_JSON_ARRAY ? UL_CBOR_ARRAY : UL_CBOR_MAP);
+	else
+		ul_jsonwrt_open(&tb->json, name, type);
+}
+
+static inline void sfmt_close(struct libscols_table *tb, int type)
+{
+	if (tb->format == SCOLS_FMT_CBOR)
+		ul_cborwrt_close(&tb->cbor);
+	else
+		ul_jsonwrt_close(&tb->json, type);
+}
+
+#define sfmt_root_open(_t)		sfmt_open(_t, NULL, UL_JSON_OBJECT)
+#define sfmt_root_close(_t)		sfmt_close(_t, UL_JSON_OBJECT)
+#define sfmt_array_open(_t, _n)		sfmt_open(_t, _n, UL_JSON_ARRAY)
+#define sfmt_array_close(_t)		sfmt_close(_t, UL_JSON_ARRAY)
+#define sfmt_object_open(_t, _n)	sfmt_open(_t, _n, UL_JSON_OBJECT)
+#define sfmt_object_close(_t)		sfmt_close(_t, UL_JSON_OBJECT)
+
 static inline int is_tree_root(struct libscols_line *ln)
 {
 	return ln && !ln->parent && !ln->parent_group;
@@ -130,6 +130,9 @@ void scols_unref_table(struct libscols_table *tb)
 		scols_table_remove_columns(tb);
 		scols_unref_symbols(tb->symbols);
 		scols_reset_cell(&tb->title);
+		scols_unref_colstore(tb->colstore);
+		ul_buffer_free_data(&tb->stream_buf);
+		ul_buffer_free_data(&tb->tree_art);
 		free(tb->grpset);
 		free(tb->linesep);
 		free(tb->colsep);
@@ -625,13 +628,25 @@ int scols_table_add_line(struct libscols_table *tb, struct libscols_line *ln)
 	if (!list_empty(&ln->ln_lines))
 		return -EINVAL;
 
-	if (tb->ncols > ln->ncells) {
+	/* the previous lines are complete, print them */
+	if (tb->is_streaming && !list_empty(&tb->tb_lines)) {
+		int rc = __scols_stream_lines(tb, 0);
+		if (rc)
+			return rc;
+	}
+
+	if (tb->colstore && !ln->cells && !ln->store) {
+		int rc = scols_colstore_add_line(tb->colstore, ln, tb->ncols);
+		if (rc)
+			return rc;
+	} else if (tb->ncols > ln->ncells) {
 		int rc = scols_line_alloc_cells(ln, tb->ncols);
 		if (rc)
 			return rc;
 	}
 
 	DBG(TAB, ul_debugobj(tb, "add line"));
+	scols_colstore_set_active(tb->colstore, ln, 1);
 	list_add_tail(&ln->ln_lines, &tb->tb_lines);
 	ln->seqnum = tb->nlines++;
 	scols_ref_line(ln);
@@ -655,6 +670,7 @@ int scols_table_remove_line(struct libscols_table *tb,
 		return -EINVAL;
 
 	DBG(TAB, ul_debugobj(tb, "remove line"));
+	scols_colstore_set_active(tb->colstore, ln, 0);
 	list_del_init(&ln->ln_lines);
 	tb->nlines--;
 	scols_unref_line(ln);
@@ -1064,6 +1080,36 @@ int scols_table_enable_json(struct libscols_table *tb, int enable)
 	return 0;
 }
 
+/**
+ * scols_table_enable_cbor:
+ * @tb: table
+ * @enable: 1 or 0
+ *
+ * Enable/disable CBOR (RFC 8949) output format. It is a binary format with
+ * the same structure as JSON output; the output starts with the CBOR
+ * self-describe tag (bytes 0xd9 0xd9 0xf7), the objects are maps with
+ * indefinite length and the values are typed according to
+ * scols_column_set_json_type(). The numbers are encoded as integers or
+ * floats, the strings which are not valid UTF-8 as byte strings. The parsable output formats (export, raw, JSON, ...) are mutually
+ * exclusive.
+ *
+ * Returns: 0 on success, negative number in case of an error.
+ *
+ * Since: 2.39
+ */
+int scols_table_enable_cbor(struct libscols_table *tb, int enable)
+{
+	if (!tb)
+		return -EINVAL;
+
+	DBG(TAB, ul_debugobj(tb, "cbor: %s", enable ? "ENABLE" : "DISABLE"));
+	if (enable)
+		tb->format = SCOLS_FMT_CBOR;
+	else if (tb->format == SCOLS_FMT_CBOR)
+		tb->format = 0;
+	return 0;
+}
+
 /**
  * scols_table_enable_export:
  * @tb: table
@@ -1294,6 +1340,186 @@ int scols_table_is_noencoding(const struct libscols_table *tb)
 	return tb->no_encode;
 }
 
+/**
+ * scols_table_enable_colstore:
+ * @tb: table
+ * @enable: 1 or 0
+ *
+ * Store cells of the lines added to the table in large per-column arrays
+ * and copy cells data to the table string arena rather than allocate
+ * each cell and string separately. This is recommended for tables with
+ * huge number of lines, it reduces number of allocations and makes columns
+ * width calculation faster.
+ *
+ * The function has to be called before lines are added to the table. The
+ * cells are stored in the table only for lines without already allocated
+ * cells, see scols_line_alloc_cells().
+ *
+ * Returns: 0 on success, negative number in case of an error.
+ *
+ * Since: 2.39
+ */
+int scols_table_enable_colstore(struct libscols_table *tb, int enable)
+{
+	if (!tb || !list_empty(&tb->tb_lines))
+		return -EINVAL;
+
+	DBG(TAB, ul_debugobj(tb, "colstore: %s", enable ? "ENABLE" : "DISABLE"));
+
+	if (enable && !tb->colstore) {
+		tb->colstore = scols_new_colstore(tb->ncols);
+		if (!tb->colstore)
+			return -ENOMEM;
+	} else if (!enable && tb->colstore) {
+		scols_unref_colstore(tb->colstore);
+		tb->colstore = NULL;
+	}
+	return 0;
+}
+
+/**
+ * scols_table_is_colstore:
+ * @tb: a pointer to a struct libscols_table instance
+ *
+ * Returns: 1 if column store is enabled.
+ *
+ * Since: 2.39
+ */
+int scols_table_is_colstore(const struct libscols_table *tb)
+{
+	return tb->colstore ? 1 : 0;
+}
+
+/**
+ * scols_table_enable_streaming:
+ * @tb: table
+ * @enable: 1 or 0
+ *
+ * Print lines immediately rather than keep all the table in memory. The
+ * line is printed and removed from the table when the next line is added
+ * to the table, by scols_table_flush() or by scols_print_table(), which also
+ * prints the rest of the table and terminates the output. Don't use the line
+ * after the next line is added, unless you hold a reference to it. The output
+ * is flushed after every line, see scols_table_enable_stream_buffering().
+ *
+ * The columns width cannot be calculated from the data in this mode. For
+ * human-readable output the width is the column width hint (relative hints
+ * are relative to the terminal width) or the header width. Longer data are
+ * truncated for columns with SCOLS_FL_TRUNC flag, otherwise the rest of the
+ * line is shifted. The JSON, raw and export formats are not affected.
+ *
+ * The streaming is not possible for trees; tree tables are printed by
+ * scols_print_table() as usual.
+ *
+ * The function has to be called before lines are added to the table.
+ *
+ * Returns: 0 on success, negative number in case of an error.
+ *
+ * Since: 2.39
+ */
+int scols_table_enable_streaming(struct libscols_table *tb, int enable)
+{
+	if (!tb || !list_empty(&tb->tb_lines) || tb->stream_started)
+		return -EINVAL;
+
+	DBG(TAB, ul_debugobj(tb, "streaming: %s", enable ? "ENABLE" : "DISABLE"));
+	tb->is_streaming = enable ? 1 : 0;
+	return 0;
+}
+
+/**
+ * scols_table_is_streaming:
+ * @tb: a pointer to a struct libscols_table instance
+ *
+ * Returns: 1 if streaming output is enabled.
+ *
+ * Since: 2.39
+ */
+int scols_table_is_streaming(const struct libscols_table *tb)
+{
+	return tb->is_streaming;
+}
+
+/**
+ * scols_table_enable_stream_buffering:
+ * @tb: table
+ * @enable: 1 or 0
+ *
+ * By default, the output is flushed after every line printed in streaming
+ * mode (see scols_table_enable_streaming()), so the line is visible
+ * immediately. If the buffering is enabled, the output stream is flushed
+ * only by scols_table_flush() and scols_print_table(), and the lines are
+ * written by full stdio buffers. This is useful for applications that print
+ * a huge number of lines in a loop and don't wait for input between them.
+ *
+ * Returns: 0 on success, negative number in case of an error.
+ *
+ * Since: 2.39
+ */
+int scols_table_enable_stream_buffering(struct libscols_table *tb, int enable)
+{
+	if (!tb)
+		return -EINVAL;
+
+	DBG(TAB, ul_debugobj(tb, "stream buffering: %s", enable ? "ENABLE" : "DISABLE"));
+	tb->stream_buffered = enable ? 1 : 0;
+	return 0;
+}
+
+/**
+ * scols_table_is_stream_buffering:
+ * @tb: a pointer to a struct libscols_table instance
+ *
+ * Returns: 1 if streamed output is flushed only by scols_table_flush() and
+ * scols_print_table().
+ *
+ * Since: 2.39
+ */
+int scols_table_is_stream_buffering(const struct libscols_table *tb)
+{
+	return tb->stream_buffered;
+}
+
+/**
+ * scols_table_set_nthreads:
+ * @tb: table
+ * @nthreads: maximal number of threads, 1 to disable or 0 for the default
+ *
+ * Enables threads for the table sort and the columns width calculation.
+ * The threads are used only for tables with a huge number of lines (50000
+ * and more). Don't enable threads if the function specified by
+ * scols_column_set_cmpfunc() is not thread-safe.
+ *
+ * The threads are disabled by default (@nthreads is 0), the default may be
+ * overwritten by LIBSMARTCOLS_THREADS=<num>|auto environment variable, where
+ * "auto" means one thread per CPU, but no more than 8 threads.
+ *
+ * Returns: 0 on success, negative number in case of an error.
+ *
+ * Since: 2.39
+ */
+int scols_table_set_nthreads(struct libscols_table *tb, size_t nthreads)
+{
+	if (!tb)
+		return -EINVAL;
+	DBG(TAB, ul_debugobj(tb, "threads: %zu", nthreads));
+	tb->nthreads = nthreads;
+	return 0;
+}
+
+/**
+ * scols_table_get_nthreads:
+ * @tb: table
+ *
+ * Returns: maximal number of threads, 0 for the default.
+ *
+ * Since: 2.39
+ */
+size_t scols_table_get_nthreads(const struct libscols_table *tb)
+{
+	return tb->nthreads;
+}
+
 /**
  * scols_table_colors_wanted:
  * @tb: table
@@ -1400,6 +1626,19 @@ int scols_table_is_json(const struct libscols_table *tb)
 	return tb->format == SCOLS_FMT_JSON;
 }
 
+/**
+ * scols_table_is_cbor:
+ * @tb: table
+ *
+ * Returns: 1 if CBOR output format is enabled.
+ *
+ * Since: 2.39
+ */
+int scols_table_is_cbor(const struct libscols_table *tb)
+{
+	return tb->format == SCOLS_FMT_CBOR;
+}
+
 /**
  * scols_table_is_maxout
  * @tb: table
@@ -1500,7 +1739,7 @@ static int cells_cmp_wrapper_lines(struct list_head *a, struct list_head *b, voi
 	ca = scols_line_get_cell(ra, cl->seqnum);
 	cb = scols_line_get_cell(rb, cl->seqnum);
 
-	return cl->cmpfunc(ca, cb, cl->cmpfunc_data);
+	return scols_cmp_column_cells(cl, ca, cb);
 }
 
 /* for lines in the struct libscols_line->ln_children list */
@@ -1519,10 +1758,105 @@ static int cells_cmp_wrapper_children(struct list_head *a, struct list_head *b,
 	ca = scols_line_get_cell(ra, cl->seqnum);
 	cb = scols_line_get_cell(rb, cl->seqnum);
 
-	return cl->cmpfunc(ca, cb, cl->cmpfunc_data);
+	return scols_cmp_column_cells(cl, ca, cb);
 }
 
 
+/*
+ * Sort by typed keys (see scols_column_set_sortkey_type()). The keys are
+ * copied to a packed array and sorted without callbacks and cells lookups.
+ */
+struct sortkey_ent {
+	union libscols_sortkey	key;
+	char			*str;	/* strxfrm() result for SCOLS_SORTKEY_STRING */
+	struct libscols_line	*ln;
+	size_t			idx;	/* original position, keeps the sort stable */
+	int			has_key;
+};
+
+#define DEFINE_SORTKEY_CMP(_name, _expr) \
+	static int _name(const void *a, const void *b) \
+	{ \
+		const struct sortkey_ent *x = (const struct sortkey_ent *) a, \
+					 *y = (const struct sortkey_ent *) b; \
+		int rc = x->has_key - y->has_key; \
+		\
+		if (!rc && x->has_key) \
+			rc = (_expr); \
+		return rc ? rc : cmp_numbers(x->idx, y->idx); \
+	}
+
+DEFINE_SORTKEY_CMP(sortkey_cmp_u64, cmp_numbers(x->key.u64, y->key.u64))
+DEFINE_SORTKEY_CMP(sortkey_cmp_s64, cmp_numbers(x->key.s64, y->key.s64))
+DEFINE_SORTKEY_CMP(sortkey_cmp_double, cmp_numbers(x->key.dbl, y->key.dbl))
+DEFINE_SORTKEY_CMP(sortkey_cmp_string, strcmp(x->str, y->str))
+
+static int sort_lines_by_keys(struct libscols_table *tb, struct libscols_column *cl)
+{
+	struct sortkey_ent *ents;
+	struct libscols_line *ln;
+	struct libscols_iter itr;
+	size_t i, n = 0;
+	int rc = 0;
+
+	ents = calloc(tb->nlines, sizeof(struct sortkey_ent));
+	if (!ents)
+		return -ENOMEM;
+
+	DBG(TAB, ul_debugobj(tb, "sorting by keys [type=%d]", cl->sortkey_type));
+
+	scols_reset_iter(&itr, SCOLS_ITER_FORWARD);
+	while (n < tb->nlines && scols_table_next_line(tb, &itr, &ln) == 0) {
+		struct libscols_cell *ce = scols_line_get_cell(ln, cl->seqnum);
+		struct sortkey_ent *e = &ents[n];
+
+		e->ln = ln;
+		e->idx = n++;
+
+		if (!ce)
+			continue;
+		if (cl->sortkey_type != SCOLS_SORTKEY_STRING) {
+			e->key = ce->sortkey;
+			e->has_key = ce->has_sortkey;
+		} else if (ce->data) {
+			size_t sz = strxfrm(NULL, ce->data, 0) + 1;
+
+			e->str = malloc(sz);
+			if (!e->str) {
+				rc = -ENOMEM;
+				goto done;
+			}
+			strxfrm(e->str, ce->data, sz);
+			e->has_key = 1;
+		}
+	}
+
+	switch (cl->sortkey_type) {
+	case SCOLS_SORTKEY_U64:
+		qsort(ents, n, sizeof(struct sortkey_ent), sortkey_cmp_u64);
+		break;
+	case SCOLS_SORTKEY_S64:
+		qsort(ents, n, sizeof(struct sortkey_ent), sortkey_cmp_s64);
+		break;
+	case SCOLS_SORTKEY_DOUBLE:
+		qsort(ents, n, sizeof(struct sortkey_ent), sortkey_cmp_double);
+		break;
+	case SCOLS_SORTKEY_STRING:
+		qsort(ents, n, sizeof(struct sortkey_ent), sortkey_cmp_string);
+		break;
+	}
+
+	/* rebuild the list in the sorted order */
+	INIT_LIST_HEAD(&tb->tb_lines);
+	for (i = 0; i < n; i++)
+		list_add_tail(&ents[i].ln->ln_lines, &tb->tb_lines);
+done:
+	for (i = 0; i < n; i++)
+		free(ents[i].str);
+	free(ents);
+	return rc;
+}
+
 static int sort_line_children(struct libscols_line *ln, struct libscols_column *cl)
 {
 	struct list_head *p;
@@ -1555,7 +1889,7 @@ static int  __scols_sort_tree(struct libscols_table *tb, struct libscols_column
 	struct libscols_line *ln;
 	struct libscols_iter itr;
 
-	if (!tb || !cl || !cl->cmpfunc)
+	if (!tb || !cl || !scols_column_is_sortable(cl))
 		return -EINVAL;
 
 	scols_reset_iter(&itr, SCOLS_ITER_FORWARD);
@@ -1569,26 +1903,40 @@ static int  __scols_sort_tree(struct libscols_table *tb, struct libscols_column
  * @tb: table
  * @cl: order by this column or NULL
  *
- * Orders the table by the column. See also scols_column_set_cmpfunc(). If the
- * tree output is enabled then children in the tree are recursively sorted too.
+ * Orders the table by the column. See also scols_column_set_cmpfunc() and
+ * scols_column_set_sortkey_type(). If the tree output is enabled then children
+ * in the tree are recursively sorted too.
  *
  * The column @cl is saved as the default sort column to the @tb and the next time
  * is possible to call scols_sort_table(tb, NULL). The saved column is also used by
  * scols_sort_table_by_tree().
  *
+ * Tables with a huge number of lines are sorted by more threads, see
+ * scols_table_set_nthreads().
+ *
  * Returns: 0, a negative value in case of an error.
  */
 int scols_sort_table(struct libscols_table *tb, struct libscols_column *cl)
 {
+	int rc = 0;
+
 	if (!tb)
 		return -EINVAL;
 	if (!cl)
 		cl = tb->dflt_sort_column;
-	if (!cl || !cl->cmpfunc)
+	if (!cl || !scols_column_is_sortable(cl))
 		return -EINVAL;
 
 	DBG(TAB, ul_debugobj(tb, "sorting table by %zu column", cl->seqnum));
-	list_sort(&tb->tb_lines, cells_cmp_wrapper_lines, cl);
+
+	if (cl->sortkey_type)
+		rc = sort_lines_by_keys(tb, cl);
+	if (!cl->sortkey_type || rc) {
+		size_t nthreads = __scols_table_nthreads(tb);
+
+		if (nthreads <= 1 || __scols_parallel_sort_lines(tb, cl, nthreads) != 0)
+			list_sort(&tb->tb_lines, cells_cmp_wrapper_lines, cl);
+	}
 
 	if (scols_table_is_tree(tb))
 		__scols_sort_tree(tb, cl);
@@ -1,13 +1,13 @@
 #include "smartcolsP.h"
 
-static int walk_line(struct libscols_table *tb,
-		     struct libscols_line *ln,
-		     struct libscols_column *cl,
-		     int (*callback)(struct libscols_table *,
-			            struct libscols_line *,
-				    struct libscols_column *,
-				    void *),
-		    void *data)
+static int walk_callback(struct libscols_table *tb,
+			 struct libscols_line *ln,
+			 struct libscols_column *cl,
+			 int (*callback)(struct libscols_table *,
+					 struct libscols_line *,
+					 struct libscols_column *,
+					 void *),
+			 void *data)
 {
 	int rc = 0;
 
@@ -21,24 +21,49 @@ static int walk_line(struct libscols_table *tb,
 		rc = scols_groups_update_grpset(tb, ln);
 	if (rc == 0)
 		rc = callback(tb, ln, cl, data);
+	return rc;
+}
 
-	/* children */
-	if (rc == 0 && has_children(ln)) {
-		struct list_head *p;
+/*
+ * Walks @top and all its children in pre-order. The walk is iterative, the
+ * next line is found by the parent and sibling pointers, so deep trees do
+ * not consume stack.
+ */
+static int walk_line(struct libscols_table *tb,
+		     struct libscols_line *top,
+		     struct libscols_column *cl,
+		     int (*callback)(struct libscols_table *,
+			            struct libscols_line *,
+				    struct libscols_column *,
+				    void *),
+		    void *data)
+{
+	struct libscols_line *ln = top;
+	int rc = 0;
 
-		DBG(LINE, ul_debugobj(ln, " children walk"));
+	while (ln) {
+		rc = walk_callback(tb, ln, cl, callback, data);
+		if (rc)
+			break;
 
-		list_for_each(p, &ln->ln_branch) {
-			struct libscols_line *chld = list_entry(p,
+		/* children */
+		if (has_children(ln)) {
+			DBG(LINE, ul_debugobj(ln, " children walk"));
+			ln = list_first_entry(&ln->ln_branch,
 					struct libscols_line, ln_children);
-
-			rc = walk_line(tb, chld, cl, callback, data);
-			if (rc)
-				break;
+			continue;
 		}
+
+		/* next sibling of the line or of the nearest parent */
+		while (ln != top && is_last_child(ln))
+			ln = ln->parent;
+		if (ln == top)
+			break;
+		ln = list_entry(ln->ln_children.next,
+				struct libscols_line, ln_children);
 	}
 
-	DBG(LINE, ul_debugobj(ln, "<- walk line done [rc=%d]", rc));
+	DBG(LINE, ul_debugobj(top, "<- walk line done [rc=%d]", rc));
 	return rc;
 }
 
@@ -96,6 +121,8 @@ int scols_walk_tree(struct libscols_table *tb,
 	tb->ngrpchlds_pending = 0;
 	tb->walk_last_tree_root = NULL;
 	tb->walk_last_done = 0;
+	tb->walk_active = 1;
+	tb->tree_art_line = NULL;
 
 	if (has_groups(tb))
 		scols_groups_reset_state(tb);
@@ -147,6 +174,8 @@ int scols_walk_tree(struct libscols_table *tb,
 
 	tb->ngrpchlds_pending = 0;
 	tb->walk_last_done = 0;
+	tb->walk_active = 0;
+	tb->tree_art_line = NULL;
 	DBG(TAB, ul_debugobj(tb, "<< walk end [rc=%d]", rc));
 	return rc;
 }
@@ -65,6 +65,9 @@
 #ifdef HAVE_SYS_UN_H
 #include <sys/un.h>
 #endif
+#if defined(HAVE_UUIDD) && defined(HAVE_SYS_UN_H)
+#include <sys/mman.h>
+#endif
 #ifdef HAVE_SYS_SOCKIO_H
 #include <sys/sockio.h>
 #endif
@@ -89,6 +92,7 @@
 #include "c.h"
 #include "md5.h"
 #include "sha1.h"
+#include "env.h"
 
 #ifdef HAVE_TLS
 #define THREAD_LOCAL static __thread
@@ -210,6 +214,12 @@ static int get_node_id(unsigned char *node_id)
 /* Assume that the gettimeofday() has microsecond granularity */
 #define MAX_ADJUSTMENT 10
 
+/* Max number of time ticks reserved in the clock file by one thread */
+#define MAX_CLOCK_RANGE 10000
+
+/* Max number of time ticks reserved by one request in uuid_generate_time_bulk() */
+#define MAX_BULK_RANGE 1000000
+
 /*
  * Get clock from global sequence clock counter.
  *
@@ -333,6 +343,44 @@ try_again:
 
 #if defined(HAVE_UUIDD) && defined(HAVE_SYS_UN_H)
 
+/* Returns path to uuidd socket or $LIBUUID_UUIDD_SOCKET (for tests). */
+static const char *uuidd_socket_path(void)
+{
+	const char *p = safe_getenv("LIBUUID_UUIDD_SOCKET");
+	return p ? : UUIDD_SOCKET_PATH;
+}
+
+/* Returns path to uuidd --ring file or $LIBUUID_UUIDD_RING (for tests). */
+static const char *uuidd_ring_path(void)
+{
+	const char *p = safe_getenv("LIBUUID_UUIDD_RING");
+	return p ? : UUIDD_RING_PATH;
+}
+
+/* Returns socket connected to uuidd or -1. */
+static int connect_daemon(void)
+{
+	struct sockaddr_un srv_addr;
+	const char *path = uuidd_socket_path();
+	int s;
+
+	if (strlen(path) >= sizeof(srv_addr.sun_path))
+		return -1;
+
+	if ((s = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+		return -1;
+
+	srv_addr.sun_family = AF_UNIX;
+	xstrncpy(srv_addr.sun_path, path, sizeof(srv_addr.sun_path));
+
+	if (connect(s, (const struct sockaddr *) &srv_addr,
+		    sizeof(struct sockaddr_un)) < 0) {
+		close(s);
+		return -1;
+	}
+	return s;
+}
+
 /*
  * Try using the uuidd daemon to generate the UUID
  *
@@ -345,21 +393,10 @@ static int get_uuid_via_daemon(int op, uuid_t out, int *num)
 	int s;
 	ssize_t ret;
 	int32_t reply_len = 0, expected = 16;
-	struct sockaddr_un srv_addr;
-
-	if (sizeof(UUIDD_SOCKET_PATH) > sizeof(srv_addr.sun_path))
-		return -1;
 
-	if ((s = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+	if ((s = connect_daemon()) < 0)
 		return -1;
 
-	srv_addr.sun_family = AF_UNIX;
-	xstrncpy(srv_addr.sun_path, UUIDD_SOCKET_PATH, sizeof(srv_addr.sun_path));
-
-	if (connect(s, (const struct sockaddr *) &srv_addr,
-		    sizeof(struct sockaddr_un)) < 0)
-		goto fail;
-
 	op_buf[0] = op;
 	op_len = 1;
 	if (op == UUIDD_OP_BULK_TIME_UUID) {
@@ -382,7 +419,7 @@ static int get_uuid_via_daemon(int op, uuid_t out, int *num)
 	ret = read_all(s, op_buf, reply_len);
 
 	if (op == UUIDD_OP_BULK_TIME_UUID)
-		memcpy(op_buf+16, num, sizeof(int));
+		memcpy(num, op_buf+16, sizeof(int));
 
 	memcpy(out, op_buf, 16);
 
@@ -394,6 +431,216 @@ fail:
 	return -1;
 }
 
+/*
+ * The shared-memory ring exported by uuidd (see uuidd.h). The ring is mapped
+ * once per process; if uuidd has been restarted, the new ring is mapped and
+ * the old mapping is left alone, because other threads may still use it.
+ */
+struct ring_map {
+	struct uuidd_ring	*ring;
+	uint64_t		mask;
+	dev_t			dev;
+	ino_t			ino;
+};
+
+static struct ring_map *ring_current;
+static time_t ring_checked;
+
+/*
+ * The clients have to write to the ring, so it cannot be mapped read-only.
+ * The ring file is accepted only if it's owned by the owner of the ring
+ * directory (uuidd) or by root, it is not writable for others and its size
+ * matches the header. The header is read before mmap(), so the size of the
+ * mapping does not depend on the mapped data.
+ *
+ * Note that the ring group members are trusted, they are able to truncate
+ * the file and crash the clients (SIGBUS).
+ */
+static int ring_check_file(const char *path, int fd, struct stat *st,
+			   uint32_t *nslots)
+{
+	struct uuidd_ring hdr;
+	struct stat dir;
+	char *dirpath, *p;
+	int rc;
+
+	if (fstat(fd, st) != 0 || !S_ISREG(st->st_mode)
+	    || (st->st_mode & S_IWOTH))
+		return -1;
+
+	dirpath = strdup(path);
+	if (!dirpath)
+		return -1;
+	p = strrchr(dirpath, '/');
+	if (p && p != dirpath)
+		*p = '\0';
+	else
+		strcpy(dirpath, p ? "/" : ".");
+	rc = stat(dirpath, &dir);
+	free(dirpath);
+	if (rc != 0 || (st->st_uid != 0 && st->st_uid != dir.st_uid))
+		return -1;
+
+	if (pread(fd, &hdr, sizeof(hdr), 0) != (ssize_t) sizeof(hdr))
+		return -1;
+	if (hdr.magic != UUIDD_RING_MAGIC || hdr.version != UUIDD_RING_VERSION
+	    || !hdr.nslots || (hdr.nslots & (hdr.nslots - 1))
+	    || hdr.nslots > UUIDD_RING_NSLOTS * 1024	/* sanity */
+	    || (uint64_t) st->st_size != UUIDD_RING_SIZE((uint64_t) hdr.nslots))
+		return -1;
+
+	*nslots = hdr.nslots;
+	return 0;
+}
+
+static struct ring_map *ring_open(void)
+{
+	const char *path = uuidd_ring_path();
+	struct ring_map *rm = NULL;
+	struct uuidd_ring *r;
+	struct stat st;
+	uint32_t nslots;
+	int fd;
+
+	fd = open(path, O_RDWR | O_CLOEXEC | O_NOFOLLOW);
+	if (fd < 0)
+		return NULL;
+	if (ring_check_file(path, fd, &st, &nslots) != 0)
+		goto done;
+
+	r = mmap(NULL, UUIDD_RING_SIZE(nslots), PROT_READ | PROT_WRITE,
+		 MAP_SHARED, fd, 0);
+	if (r == MAP_FAILED)
+		goto done;
+
+	if (r->nslots != nslots || !(rm = malloc(sizeof(*rm)))) {
+		munmap(r, UUIDD_RING_SIZE(nslots));
+		goto done;
+	}
+	rm->ring = r;
+	rm->mask = nslots - 1;
+	rm->dev = st.st_dev;
+	rm->ino = st.st_ino;
+done:
+	close(fd);
+	return rm;
+}
+
+/*
+ * Returns the ring or NULL. The ring file is opened (or checked for a new
+ * ring if @recheck is true) at most once per second.
+ */
+static struct ring_map *ring_get(int recheck)
+{
+	struct ring_map *rm = __atomic_load_n(&ring_current, __ATOMIC_ACQUIRE);
+	struct ring_map *new;
+	struct stat st;
+	time_t now;
+
+	if (rm && !recheck)
+		return rm;
+
+	now = time(NULL);
+	if (now == __atomic_load_n(&ring_checked, __ATOMIC_RELAXED))
+		return rm;
+	__atomic_store_n(&ring_checked, now, __ATOMIC_RELAXED);
+
+	if (rm && (stat(uuidd_ring_path(), &st) != 0
+		   || (st.st_dev == rm->dev && st.st_ino == rm->ino)))
+		return rm;
+
+	new = ring_open();
+	if (!new)
+		return rm;
+	if (!__atomic_compare_exchange_n(&ring_current, &rm, new, 0,
+					 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		/* mapped by another thread */
+		munmap(new->ring, UUIDD_RING_SIZE(new->mask + 1));
+		free(new);
+	}
+	return __atomic_load_n(&ring_current, __ATOMIC_ACQUIRE);
+}
+
+/* asks uuidd to refill the ring, does not wait for the reply */
+static void ring_wakeup(struct uuidd_ring *r)
+{
+	char op = UUIDD_OP_RING_REFILL;
+	int s;
+
+	if (__atomic_exchange_n(&r->wakeup, 1, __ATOMIC_ACQ_REL))
+		return;		/* already requested */
+
+	s = connect_daemon();
+	if (s < 0 || write(s, &op, sizeof(op)) != sizeof(op))
+		__atomic_store_n(&r->wakeup, 0, __ATOMIC_RELEASE);
+	if (s >= 0)
+		close(s);
+}
+
+/*
+ * Claims the time range from the ring. The ranges older than one second are
+ * discarded (as the local cache in uuid_generate_time_generic()).
+ *
+ * Returns 0 on success, non-zero if the ring is not available or empty.
+ */
+static int get_uuid_via_ring(uuid_t out, int *num)
+{
+	struct ring_map *rm = ring_get(0);
+	struct uuidd_ring *r;
+	time_t now;
+	uint64_t pos;
+	int rc = -1;
+
+	if (!rm)
+		return -1;
+
+	r = rm->ring;
+	now = time(NULL);
+	pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+
+	while (1) {
+		struct uuidd_ring_slot *sl = &r->slots[pos & rm->mask];
+		uint64_t seq = __atomic_load_n(&sl->seq, __ATOMIC_ACQUIRE);
+		uint64_t head;
+		int64_t stamp;
+		uint32_t count;
+
+		if (seq != pos + 1) {
+			if ((int64_t) (seq - (pos + 1)) < 0)
+				break;			/* empty */
+			/* claimed by another client, try the next slot */
+			head = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+			if (head == pos)
+				break;			/* inconsistent ring */
+			pos = head;
+			continue;
+		}
+		if (!__atomic_compare_exchange_n(&r->head, &pos, pos + 1, 0,
+						 __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+			continue;
+
+		memcpy(out, sl->first, sizeof(uuid_t));
+		count = sl->count;
+		stamp = sl->stamp;
+		__atomic_store_n(&sl->seq, pos + rm->mask + 1, __ATOMIC_RELEASE);
+		pos++;
+
+		if (count && count <= MAX_BULK_RANGE && now <= stamp + 1) {
+			*num = count;
+			rc = 0;
+			break;
+		}
+	}
+
+	if (rc != 0)
+		/* maybe uuidd has been restarted with a new ring */
+		rm = ring_get(1);
+	if (rm && (rc != 0 || __atomic_load_n(&rm->ring->tail, __ATOMIC_ACQUIRE) - pos
+				<= (rm->mask + 1) / 2))
+		ring_wakeup(rm->ring);
+	return rc;
+}
+
 #else /* !defined(HAVE_UUIDD) && defined(HAVE_SYS_UN_H) */
 static int get_uuid_via_daemon(int op __attribute__((__unused__)),
 				uuid_t out __attribute__((__unused__)),
@@ -401,6 +648,12 @@ static int get_uuid_via_daemon(int op __attribute__((__unused__)),
 {
 	return -1;
 }
+
+static int get_uuid_via_ring(uuid_t out __attribute__((__unused__)),
+			     int *num __attribute__((__unused__)))
+{
+	return -1;
+}
 #endif
 
 int __uuid_generate_time(uuid_t out, int *num)
@@ -432,6 +685,80 @@ int __uuid_generate_time(uuid_t out, int *num)
 	return ret;
 }
 
+/* the next UUID in the time range */
+static inline void uuid_time_next(struct uuid *uu)
+{
+	uu->time_low++;
+	if (uu->time_low == 0) {
+		uu->time_mid++;
+		if (uu->time_mid == 0)
+			uu->time_hi_and_version++;
+	}
+}
+
+/* fills @n UUIDs in @out array, the first UUID is the start of the range */
+static void fill_time_range(uuid_t *out, size_t n)
+{
+	struct uuid uu;
+	size_t i;
+
+	uuid_unpack(out[0], &uu);
+	for (i = 1; i < n; i++) {
+		uuid_time_next(&uu);
+		uuid_pack(&uu, out[i]);
+	}
+}
+
+#ifdef HAVE_TLS
+/*
+ * Thread local cache of the time-based UUIDs, the rest of the range reserved
+ * by the last request.
+ */
+static __thread struct uuid_time_cache {
+	int		num;		/* number of cached UUIDs after @uu */
+	int		size;		/* size of the next range */
+	struct uuid	uu;		/* the last used UUID */
+	time_t		last_time;
+	pid_t		last_pid;
+} time_cache = { .size = 1 };
+
+/* keeps @num UUIDs after @last in the cache */
+static void time_cache_set(const uuid_t last, int num)
+{
+	time_cache.last_time = time(NULL);
+	time_cache.last_pid = getpid();
+	uuid_unpack(last, &time_cache.uu);
+	time_cache.num = num;
+}
+
+/* returns 0 if the next UUID has been taken from the cache */
+static int time_cache_next(uuid_t out)
+{
+	if (time_cache.num <= 0)
+		return -1;
+	if (time(NULL) > time_cache.last_time + 1
+	    /* the cache is inherited by a child after fork() */
+	    || getpid() != time_cache.last_pid) {
+		time_cache.num = 0;
+		return -1;
+	}
+	uuid_time_next(&time_cache.uu);
+	time_cache.num--;
+	uuid_pack(&time_cache.uu, out);
+	return 0;
+}
+#else
+/* no cache, it would be shared by all threads */
+static inline void time_cache_set(const uuid_t last __attribute__((__unused__)),
+				  int num __attribute__((__unused__)))
+{
+}
+static inline int time_cache_next(uuid_t out __attribute__((__unused__)))
+{
+	return -1;
+}
+#endif /* HAVE_TLS */
+
 /*
  * Generate time-based UUID and store it to @out
  *
@@ -439,56 +766,55 @@ int __uuid_generate_time(uuid_t out, int *num)
  * or, if uuidd is not usable, by using the global clock state counter (see get_clock()).
  * If neither of these is possible (e.g. because of insufficient permissions), it generates
  * the UUID anyway, but returns -1. Otherwise, returns 0.
+ *
+ * The UUIDs are obtained in ranges (from the uuidd ring, from uuidd or reserved
+ * in the clock file) and the rest of the range is kept in a thread local cache,
+ * so the clock file is locked and rewritten only when the range is exhausted.
  */
 static int uuid_generate_time_generic(uuid_t out) {
 #ifdef HAVE_TLS
-	THREAD_LOCAL int		num = 0;
-	THREAD_LOCAL int		cache_size = 1;
-	THREAD_LOCAL struct uuid	uu;
-	THREAD_LOCAL time_t		last_time = 0;
-	time_t				now;
-
-	if (num > 0) {
-		now = time(NULL);
-		if (now > last_time+1)
-			num = 0;
+	int num;
+
+	if (time_cache_next(out) == 0)
+		return 0;
+	/*
+	 * The cache provides a local range in each application. Start with a
+	 * small cache size to cover short running applications and increment
+	 * the cache size over the runntime.
+	 */
+	if (time_cache.size < 1000000)
+		time_cache.size *= 10;
+
+	if (get_uuid_via_ring(out, &num) == 0) {
+		time_cache_set(out, num - 1);
+		return 0;
 	}
-	if (num <= 0) {
-		/*
-		 * num + OP_BULK provides a local cache in each application.
-		 * Start with a small cache size to cover short running applications
-		 * and increment the cache size over the runntime.
-		 */
-		if (cache_size < 1000000)
-			cache_size *= 10;
-		num = cache_size;
-
-		if (get_uuid_via_daemon(UUIDD_OP_BULK_TIME_UUID,
-					out, &num) == 0) {
-			last_time = time(NULL);
-			uuid_unpack(out, &uu);
-			num--;
-			return 0;
-		}
-		num = 0;
+
+	num = time_cache.size;
+	if (get_uuid_via_daemon(UUIDD_OP_BULK_TIME_UUID, out, &num) == 0) {
+		time_cache_set(out, num - 1);
+		return 0;
 	}
-	if (num > 0) {
-		uu.time_low++;
-		if (uu.time_low == 0) {
-			uu.time_mid++;
-			if (uu.time_mid == 0)
-				uu.time_hi_and_version++;
-		}
-		num--;
-		uuid_pack(&uu, out);
+
+	/*
+	 * uuidd is not usable, reserve the range in the clock file. The
+	 * range is smaller than from uuidd, because it's per-thread.
+	 */
+	num = min(time_cache.size, MAX_CLOCK_RANGE);
+
+	if (__uuid_generate_time(out, &num) == 0) {
+		time_cache_set(out, num - 1);
 		return 0;
 	}
+	/* the clock file is not usable, don't cache unsafe UUIDs */
+	time_cache.num = 0;
+	return -1;
 #else
 	if (get_uuid_via_daemon(UUIDD_OP_TIME_UUID, out, 0) == 0)
 		return 0;
-#endif
 
 	return __uuid_generate_time(out, NULL);
+#endif
 }
 
 /*
@@ -507,33 +833,285 @@ int uuid_generate_time_safe(uuid_t out)
 	return uuid_generate_time_generic(out);
 }
 
+/*
+ * Generate @n time-based UUIDs and store them to @out array. The UUIDs are
+ * obtained from uuidd or reserved in the clock file by one request (for up to
+ * MAX_BULK_RANGE UUIDs) and the rest is calculated locally. The thread local
+ * cache of uuid_generate_time() is used first, and the unused rest of a range
+ * from the uuidd ring is kept there.
+ *
+ * Returns 0 if all the UUIDs have been generated in a safe manner, -1
+ * otherwise (see uuid_generate_time_safe()).
+ */
+int uuid_generate_time_bulk(uuid_t *out, size_t n)
+{
+	int rc = 0;
 
-int __uuid_generate_random(uuid_t out, int *num)
+	/* the rest of the range reserved by the previous request */
+	while (n > 0 && time_cache_next(*out) == 0) {
+		out++;
+		n--;
+	}
+	while (n > 0) {
+		int num, rest = 0, req = n > MAX_BULK_RANGE ? MAX_BULK_RANGE : (int) n;
+
+		if (req <= UUIDD_RING_RANGE && get_uuid_via_ring(*out, &num) == 0) {
+			/* the rest of the range is used by the next request */
+			if (num > req) {
+				rest = num - req;
+				num = req;
+			}
+		} else {
+			num = req;
+			if (get_uuid_via_daemon(UUIDD_OP_BULK_TIME_UUID, *out, &num) != 0) {
+				num = req;
+				if (__uuid_generate_time(*out, &num) != 0)
+					rc = -1;
+			}
+		}
+		if (num < 1 || num > req)
+			num = 1;
+
+		fill_time_range(out, num);
+		if (rest)
+			time_cache_set(out[num - 1], rest);
+		out += num;
+		n -= num;
+	}
+	return rc;
+}
+
+
+/* converts time-based UUID (v1) to the time-ordered UUID (v6) */
+static void uuid_set_v6(struct uuid *uu)
 {
-	uuid_t	buf;
-	struct uuid uu;
-	int i, n, r = 0;
+	uint64_t t = ((uint64_t) (uu->time_hi_and_version & 0x0FFF) << 48)
+		     | ((uint64_t) uu->time_mid << 32)
+		     | uu->time_low;
 
-	if (!num || !*num)
-		n = 1;
-	else
-		n = *num;
+	uu->time_low = t >> 28;
+	uu->time_mid = (t >> 12) & 0xFFFF;
+	uu->time_hi_and_version = (t & 0x0FFF) | 0x6000;
+}
+
+static void uuid_to_v6(uuid_t *out, size_t n)
+{
+	struct uuid uu;
+	size_t i;
 
 	for (i = 0; i < n; i++) {
-		if (ul_random_get_bytes(buf, sizeof(buf)))
+		uuid_unpack(out[i], &uu);
+		uuid_set_v6(&uu);
+		uuid_pack(&uu, out[i]);
+	}
+}
+
+/*
+ * Fills @num time-ordered (v6) UUIDs in @out array, the range is reserved in
+ * the clock file by one request. This is uuidd specific, libuuid users get
+ * the UUIDs by uuid_generate_time_v6() or uuid_generate_time_v6_bulk().
+ */
+int __uuid_generate_time_v6(uuid_t out, int *num)
+{
+	int ret, n = num && *num > 0 ? *num : 1;
+
+	ret = __uuid_generate_time(out, &n);
+
+	fill_time_range((uuid_t *) out, n);
+	uuid_to_v6((uuid_t *) out, n);
+	return ret;
+}
+
+/*
+ * Generate time-ordered (v6) UUID. The v6 UUID is the same as time-based (v1)
+ * UUID, but the timestamp is stored from the most significant bits, so the
+ * UUIDs are sortable by time as strings or binary.
+ */
+void uuid_generate_time_v6(uuid_t out)
+{
+	(void) uuid_generate_time_generic(out);
+	uuid_to_v6((uuid_t *) out, 1);
+}
+
+/*
+ * Generate @n time-ordered (v6) UUIDs, see uuid_generate_time_bulk().
+ */
+int uuid_generate_time_v6_bulk(uuid_t *out, size_t n)
+{
+	int rc = uuid_generate_time_bulk(out, n);
+
+	uuid_to_v6(out, n);
+	return rc;
+}
+
+static inline uint64_t get_v7_now(void)
+{
+	struct timeval	tv;
+	uint64_t	now;
+
+	gettimeofday(&tv, NULL);
+	now = ((uint64_t) tv.tv_sec * 1000 + tv.tv_usec / 1000) << 12;
+	now |= (tv.tv_usec % 1000) * 4096 / 1000;
+	return now;
+}
+
+/*
+ * The time-ordered (v7) UUIDs use 48-bit Unix time in milliseconds, the
+ * 12-bit rand_a field is used for sub-millisecond precision (RFC 9562,
+ * section 6.2, method 3). The 60-bit stamp is incremented if the clock did not
+ * move since the last UUID, so UUIDs generated by one thread are strictly
+ * monotonic. The monotonicity is per thread only, every thread has its own
+ * state and no locking is necessary; the UUIDs from different threads and
+ * processes differ in the 62 random bits.
+ *
+ * Without thread local storage the state is shared by all threads and it's
+ * updated atomically.
+ *
+ * Returns the first of @n reserved stamps.
+ */
+static uint64_t get_v7_stamp(size_t n)
+{
+#ifdef HAVE_TLS
+	THREAD_LOCAL uint64_t	last = 0;
+	uint64_t		now = get_v7_now();
+
+	if (now <= last)
+		now = last + 1;
+	last = now + n - 1;
+	return now;
+#else
+	static uint64_t	last;
+	uint64_t	now, prev = __atomic_load_n(&last, __ATOMIC_RELAXED);
+
+	do {
+		now = get_v7_now();
+		if (now <= prev)
+			now = prev + 1;
+	} while (!__atomic_compare_exchange_n(&last, &prev, now + n - 1, 0,
+					      __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	return now;
+#endif
+}
+
+/*
+ * The random bits for single v7 UUIDs are read in larger blocks and kept in a
+ * thread local pool, getrandom() per UUID is more expensive than the rest of
+ * the generation. The pool is dropped after fork().
+ */
+#define V7_RANDOM_POOLSZ	512
+
+static int get_v7_random(unsigned char *buf, size_t sz)
+{
+#ifdef HAVE_TLS
+	THREAD_LOCAL unsigned char	pool[V7_RANDOM_POOLSZ];
+	THREAD_LOCAL size_t		left = 0;
+	THREAD_LOCAL pid_t		pool_pid = 0;
+	THREAD_LOCAL int		pool_rc = 0;
+	pid_t				pid = getpid();
+
+	if (sz > sizeof(pool))
+		return ul_random_get_bytes(buf, sz);
+
+	if (left < sz || pid != pool_pid) {
+		pool_rc = ul_random_get_bytes(pool, sizeof(pool));
+		left = sizeof(pool);
+		pool_pid = pid;
+	}
+	memcpy(buf, pool + sizeof(pool) - left, sz);
+	left -= sz;
+	return pool_rc;
+#else
+	return ul_random_get_bytes(buf, sz);
+#endif
+}
+
+static int generate_v7(unsigned char *out, size_t n)
+{
+	uint64_t stamp;
+	size_t i;
+	int r = 0;
+
+	/* single UUID needs random rand_b only, the rest is overwritten */
+	if (n == 1) {
+		if (get_v7_random(out + 8, 8))
 			r = -1;
-		uuid_unpack(buf, &uu);
+	} else if (ul_random_get_bytes(out, n * sizeof(uuid_t)))
+		r = -1;
+
+	stamp = get_v7_stamp(n);
+
+	for (i = 0; i < n; i++, stamp++) {
+		uint64_t ms = stamp >> 12;
+
+		out[0] = ms >> 40;
+		out[1] = ms >> 32;
+		out[2] = ms >> 24;
+		out[3] = ms >> 16;
+		out[4] = ms >> 8;
+		out[5] = ms;
+		out[6] = 0x70 | ((stamp >> 8) & 0x0F);	/* version 7 */
+		out[7] = stamp & 0xFF;
+		out[8] = (out[8] & 0x3F) | 0x80;	/* DCE variant */
+		out += sizeof(uuid_t);
+	}
+
+	return r;
+}
+
+/*
+ * Generate time-ordered (v7) UUID based on Unix time and random bits.
+ */
+void uuid_generate_time_v7(uuid_t out)
+{
+	(void) generate_v7(out, 1);
+}
+
+/*
+ * Generate @n time-ordered (v7) UUIDs by one random bytes request.
+ *
+ * Returns 0 if high-quality randomness has been used, -1 otherwise.
+ */
+int uuid_generate_time_v7_bulk(uuid_t *out, size_t n)
+{
+	if (!n)
+		return 0;
+	return generate_v7(*out, n);
+}
 
-		uu.clock_seq = (uu.clock_seq & 0x3FFF) | 0x8000;
-		uu.time_hi_and_version = (uu.time_hi_and_version & 0x0FFF)
-			| 0x4000;
-		uuid_pack(&uu, out);
+/*
+ * Fills @n UUIDs in @out by one random bytes request and sets the version
+ * and variant bits (the same as uuid_unpack(), modify clock_seq and
+ * time_hi_and_version, uuid_pack(), but in place).
+ */
+static int generate_random(unsigned char *out, size_t n)
+{
+	size_t i;
+	int r = 0;
+
+	if (ul_random_get_bytes(out, n * sizeof(uuid_t)))
+		r = -1;
+
+	for (i = 0; i < n; i++) {
+		out[6] = (out[6] & 0x0F) | 0x40;	/* version 4 */
+		out[8] = (out[8] & 0x3F) | 0x80;	/* DCE variant */
 		out += sizeof(uuid_t);
 	}
 
 	return r;
 }
 
+int __uuid_generate_random(uuid_t out, int *num)
+{
+	int n;
+
+	if (!num || !*num)
+		n = 1;
+	else
+		n = *num;
+
+	return generate_random(out, n);
+}
+
 void uuid_generate_random(uuid_t out)
 {
 	int	num = 1;
@@ -542,6 +1120,18 @@ void uuid_generate_random(uuid_t out)
 	__uuid_generate_random(out, &num);
 }
 
+/*
+ * Generate @n random-based UUIDs and store them to @out array.
+ *
+ * Returns 0 if high-quality randomness has been used, -1 otherwise.
+ */
+int uuid_generate_random_bulk(uuid_t *out, size_t n)
+{
+	if (!n)
+		return 0;
+	return generate_random(*out, n);
+}
+
 /*
  * This is the generic front-end to __uuid_generate_random and
  * uuid_generate_time.  It uses __uuid_generate_random output
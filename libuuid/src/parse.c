@@ -33,13 +33,64 @@
  */
 
 #include <stdlib.h>
-#include <stdio.h>
-#include <ctype.h>
 #include <string.h>
 
 #include "c.h"
 #include "uuidP.h"
 
+/* hex digit values, -1 for invalid characters */
+static const signed char hexval[256] = {
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, -1, -1, -1, -1, -1, -1,
+	-1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+/* offsets of the bytes in the UUID string */
+static const unsigned char hexpos[16] = {
+	0, 2, 4, 6, 9, 11, 14, 16, 19, 21, 24, 26, 28, 30, 32, 34
+};
+
+/*
+ * Converts 36 characters from @in to @uu. All the characters are decoded
+ * by the table and the result is checked once at the end, so there is no
+ * branch per character. The @uu is not modified on error.
+ */
+static int parse_uuid_str(const char *in, uuid_t uu)
+{
+	const unsigned char *cp = (const unsigned char *) in;
+	uuid_t tmp;
+	int i, bad = 0;
+
+	if (in[8] != '-' || in[13] != '-' || in[18] != '-' || in[23] != '-')
+		return -1;
+
+	for (i = 0; i < 16; i++) {
+		int hi = hexval[cp[hexpos[i]]],
+		    lo = hexval[cp[hexpos[i] + 1]];
+
+		bad |= hi | lo;
+		tmp[i] = (hi << 4) | lo;
+	}
+	if (bad < 0)
+		return -1;
+
+	memcpy(uu, tmp, sizeof(tmp));
+	return 0;
+}
+
 int uuid_parse(const char *in, uuid_t uu)
 {
 	size_t len = strlen(in);
@@ -51,48 +102,30 @@ int uuid_parse(const char *in, uuid_t uu)
 
 int uuid_parse_range(const char *in_start, const char *in_end, uuid_t uu)
 {
-	struct uuid	uuid;
-	int		i;
-	const char	*cp;
-	char		buf[3];
-
 	if ((in_end - in_start) != 36)
 		return -1;
-	for (i=0, cp = in_start; i < 36; i++,cp++) {
-		if ((i == 8) || (i == 13) || (i == 18) ||
-		    (i == 23)) {
-			if (*cp == '-')
-				continue;
-			return -1;
-		}
 
-		if (!isxdigit(*cp))
-			return -1;
-	}
-	errno = 0;
-	uuid.time_low = strtoul(in_start, NULL, 16);
-
-	if (!errno)
-		uuid.time_mid = strtoul(in_start+9, NULL, 16);
-	if (!errno)
-		uuid.time_hi_and_version = strtoul(in_start+14, NULL, 16);
-	if (!errno)
-		uuid.clock_seq = strtoul(in_start+19, NULL, 16);
-	if (errno)
-		return -1;
+	return parse_uuid_str(in_start, uu);
+}
 
-	cp = in_start+24;
-	buf[2] = 0;
-	for (i=0; i < 6; i++) {
-		buf[0] = *cp++;
-		buf[1] = *cp++;
+/*
+ * Converts @n strings from @in to @out array. The strings are expected in
+ * the array of UUID_STR_LEN bytes long items (as written by
+ * uuid_unparse_bulk()), only the first 36 characters of every item are used.
+ * The invalid strings are converted to the null UUID.
+ *
+ * Returns the number of invalid strings.
+ */
+int uuid_parse_bulk(const char *in, size_t n, uuid_t *out)
+{
+	size_t i;
+	int bad = 0;
 
-		errno = 0;
-		uuid.node[i] = strtoul(buf, NULL, 16);
-		if (errno)
-			return -1;
+	for (i = 0; i < n; i++, in += UUID_STR_LEN) {
+		if (parse_uuid_str(in, out[i]) != 0) {
+			memset(out[i], 0, sizeof(uuid_t));
+			bad++;
+		}
 	}
-
-	uuid_pack(&uuid, uu);
-	return 0;
+	return bad;
 }
@@ -0,0 +1,194 @@
+/*
+ * This file may be redistributed under the terms of the
+ * GNU Lesser General Public License.
+ *
+ * Measures UUIDs generation throughput and properties relevant for database
+ * indexes (how many UUIDs are generated in ascending order), and conversion
+ * of UUIDs to strings and back.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "c.h"
+#include "nls.h"
+#include "strutils.h"
+#include "uuid.h"
+
+struct uuid_gen {
+	const char *name;
+	void (*gen)(uuid_t);
+	int (*bulk)(uuid_t *, size_t);
+};
+
+static const struct uuid_gen gens[] = {
+	{ "time",    uuid_generate_time,    uuid_generate_time_bulk },
+	{ "random",  uuid_generate_random,  uuid_generate_random_bulk },
+	{ "time-v6", uuid_generate_time_v6, uuid_generate_time_v6_bulk },
+	{ "time-v7", uuid_generate_time_v7, uuid_generate_time_v7_bulk }
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void __attribute__((__noreturn__)) usage(void)
+{
+	FILE *out = stdout;
+	size_t i;
+
+	fprintf(out,
+		"\n %s [options] [<type> ...]\n\n", program_invocation_short_name);
+
+	fputs(" -n, --count <num>              number of UUIDs (default 1000000)\n", out);
+	fputs(" -h, --help                     this help\n", out);
+	fputs("\nTypes:", out);
+	for (i = 0; i < ARRAY_SIZE(gens); i++)
+		fprintf(out, " %s", gens[i].name);
+	fputs(" convert\n\n", out);
+
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ * The UUIDs in ascending order are inserted to the end of the index. The
+ * "ordered" is percentage of UUIDs greater than the previous one and the
+ * "append" is percentage of UUIDs greater than all the previous UUIDs (the
+ * rightmost leaf page insertion).
+ */
+static void print_order(uuid_t *uus, size_t n)
+{
+	size_t i, ordered = 0, append = 0, max = 0;
+
+	for (i = 1; i < n; i++) {
+		if (memcmp(uus[i], uus[i - 1], sizeof(uuid_t)) > 0)
+			ordered++;
+		if (memcmp(uus[i], uus[max], sizeof(uuid_t)) > 0) {
+			append++;
+			max = i;
+		}
+	}
+	printf("  ordered: %6.2f %%  append: %6.2f %%\n",
+		n > 1 ? ordered * 100.0 / (n - 1) : 100.0,
+		n > 1 ? append * 100.0 / (n - 1) : 100.0);
+}
+
+static void run(const struct uuid_gen *g, uuid_t *uus, size_t n)
+{
+	double t0, t1;
+	size_t i;
+
+	printf("%s:\n", g->name);
+
+	t0 = now();
+	for (i = 0; i < n; i++)
+		g->gen(uus[i]);
+	t1 = now();
+	printf("  single:  %8.3f s  %12.0f UUIDs/s\n", t1 - t0, n / (t1 - t0));
+	print_order(uus, n);
+
+	t0 = now();
+	g->bulk(uus, n);
+	t1 = now();
+	printf("  bulk:    %8.3f s  %12.0f UUIDs/s\n", t1 - t0, n / (t1 - t0));
+}
+
+static void run_convert(uuid_t *uus, size_t n)
+{
+	char *strs = malloc(n * UUID_STR_LEN);
+	double t0, t1;
+	size_t i;
+
+	if (!strs)
+		err(EXIT_FAILURE, "failed to allocate strings");
+
+	uuid_generate_random_bulk(uus, n);
+
+	printf("unparse:\n");
+	t0 = now();
+	for (i = 0; i < n; i++)
+		uuid_unparse(uus[i], strs + i * UUID_STR_LEN);
+	t1 = now();
+	printf("  single:  %8.3f s  %12.0f UUIDs/s\n", t1 - t0, n / (t1 - t0));
+
+	t0 = now();
+	uuid_unparse_bulk(uus, n, strs);
+	t1 = now();
+	printf("  bulk:    %8.3f s  %12.0f UUIDs/s\n", t1 - t0, n / (t1 - t0));
+
+	printf("parse:\n");
+	t0 = now();
+	for (i = 0; i < n; i++) {
+		if (uuid_parse(strs + i * UUID_STR_LEN, uus[i]) != 0)
+			errx(EXIT_FAILURE, "failed to parse %s", strs + i * UUID_STR_LEN);
+	}
+	t1 = now();
+	printf("  single:  %8.3f s  %12.0f UUIDs/s\n", t1 - t0, n / (t1 - t0));
+
+	t0 = now();
+	if (uuid_parse_bulk(strs, n, uus) != 0)
+		errx(EXIT_FAILURE, "failed to parse UUIDs");
+	t1 = now();
+	printf("  bulk:    %8.3f s  %12.0f UUIDs/s\n", t1 - t0, n / (t1 - t0));
+
+	free(strs);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t i, n = 1000000;
+	uuid_t *uus;
+	int c;
+
+	static const struct option longopts[] = {
+		{ "count",    1, NULL, 'n' },
+		{ "help",     0, NULL, 'h' },
+		{ NULL, 0, NULL, 0 },
+	};
+
+	while((c = getopt_long(argc, argv, "hn:", longopts, NULL)) != -1) {
+		switch(c) {
+		case 'n':
+			n = strtou32_or_err(optarg, "failed to parse number of UUIDs");
+			break;
+		case 'h':
+			usage();
+		default:
+			errtryhelp(EXIT_FAILURE);
+		}
+	}
+
+	if (!n)
+		errx(EXIT_FAILURE, "--count must be greater than zero");
+
+	uus = malloc(n * sizeof(uuid_t));
+	if (!uus)
+		err(EXIT_FAILURE, "failed to allocate UUIDs");
+
+	if (optind == argc) {
+		for (i = 0; i < ARRAY_SIZE(gens); i++)
+			run(&gens[i], uus, n);
+		run_convert(uus, n);
+	}
+	for ( ; optind < argc; optind++) {
+		if (strcmp(argv[optind], "convert") == 0) {
+			run_convert(uus, n);
+			continue;
+		}
+		for (i = 0; i < ARRAY_SIZE(gens); i++) {
+			if (strcmp(argv[optind], gens[i].name) == 0)
+				break;
+		}
+		if (i == ARRAY_SIZE(gens))
+			errx(EXIT_FAILURE, "unsupported type: %s", argv[optind]);
+		run(&gens[i], uus, n);
+	}
+
+	free(uus);
+	return EXIT_SUCCESS;
+}
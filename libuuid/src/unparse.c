@@ -33,44 +33,93 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include "c.h"
 
 #include "uuidP.h"
 
-static char const hexdigits_lower[16] = "0123456789abcdef";
-static char const hexdigits_upper[16] = "0123456789ABCDEF";
+/* two hex digits for every byte value */
+static char const hexpairs_lower[] =
+	"000102030405060708090a0b0c0d0e0f"
+	"101112131415161718191a1b1c1d1e1f"
+	"202122232425262728292a2b2c2d2e2f"
+	"303132333435363738393a3b3c3d3e3f"
+	"404142434445464748494a4b4c4d4e4f"
+	"505152535455565758595a5b5c5d5e5f"
+	"606162636465666768696a6b6c6d6e6f"
+	"707172737475767778797a7b7c7d7e7f"
+	"808182838485868788898a8b8c8d8e8f"
+	"909192939495969798999a9b9c9d9e9f"
+	"a0a1a2a3a4a5a6a7a8a9aaabacadaeaf"
+	"b0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+	"c0c1c2c3c4c5c6c7c8c9cacbcccdcecf"
+	"d0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+	"e0e1e2e3e4e5e6e7e8e9eaebecedeeef"
+	"f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
 
-static void uuid_fmt(const uuid_t uuid, char *buf, char const *restrict fmt)
+static char const hexpairs_upper[] =
+	"000102030405060708090A0B0C0D0E0F"
+	"101112131415161718191A1B1C1D1E1F"
+	"202122232425262728292A2B2C2D2E2F"
+	"303132333435363738393A3B3C3D3E3F"
+	"404142434445464748494A4B4C4D4E4F"
+	"505152535455565758595A5B5C5D5E5F"
+	"606162636465666768696A6B6C6D6E6F"
+	"707172737475767778797A7B7C7D7E7F"
+	"808182838485868788898A8B8C8D8E8F"
+	"909192939495969798999A9B9C9D9E9F"
+	"A0A1A2A3A4A5A6A7A8A9AAABACADAEAF"
+	"B0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+	"C0C1C2C3C4C5C6C7C8C9CACBCCCDCECF"
+	"D0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+	"E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEF"
+	"F0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+#ifdef UUID_UNPARSE_DEFAULT_UPPER
+# define hexpairs_default	hexpairs_upper
+#else
+# define hexpairs_default	hexpairs_lower
+#endif
+
+/* offsets of the bytes in the UUID string */
+static const unsigned char hexpos[16] = {
+	0, 2, 4, 6, 9, 11, 14, 16, 19, 21, 24, 26, 28, 30, 32, 34
+};
+
+static inline void uuid_fmt(const uuid_t uuid, char *buf, char const *restrict fmt)
 {
-	char *p = buf;
 	int i;
 
-	for (i = 0; i < 16; i++) {
-		if (i == 4 || i == 6 || i == 8 || i == 10) {
-			*p++ = '-';
-		}
-		size_t tmp = uuid[i];
-		*p++ = fmt[tmp >> 4];
-		*p++ = fmt[tmp & 15];
-	}
-	*p = '\0';
+	for (i = 0; i < 16; i++)
+		memcpy(buf + hexpos[i], fmt + (uuid[i] << 1), 2);
+
+	buf[8] = buf[13] = buf[18] = buf[23] = '-';
+	buf[36] = '\0';
 }
 
 void uuid_unparse_lower(const uuid_t uu, char *out)
 {
-	uuid_fmt(uu, out, hexdigits_lower);
+	uuid_fmt(uu, out, hexpairs_lower);
 }
 
 void uuid_unparse_upper(const uuid_t uu, char *out)
 {
-	uuid_fmt(uu, out, hexdigits_upper);
+	uuid_fmt(uu, out, hexpairs_upper);
 }
 
 void uuid_unparse(const uuid_t uu, char *out)
 {
-#ifdef UUID_UNPARSE_DEFAULT_UPPER
-	uuid_fmt(uu, out, hexdigits_upper);
-#else
-	uuid_fmt(uu, out, hexdigits_lower);
-#endif
+	uuid_fmt(uu, out, hexpairs_default);
+}
+
+/*
+ * Converts @n UUIDs from @uu array to @out, the output is an array of
+ * UUID_STR_LEN bytes long terminated strings.
+ */
+void uuid_unparse_bulk(const uuid_t *uu, size_t n, char *out)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++, out += UUID_STR_LEN)
+		uuid_fmt(uu[i], out, hexpairs_default);
 }
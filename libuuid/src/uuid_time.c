@@ -53,6 +53,14 @@
 
 #include "uuidP.h"
 
+/* time-based (v1) and time-ordered (v6) UUIDs: 100ns intervals since 1582 */
+static void gregorian_to_unix(uint64_t clock_reg, struct timeval *tv)
+{
+	clock_reg -= (((uint64_t) TIME_OFFSET_HIGH) << 32) + TIME_OFFSET_LOW;
+	tv->tv_sec = clock_reg / 10000000;
+	tv->tv_usec = (clock_reg % 10000000) / 10;
+}
+
 time_t uuid_time(const uuid_t uu, struct timeval *ret_tv)
 {
 	struct timeval		tv;
@@ -62,12 +70,25 @@ time_t uuid_time(const uuid_t uu, struct timeval *ret_tv)
 
 	uuid_unpack(uu, &uuid);
 
-	high = uuid.time_mid | ((uuid.time_hi_and_version & 0xFFF) << 16);
-	clock_reg = uuid.time_low | ((uint64_t) high << 32);
-
-	clock_reg -= (((uint64_t) 0x01B21DD2) << 32) + 0x13814000;
-	tv.tv_sec = clock_reg / 10000000;
-	tv.tv_usec = (clock_reg % 10000000) / 10;
+	switch (uuid.time_hi_and_version >> 12) {
+	case UUID_TYPE_DCE_TIME_V6:
+		clock_reg = ((uint64_t) uuid.time_low << 28)
+			    | ((uint64_t) uuid.time_mid << 12)
+			    | (uuid.time_hi_and_version & 0xFFF);
+		gregorian_to_unix(clock_reg, &tv);
+		break;
+	case UUID_TYPE_DCE_TIME_V7:
+		/* 48-bit Unix time in milliseconds */
+		clock_reg = ((uint64_t) uuid.time_low << 16) | uuid.time_mid;
+		tv.tv_sec = clock_reg / 1000;
+		tv.tv_usec = (clock_reg % 1000) * 1000;
+		break;
+	default:
+		high = uuid.time_mid | ((uuid.time_hi_and_version & 0xFFF) << 16);
+		clock_reg = uuid.time_low | ((uint64_t) high << 32);
+		gregorian_to_unix(clock_reg, &tv);
+		break;
+	}
 
 	if (ret_tv)
 		*ret_tv = tv;
@@ -156,10 +177,16 @@ main(int argc, char **argv)
 	case 4:
 		printf(" (random)\n");
 		break;
+	case 6:
+		printf(" (time-v6)\n");
+		break;
+	case 7:
+		printf(" (time-v7)\n");
+		break;
 	default:
 		printf("\n");
 	}
-	if (type != 1) {
+	if (type != 1 && type != 6 && type != 7) {
 		printf("Warning: not a time-based UUID, so UUID time "
 		       "decoding will likely not work!\n");
 	}
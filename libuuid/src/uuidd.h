@@ -38,6 +38,7 @@
 #define UUIDD_DIR		_PATH_RUNSTATEDIR "/uuidd"
 #define UUIDD_SOCKET_PATH	UUIDD_DIR "/request"
 #define UUIDD_PIDFILE_PATH	UUIDD_DIR "/uuidd.pid"
+#define UUIDD_RING_PATH		UUIDD_DIR "/ring"
 #define UUIDD_PATH		"/usr/sbin/uuidd"
 
 #define UUIDD_OP_GETPID			0
@@ -46,9 +47,52 @@
 #define UUIDD_OP_RANDOM_UUID		3
 #define UUIDD_OP_BULK_TIME_UUID		4
 #define UUIDD_OP_BULK_RANDOM_UUID	5
-#define UUIDD_MAX_OP			UUIDD_OP_BULK_RANDOM_UUID
+#define UUIDD_OP_TIME_V6_UUID		6
+#define UUIDD_OP_TIME_V7_UUID		7
+#define UUIDD_OP_BULK_TIME_V6_UUID	8
+#define UUIDD_OP_BULK_TIME_V7_UUID	9
+#define UUIDD_OP_GET_STATS		10
+#define UUIDD_OP_RING_REFILL		11
+#define UUIDD_MAX_OP			UUIDD_OP_RING_REFILL
+
+/*
+ * Shared-memory ring of time-based UUID ranges (uuidd --ring). The ranges are
+ * reserved by uuidd and claimed by clients without any syscall.
+ *
+ * The slot at position pos (slots[pos % nslots]) is free for uuidd if
+ * seq == pos and ready for clients if seq == pos + 1. A client claims the
+ * slot by incrementing head, copies the range and releases the slot by
+ * seq = pos + nslots. The clients ask uuidd to refill the ring by
+ * UUIDD_OP_RING_REFILL request when the wakeup flag is not set yet.
+ */
+#define UUIDD_RING_MAGIC		0x55524e47	/* "URNG" */
+#define UUIDD_RING_VERSION		1
+#define UUIDD_RING_NSLOTS		64
+#define UUIDD_RING_RANGE		1000
+
+struct uuidd_ring_slot {
+	uint64_t	seq;		/* see above */
+	int64_t		stamp;		/* time() when reserved */
+	uint32_t	count;		/* number of UUIDs in the range */
+	uint32_t	reserved;
+	unsigned char	first[16];	/* the first UUID of the range */
+};
+
+struct uuidd_ring {
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	nslots;		/* power of 2 */
+	uint32_t	wakeup;		/* refill already requested */
+	uint64_t	head;		/* the next slot to claim */
+	uint64_t	tail;		/* the next slot to fill */
+	struct uuidd_ring_slot slots[];
+};
+
+#define UUIDD_RING_SIZE(n) \
+	(sizeof(struct uuidd_ring) + (n) * sizeof(struct uuidd_ring_slot))
 
 extern int __uuid_generate_time(uuid_t out, int *num);
 extern int __uuid_generate_random(uuid_t out, int *num);
+extern int __uuid_generate_time_v6(uuid_t out, int *num);
 
 #endif /* _UUID_UUID_H */
@@ -51,6 +51,9 @@
 
 #include "findmnt.h"
 
+UL_DEBUG_DEFINE_MASK(findmnt);
+UL_DEBUG_DEFINE_MASKNAMES(findmnt) = UL_DEBUG_EMPTY_MASKNAMES;
+
 /* column IDs */
 enum {
 	COL_ACTION,
@@ -164,8 +167,44 @@ static blkid_cache blk_cache;
 static struct udev *udev;
 #endif
 
+/*
+ * Per-line cache for expensive lookups. The same statvfs() result is used for
+ * SIZE, AVAIL, USED and USE% columns and the same udev device for LABEL, UUID,
+ * PARTUUID and PARTLABEL columns. The cache is reset after each output line to
+ * avoid stale data in --poll mode.
+ */
+static struct probe_cache {
+	char		*target;	/* statvfs() path */
+	struct statvfs	vfs;
+	int		vfs_rc;
+
+#ifdef HAVE_LIBUDEV
+	char		*devname;	/* udev device name */
+	struct udev_device *udev_dev;
+#endif
+	size_t		nprobes;	/* number of real lookups */
+	size_t		navoided;	/* number of lookups served from cache */
+} probes;
+
 static int match_func(struct libmnt_fs *fs, void *data __attribute__ ((__unused__)));
 
+static void findmnt_init_debug(void)
+{
+	__UL_INIT_DEBUG_FROM_ENV(findmnt, FINDMNT_DEBUG_, 0, FINDMNT_DEBUG);
+}
+
+static void reset_probe_cache(void)
+{
+	free(probes.target);
+	probes.target = NULL;
+#ifdef HAVE_LIBUDEV
+	free(probes.devname);
+	probes.devname = NULL;
+	udev_device_unref(probes.udev_dev);
+	probes.udev_dev = NULL;
+#endif
+}
+
 
 static int get_column_id(int num)
 {
@@ -386,17 +425,24 @@ static int column_name_to_id(const char *name, size_t namesz)
 
 
 #ifdef HAVE_LIBUDEV
-static char *get_tag_from_udev(const char *devname, int col)
+static struct udev_device *get_udev_device(const char *devname)
 {
-	struct udev_device *dev;
-	const char *data = NULL;
-	char *res = NULL, *path;
+	char *path;
+
+	if (probes.devname && strcmp(probes.devname, devname) == 0) {
+		probes.navoided++;
+		return probes.udev_dev;
+	}
 
 	if (!udev)
 		udev = udev_new();
 	if (!udev)
 		return NULL;
 
+	free(probes.devname);
+	probes.devname = xstrdup(devname);
+	udev_device_unref(probes.udev_dev);
+
 	/* libudev don't like /dev/mapper/ symlinks */
 	path = realpath(devname, NULL);
 	if (path)
@@ -405,9 +451,20 @@ static char *get_tag_from_udev(const char *devname, int col)
 	if (strncmp(devname, "/dev/", 5) == 0)
 		devname += 5;
 
-	dev = udev_device_new_from_subsystem_sysname(udev, "block", devname);
+	probes.udev_dev = udev_device_new_from_subsystem_sysname(udev, "block", devname);
+	probes.nprobes++;
 	free(path);
 
+	return probes.udev_dev;
+}
+
+static char *get_tag_from_udev(const char *devname, int col)
+{
+	struct udev_device *dev;
+	const char *data = NULL;
+	char *res = NULL;
+
+	dev = get_udev_device(devname);
 	if (!dev)
 		return NULL;
 
@@ -433,7 +490,6 @@ static char *get_tag_from_udev(const char *devname, int col)
 		unhexmangle_string(res);
 	}
 
-	udev_device_unref(dev);
 	return res;
 }
 #endif /* HAVE_LIBUDEV */
@@ -470,32 +526,50 @@ static char *get_tag(struct libmnt_fs *fs, const char *tagname, int col
 	return res;
 }
 
+static struct statvfs *get_statvfs(const char *target)
+{
+	if (!target)
+		return NULL;
+
+	if (probes.target && strcmp(probes.target, target) == 0)
+		probes.navoided++;
+	else {
+		free(probes.target);
+		probes.target = xstrdup(target);
+		probes.vfs_rc = statvfs(target, &probes.vfs);
+		probes.nprobes++;
+	}
+
+	return probes.vfs_rc == 0 ? &probes.vfs : NULL;
+}
+
 static char *get_vfs_attr(struct libmnt_fs *fs, int sizetype)
 {
-	struct statvfs buf;
+	struct statvfs *buf;
 	uint64_t vfs_attr = 0;
 	char *sizestr;
 
-	if (statvfs(mnt_fs_get_target(fs), &buf) != 0)
+	buf = get_statvfs(mnt_fs_get_target(fs));
+	if (!buf)
 		return NULL;
 
 	switch(sizetype) {
 	case COL_SIZE:
-		vfs_attr = buf.f_frsize * buf.f_blocks;
+		vfs_attr = buf->f_frsize * buf->f_blocks;
 		break;
 	case COL_AVAIL:
-		vfs_attr = buf.f_frsize * buf.f_bavail;
+		vfs_attr = buf->f_frsize * buf->f_bavail;
 		break;
 	case COL_USED:
-		vfs_attr = buf.f_frsize * (buf.f_blocks - buf.f_bfree);
+		vfs_attr = buf->f_frsize * (buf->f_blocks - buf->f_bfree);
 		break;
 	case COL_USEPERC:
-		if (buf.f_blocks == 0)
+		if (buf->f_blocks == 0)
 			return xstrdup("-");
 
 		xasprintf(&sizestr, "%.0f%%",
-				(double)(buf.f_blocks - buf.f_bfree) /
-				buf.f_blocks * 100);
+				(double)(buf->f_blocks - buf->f_bfree) /
+				buf->f_blocks * 100);
 		return sizestr;
 	}
 
@@ -662,7 +736,7 @@ static char *get_data(struct libmnt_fs *fs, int num)
 		if (!devno)
 			break;
 
-		if ((flags & FL_RAW) || (flags & FL_EXPORT) || (flags & FL_JSON))
+		if (flags & (FL_RAW | FL_EXPORT | FL_JSON | FL_CBOR))
 			xasprintf(&str, "%u:%u", major(devno), minor(devno));
 		else
 			xasprintf(&str, "%3u:%-3u", major(devno), minor(devno));
@@ -791,6 +865,7 @@ static struct libscols_line *add_line(struct libscols_table *table, struct libmn
 		if (scols_line_refer_data(line, i, get_data(fs, i)))
 			err(EXIT_FAILURE, _("failed to add output data"));
 	}
+	reset_probe_cache();
 
 	scols_line_set_userdata(line, fs);
 	return line;
@@ -810,6 +885,7 @@ static struct libscols_line *add_tabdiff_line(struct libscols_table *table, stru
 				get_tabdiff_data(old_fs, new_fs, change, i)))
 			err(EXIT_FAILURE, _("failed to add output data"));
 	}
+	reset_probe_cache();
 
 	return line;
 }
@@ -914,21 +990,14 @@ static char **append_pid_tabfile(char **files, int *nfiles, pid_t pid)
 	return append_tabfile(files, nfiles, path);
 }
 
-/* calls libmount fstab/mtab/mountinfo parser */
-static struct libmnt_table *parse_tabfiles(char **files,
-					   int nfiles,
-					   int tabtype)
+/* calls libmount fstab/mtab/mountinfo parser for all @files */
+static int __parse_tabfiles(struct libmnt_table *tb,
+			    char **files,
+			    int nfiles,
+			    int tabtype)
 {
-	struct libmnt_table *tb;
 	int rc = 0;
 
-	tb = mnt_new_table();
-	if (!tb) {
-		warn(_("failed to initialize libmount table"));
-		return NULL;
-	}
-	mnt_table_set_parser_errcb(tb, parser_errcb);
-
 	do {
 		/* NULL means that libmount will use default paths */
 		const char *path = nfiles ? *files++ : NULL;
@@ -950,12 +1019,31 @@ static struct libmnt_table *parse_tabfiles(char **files,
 			break;
 		}
 		if (rc) {
-			mnt_unref_table(tb);
 			warn(_("can't read %s"), path);
-			return NULL;
+			return rc;
 		}
 	} while (--nfiles > 0);
 
+	return 0;
+}
+
+static struct libmnt_table *parse_tabfiles(char **files,
+					   int nfiles,
+					   int tabtype)
+{
+	struct libmnt_table *tb;
+
+	tb = mnt_new_table();
+	if (!tb) {
+		warn(_("failed to initialize libmount table"));
+		return NULL;
+	}
+	mnt_table_set_parser_errcb(tb, parser_errcb);
+
+	if (__parse_tabfiles(tb, files, nfiles, tabtype) != 0) {
+		mnt_unref_table(tb);
+		return NULL;
+	}
 	return tb;
 }
 
@@ -1302,6 +1390,60 @@ done:
 	return rc;
 }
 
+/*
+ * --stream: the entries are printed by the libmount parser filter callback
+ * and then dropped, so neither libmount nor libsmartcols keeps the whole table
+ * in memory. All output columns are per-entry (no parent/child relations),
+ * so it's possible to print them immediately.
+ */
+struct stream_control {
+	struct libscols_table	*table;
+	size_t			nlines;
+};
+
+static int stream_filter(struct libmnt_fs *fs, void *data)
+{
+	struct stream_control *ctl = (struct stream_control *) data;
+
+	if (ctl->nlines && (flags & FL_FIRSTONLY))
+		return 1;
+	if (!poll_match(fs))
+		return 1;
+
+	add_line(ctl->table, fs, NULL);
+
+	if (scols_table_print_range(ctl->table, NULL, NULL) == 0)
+		fputc('\n', scols_table_get_stream(ctl->table));
+
+	/* the line refers to @fs which is going to be deallocated */
+	scols_table_remove_lines(ctl->table);
+	ctl->nlines++;
+
+	return 1;	/* don't add to the libmount table */
+}
+
+static int stream_tabfiles(char **files, int nfiles, int tabtype,
+			   struct libscols_table *table)
+{
+	struct stream_control ctl = { .table = table };
+	struct libmnt_table *tb;
+	int rc;
+
+	tb = mnt_new_table();
+	if (!tb) {
+		warn(_("failed to initialize libmount table"));
+		return -1;
+	}
+	mnt_table_set_parser_errcb(tb, parser_errcb);
+	mnt_table_set_parser_fltrcb(tb, stream_filter, &ctl);
+	mnt_table_set_cache(tb, cache);
+
+	rc = __parse_tabfiles(tb, files, nfiles, tabtype);
+
+	mnt_unref_table(tb);
+	return rc ? rc : ctl.nlines ? 0 : -1;
+}
+
 static int uniq_fs_target_cmp(
 		struct libmnt_table *tb __attribute__((__unused__)),
 		struct libmnt_fs *a,
@@ -1339,6 +1481,7 @@ static void __attribute__((__noreturn__)) usage(void)
 
 	fputs(_(" -A, --all              disable all built-in filters, print all filesystems\n"), out);
 	fputs(_(" -a, --ascii            use ASCII chars for tree formatting\n"), out);
+	fputs(_("     --cbor             use CBOR (binary JSON) output format\n"), out);
 	fputs(_(" -b, --bytes            print sizes in bytes rather than in human readable format\n"), out);
 	fputs(_(" -C, --nocanonicalize   don't canonicalize when comparing paths\n"), out);
 	fputs(_(" -c, --canonicalize     canonicalize printed paths\n"), out);
@@ -1364,6 +1507,8 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_("     --real             print only real filesystems\n"), out);
 	fputs(_(" -S, --source <string>  the device to mount (by name, maj:min, \n"
 	        "                          LABEL=, UUID=, PARTUUID=, PARTLABEL=)\n"), out);
+	fputs(_("     --stream           print filesystems while reading the table\n"
+		"                          (requires --raw or --pairs)\n"), out);
 	fputs(_(" -T, --target <path>    the path to the filesystem to use\n"), out);
 	fputs(_("     --tree             enable tree format output if possible\n"), out);
 	fputs(_(" -M, --mountpoint <dir> the mountpoint directory\n"), out);
@@ -1411,7 +1556,9 @@ int main(int argc, char *argv[])
 		FINDMNT_OPT_PSEUDO,
 		FINDMNT_OPT_REAL,
 		FINDMNT_OPT_VFS_ALL,
-		FINDMNT_OPT_SHADOWED
+		FINDMNT_OPT_SHADOWED,
+		FINDMNT_OPT_STREAM,
+		FINDMNT_OPT_CBOR
 	};
 
 	static const struct option longopts[] = {
@@ -1458,13 +1605,15 @@ int main(int argc, char *argv[])
 		{ "pseudo",	    no_argument,       NULL, FINDMNT_OPT_PSEUDO	 },
 		{ "vfs-all",	    no_argument,       NULL, FINDMNT_OPT_VFS_ALL },
 		{ "shadowed",       no_argument,       NULL, FINDMNT_OPT_SHADOWED },
+		{ "stream",         no_argument,       NULL, FINDMNT_OPT_STREAM },
+		{ "cbor",           no_argument,       NULL, FINDMNT_OPT_CBOR },
 		{ NULL, 0, NULL, 0 }
 	};
 
 	static const ul_excl_t excl[] = {	/* rows and cols in ASCII order */
 		{ 'C', 'c'},			/* [no]canonicalize */
 		{ 'C', 'e' },			/* nocanonicalize, evaluate */
-		{ 'J', 'P', 'r','x' },		/* json,pairs,raw,verify */
+		{ 'J', 'P', 'r','x', FINDMNT_OPT_CBOR },	/* json,pairs,raw,verify,cbor */
 		{ 'M', 'T' },			/* mountpoint, target */
 		{ 'N','k','m','s' },		/* task,kernel,mtab,fstab */
 		{ 'P','l','r','x' },		/* pairs,list,raw,verify */
@@ -1642,6 +1791,12 @@ int main(int argc, char *argv[])
 		case FINDMNT_OPT_SHADOWED:
 			flags |= FL_SHADOWED;
 			break;
+		case FINDMNT_OPT_STREAM:
+			flags |= FL_STREAM;
+			break;
+		case FINDMNT_OPT_CBOR:
+			flags |= FL_CBOR;
+			break;
 		case 'h':
 			usage();
 		case 'V':
@@ -1692,6 +1847,19 @@ int main(int argc, char *argv[])
 	if (optind < argc)
 		set_match(COL_TARGET, argv[optind++]);	/* mountpoint */
 
+	if (flags & FL_STREAM) {
+		if (!(flags & (FL_RAW | FL_EXPORT)))
+			errx(EXIT_FAILURE, _("--stream requires --raw or --pairs"));
+		if ((flags & (FL_POLL | FL_UNIQ | FL_SUBMOUNTS | FL_SHADOWED))
+		    || verify || force_tree
+		    || tabtype == TABTYPE_MTAB
+		    || direction == MNT_ITER_BACKWARD)
+			errx(EXIT_FAILURE, _("--stream is unsupported for "
+				"--poll, --verify, --mtab, --uniq, --submounts, "
+				"--shadowed, --tree and backward direction"));
+		flags &= ~FL_TREE;
+	}
+
 	if ((flags & FL_SUBMOUNTS) && is_listall_mode())
 		/* don't care about submounts if list all mounts */
 		flags &= ~FL_SUBMOUNTS;
@@ -1718,21 +1886,24 @@ int main(int argc, char *argv[])
 	/*
 	 * initialize libmount
 	 */
+	findmnt_init_debug();
 	mnt_init_debug(0);
 
-	tb = parse_tabfiles(tabfiles, ntabfiles, tabtype);
-	if (!tb)
-		goto leave;
+	if (!(flags & FL_STREAM)) {
+		tb = parse_tabfiles(tabfiles, ntabfiles, tabtype);
+		if (!tb)
+			goto leave;
 
-	if (tabtype == TABTYPE_MTAB && tab_is_kernel(tb))
-		tabtype = TABTYPE_KERNEL;
+		if (tabtype == TABTYPE_MTAB && tab_is_kernel(tb))
+			tabtype = TABTYPE_KERNEL;
 
-	istree = tab_is_tree(tb);
-	if (istree && force_tree)
-		flags |= FL_TREE;
+		istree = tab_is_tree(tb);
+		if (istree && force_tree)
+			flags |= FL_TREE;
 
-	if ((flags & FL_TREE) && (ntabfiles > 1 || !istree))
-		flags &= ~FL_TREE;
+		if ((flags & FL_TREE) && (ntabfiles > 1 || !istree))
+			flags &= ~FL_TREE;
+	}
 
 	if (!(flags & FL_NOCACHE)) {
 		cache = mnt_new_cache();
@@ -1740,7 +1911,8 @@ int main(int argc, char *argv[])
 			warn(_("failed to initialize libmount cache"));
 			goto leave;
 		}
-		mnt_table_set_cache(tb, cache);
+		if (tb)
+			mnt_table_set_cache(tb, cache);
 
 		if (tabtype != TABTYPE_KERNEL)
 			cache_set_targets(cache);
@@ -1767,10 +1939,11 @@ int main(int argc, char *argv[])
 	scols_table_enable_export(table,     !!(flags & FL_EXPORT));
 	scols_table_enable_shellvar(table,   !!(flags & FL_SHELLVAR));
 	scols_table_enable_json(table,       !!(flags & FL_JSON));
+	scols_table_enable_cbor(table,       !!(flags & FL_CBOR));
 	scols_table_enable_ascii(table,      !!(flags & FL_ASCII));
 	scols_table_enable_noheadings(table, !!(flags & FL_NOHEADINGS));
 
-	if (flags & FL_JSON)
+	if (flags & (FL_JSON | FL_CBOR))
 		scols_table_set_name(table, "filesystems");
 
 	for (i = 0; i < ncolumns; i++) {
@@ -1800,7 +1973,7 @@ int main(int argc, char *argv[])
 						NULL);
 			scols_column_set_safechars(cl, "\n");
 		}
-		if (flags & FL_JSON) {
+		if (flags & (FL_JSON | FL_CBOR)) {
 			switch (id) {
 			case COL_SIZE:
 			case COL_AVAIL:
@@ -1828,7 +2001,11 @@ int main(int argc, char *argv[])
 	/*
 	 * Fill in data to the output table
 	 */
-	if (flags & FL_POLL) {
+	if (flags & FL_STREAM) {
+		/* print entries as soon as they are parsed */
+		rc = stream_tabfiles(tabfiles, ntabfiles, tabtype, table);
+
+	} else if (flags & FL_POLL) {
 		/* poll mode (accept the first tabfile only) */
 		rc = poll_table(tb, tabfiles ? *tabfiles : _PATH_PROC_MOUNTINFO, timeout, table, direction);
 
@@ -1857,9 +2034,11 @@ int main(int argc, char *argv[])
 	/*
 	 * Print the output table for non-poll modes
 	 */
-	if (!rc && !(flags & FL_POLL))
+	if (!rc && !(flags & (FL_POLL | FL_STREAM)))
 		scols_print_table(table);
 leave:
+	DBG(PROBE, ul_debug("probes: %zu done, %zu avoided",
+				probes.nprobes, probes.navoided));
 	scols_unref_table(table);
 
 	mnt_unref_table(tb);
@@ -1,6 +1,16 @@
 #ifndef UTIL_LINUX_FINDMNT_H
 #define UTIL_LINUX_FINDMNT_H
 
+#include "debug.h"
+
+#define FINDMNT_DEBUG_INIT	(1 << 1)
+#define FINDMNT_DEBUG_PROBE	(1 << 2)
+#define FINDMNT_DEBUG_ALL	0xFFFF
+
+UL_DEBUG_DECLARE_MASK(findmnt);
+#define DBG(m, x)       __UL_DBG(findmnt, FINDMNT_DEBUG_, m, x)
+#define ON_DBG(m, x)    __UL_DBG_CALL(findmnt, FINDMNT_DEBUG_, m, x)
+
 /* flags */
 enum {
 	FL_EVALUATE	= (1 << 1),
@@ -24,6 +34,8 @@ enum {
 	FL_SHADOWED	= (1 << 20),
 	FL_DELETED      = (1 << 21),
 	FL_SHELLVAR     = (1 << 22),
+	FL_STREAM	= (1 << 23),
+	FL_CBOR		= (1 << 24),
 
 	/* basic table settings */
 	FL_ASCII	= (1 << 25),
@@ -1,9 +1,13 @@
 
 #include <blkid.h>
+#include <unistd.h>
 
 #ifdef HAVE_LIBUDEV
 # include <libudev.h>
 #endif
+#ifdef HAVE_LIBPTHREAD
+# include <pthread.h>
+#endif
 
 #include "c.h"
 #include "xalloc.h"
@@ -14,9 +18,25 @@
 
 #include "lsblk.h"
 
+/* per-thread context for reading properties, the udev handler must not be
+ * shared between threads */
+struct lsblk_propctx {
+#ifdef HAVE_LIBUDEV
+	struct udev *udev;
+#endif
+	size_t ndevs;		/* number of prefetched devices */
+};
+
+static struct lsblk_propctx main_ctx;	/* used by the main thread */
+
+static void propctx_deinit(struct lsblk_propctx *cx)
+{
+	cx->ndevs = 0;
 #ifdef HAVE_LIBUDEV
-static struct udev *udev;
+	udev_unref(cx->udev);
+	cx->udev = NULL;
 #endif
+}
 
 void lsblk_device_free_properties(struct lsblk_devprop *p)
 {
@@ -45,25 +65,27 @@ void lsblk_device_free_properties(struct lsblk_devprop *p)
 }
 
 #ifndef HAVE_LIBUDEV
-static struct lsblk_devprop *get_properties_by_udev(struct lsblk_device *dev
-				__attribute__((__unused__)))
+static struct lsblk_devprop *get_properties_by_udev(
+				struct lsblk_propctx *cx __attribute__((__unused__)),
+				struct lsblk_device *dev __attribute__((__unused__)))
 {
 	return NULL;
 }
 #else
-static struct lsblk_devprop *get_properties_by_udev(struct lsblk_device *ld)
+static struct lsblk_devprop *get_properties_by_udev(struct lsblk_propctx *cx,
+						    struct lsblk_device *ld)
 {
 	struct udev_device *dev;
 
 	if (ld->udev_requested)
 		return ld->properties;
 
-	if (!udev)
-		udev = udev_new();	/* global handler */
-	if (!udev)
+	if (!cx->udev)
+		cx->udev = udev_new();
+	if (!cx->udev)
 		goto done;
 
-	dev = udev_device_new_from_subsystem_sysname(udev, "block", ld->name);
+	dev = udev_device_new_from_subsystem_sysname(cx->udev, "block", ld->name);
 	if (dev) {
 		const char *data;
 		struct lsblk_devprop *prop;
@@ -307,25 +329,147 @@ done:
 	return dev->properties;
 }
 
-struct lsblk_devprop *lsblk_device_get_properties(struct lsblk_device *dev)
+static struct lsblk_devprop *read_properties(struct lsblk_propctx *cx,
+					     struct lsblk_device *dev)
 {
 	struct lsblk_devprop *p = NULL;
 
-	DBG(DEV, ul_debugobj(dev, "%s: properties requested", dev->filename));
 	if (lsblk->sysroot)
 		return get_properties_by_file(dev);
 
-	p = get_properties_by_udev(dev);
+	p = get_properties_by_udev(cx, dev);
 	if (!p)
 		p = get_properties_by_blkid(dev);
 	return p;
 }
 
+static inline int properties_requested(struct lsblk_device *dev)
+{
+	return dev->udev_requested || dev->blkid_requested || dev->file_requested;
+}
+
+struct lsblk_devprop *lsblk_device_get_properties(struct lsblk_device *dev)
+{
+	DBG(DEV, ul_debugobj(dev, "%s: properties requested", dev->filename));
+
+	if (properties_requested(dev))
+		lsblk->nprobes_avoided++;
+	else
+		lsblk->nprobes++;
+
+	return read_properties(&main_ctx, dev);
+}
+
+#ifdef HAVE_LIBPTHREAD
+/*
+ * Properties prefetch -- the devices are distributed between threads, every
+ * device is read by one thread only and the rest of lsblk (main thread) waits.
+ */
+#define LSBLK_PREFETCH_MINDEVS		16	/* don't use threads for less devices */
+#define LSBLK_PREFETCH_DEVSPERTHREAD	8
+#define LSBLK_PREFETCH_MAXTHREADS	16
+
+struct prefetch_ctl {
+	struct lsblk_device	**devs;
+	size_t			ndevs;
+	size_t			next;		/* next device to read */
+	size_t			nprobes;	/* see lsblk->nprobes */
+	size_t			nprobes_avoided;
+	pthread_mutex_t		lock;
+};
+
+static void prefetch_devices(struct prefetch_ctl *ctl, struct lsblk_propctx *cx)
+{
+	size_t nprobes = 0, navoided = 0;
+
+	do {
+		struct lsblk_device *dev = NULL;
+
+		pthread_mutex_lock(&ctl->lock);
+		if (ctl->next < ctl->ndevs)
+			dev = ctl->devs[ctl->next++];
+		pthread_mutex_unlock(&ctl->lock);
+
+		if (!dev)
+			break;
+		if (properties_requested(dev))
+			navoided++;
+		else
+			nprobes++;
+		read_properties(cx, dev);
+		cx->ndevs++;
+	} while (1);
+
+	/* lsblk->nprobes is not thread-safe, it's updated after join */
+	pthread_mutex_lock(&ctl->lock);
+	ctl->nprobes += nprobes;
+	ctl->nprobes_avoided += navoided;
+	pthread_mutex_unlock(&ctl->lock);
+}
+
+static void *prefetch_thread(void *data)
+{
+	struct lsblk_propctx cx = { 0 };
+
+	prefetch_devices((struct prefetch_ctl *) data, &cx);
+	DBG(DEV, ul_debug("prefetch thread: %zu devices", cx.ndevs));
+	propctx_deinit(&cx);
+	return NULL;
+}
+
+/*
+ * Reads properties of @devs by more threads. The properties are cached in
+ * the devices, so lsblk_device_get_properties() does not read anything
+ * later.
+ */
+void lsblk_prefetch_properties(struct lsblk_device **devs, size_t ndevs)
+{
+	struct prefetch_ctl ctl = { .devs = devs, .ndevs = ndevs };
+	pthread_t threads[LSBLK_PREFETCH_MAXTHREADS - 1];
+	size_t i, n, nthreads;
+	long ncpus;
+
+	if (ndevs < LSBLK_PREFETCH_MINDEVS)
+		return;		/* read on demand */
+
+	/* the probing is mostly I/O bound, use more threads than CPUs */
+	ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	nthreads = min(ndevs / LSBLK_PREFETCH_DEVSPERTHREAD,
+		       (size_t) LSBLK_PREFETCH_MAXTHREADS);
+	if (ncpus > 0)
+		nthreads = min(nthreads, (size_t) ncpus * 4);
+	if (nthreads < 2)
+		return;
+
+	/* initialize global stuff before threads */
+	blkid_init_debug(0);
+	pthread_mutex_init(&ctl.lock, NULL);
+
+	for (n = 0; n < nthreads - 1; n++) {
+		if (pthread_create(&threads[n], NULL, prefetch_thread, &ctl) != 0)
+			break;
+	}
+	DBG(DEV, ul_debug("prefetch properties: %zu devices, %zu threads", ndevs, n + 1));
+
+	prefetch_devices(&ctl, &main_ctx);
+
+	for (i = 0; i < n; i++)
+		pthread_join(threads[i], NULL);
+	pthread_mutex_destroy(&ctl.lock);
+
+	lsblk->nprobes += ctl.nprobes;
+	lsblk->nprobes_avoided += ctl.nprobes_avoided;
+}
+#else
+void lsblk_prefetch_properties(struct lsblk_device **devs __attribute__((__unused__)),
+			       size_t ndevs __attribute__((__unused__)))
+{
+}
+#endif /* HAVE_LIBPTHREAD */
+
 void lsblk_properties_deinit(void)
 {
-#ifdef HAVE_LIBUDEV
-	udev_unref(udev);
-#endif
+	propctx_deinit(&main_ctx);
 }
 
 
@@ -139,7 +139,8 @@ enum {
 	LSBLK_EXPORT =		(1 << 3),
 	LSBLK_TREE =		(1 << 4),
 	LSBLK_JSON =		(1 << 5),
-	LSBLK_SHELLVAR =	(1 << 6)
+	LSBLK_SHELLVAR =	(1 << 6),
+	LSBLK_CBOR =		(1 << 7)
 };
 
 /* Types used for qsort() and JSON */
@@ -552,7 +553,8 @@ static char *get_subsystems(struct lsblk_device *dev)
 
 #define is_parsable(_l)	(scols_table_is_raw((_l)->table) || \
 			 scols_table_is_export((_l)->table) || \
-			 scols_table_is_json((_l)->table))
+			 scols_table_is_json((_l)->table) || \
+			 scols_table_is_cbor((_l)->table))
 
 static char *mk_name(const char *name)
 {
@@ -580,21 +582,6 @@ static char *mk_dm_name(const char *name)
 	return p;
 }
 
-/* stores data to scols cell userdata (invisible and independent on output)
- * to make the original values accessible for sort functions
- */
-static void set_sortdata_u64(struct libscols_line *ln, int col, uint64_t x)
-{
-	struct libscols_cell *ce = scols_line_get_cell(ln, col);
-	uint64_t *data;
-
-	if (!ce)
-		return;
-	data = xmalloc(sizeof(uint64_t));
-	*data = x;
-	scols_cell_set_userdata(ce, data);
-}
-
 /* do not modify *data on any error */
 static void str2u64(const char *str, uint64_t *data)
 {
@@ -611,37 +598,27 @@ static void str2u64(const char *str, uint64_t *data)
 	*data = num;
 }
 
-static void unref_sortdata(struct libscols_table *tb)
-{
-	struct libscols_iter *itr;
-	struct libscols_line *ln;
-
-	if (!tb || !lsblk->sort_col)
-		return;
-	itr = scols_new_iter(SCOLS_ITER_FORWARD);
-	if (!itr)
-		return;
-	while (scols_table_next_line(tb, itr, &ln) == 0) {
-		struct libscols_cell *ce = scols_line_get_column_cell(ln,
-								lsblk->sort_col);
-		void *data = scols_cell_get_userdata(ce);
-		free(data);
-	}
-
-	scols_free_iter(itr);
-}
-
 static char *get_vfs_attribute(struct lsblk_device *dev, int id)
 {
 	char *sizestr;
 	uint64_t vfs_attr = 0;
 
-	if (!dev->fsstat.f_blocks) {
+	/* the same statvfs() result is used for all FS* columns */
+	if (!dev->fsstat_requested) {
 		const char *mnt = lsblk_device_get_mountpoint(dev);
+
+		dev->fsstat_requested = 1;
+		dev->fsstat_failed = 1;
 		if (!mnt || dev->is_swap)
 			return NULL;
+		lsblk->nprobes++;
 		if (statvfs(mnt, &dev->fsstat) != 0)
 			return NULL;
+		dev->fsstat_failed = 0;
+	} else {
+		lsblk->nprobes_avoided++;
+		if (dev->fsstat_failed)
+			return NULL;
 	}
 
 	switch(id) {
@@ -1199,8 +1176,11 @@ static void device_to_scols(
 			uint64_t sortdata = (uint64_t) -1;
 
 			data = device_get_data(dev, parent, id, &sortdata);
+			/* the original value (invisible and independent
+			 * on output) for scols_sort_table() */
 			if (data && sortdata != (uint64_t) -1)
-				set_sortdata_u64(ln, i, sortdata);
+				scols_cell_set_sortkey_u64(
+					scols_line_get_cell(ln, i), sortdata);
 		}
 		DBG(DEV, ul_debugobj(dev, " refer data[%zu]=\"%s\"", i, data));
 		if (data && scols_line_refer_data(ln, i, data))
@@ -1831,25 +1811,6 @@ static void parse_includes(const char *str0)
 	}
 }
 
-/*
- * see set_sortdata_u64() and columns initialization in main()
- */
-static int cmp_u64_cells(struct libscols_cell *a,
-			 struct libscols_cell *b,
-			 __attribute__((__unused__)) void *data)
-{
-	uint64_t *adata = (uint64_t *) scols_cell_get_userdata(a),
-		 *bdata = (uint64_t *) scols_cell_get_userdata(b);
-
-	if (adata == NULL && bdata == NULL)
-		return 0;
-	if (adata == NULL)
-		return -1;
-	if (bdata == NULL)
-		return 1;
-	return *adata == *bdata ? 0 : *adata >= *bdata ? 1 : -1;
-}
-
 static void device_set_dedupkey(
 			struct lsblk_device *dev,
 			struct lsblk_device *parent,
@@ -1887,6 +1848,69 @@ static void devtree_set_dedupkeys(struct lsblk_devtree *tr, int id)
 		device_set_dedupkey(dev, NULL, id);
 }
 
+/* returns 1 if device_get_data() reads udev/blkid properties for the column */
+static int column_needs_properties(int id, struct lsblk_device *dev)
+{
+	switch (id) {
+	case COL_OWNER:
+	case COL_GROUP:
+	case COL_MODE:
+		return lsblk->sysroot != NULL;
+	case COL_MODEL:
+	case COL_SERIAL:
+		return !device_is_partition(dev) && dev->nslaves == 0;
+	case COL_FSTYPE:
+	case COL_FSVERSION:
+	case COL_LABEL:
+	case COL_UUID:
+	case COL_PTUUID:
+	case COL_PTTYPE:
+	case COL_PARTTYPE:
+	case COL_PARTTYPENAME:
+	case COL_PARTLABEL:
+	case COL_PARTUUID:
+	case COL_PARTFLAGS:
+	case COL_WWN:
+		return 1;
+	default:
+		break;
+	}
+	return 0;
+}
+
+/*
+ * Reads properties of all devices in parallel. The tree is already complete
+ * here, and the rest (output, de-duplication) uses the cached properties.
+ */
+static void devtree_prefetch_properties(struct lsblk_devtree *tr)
+{
+	struct lsblk_device **devs = NULL, *dev = NULL;
+	struct lsblk_iter itr;
+	size_t ndevs = 0, sz = 0;
+
+	lsblk_reset_iter(&itr, LSBLK_ITER_FORWARD);
+
+	while (lsblk_devtree_next_device(tr, &itr, &dev) == 0) {
+		size_t i;
+
+		for (i = 0; i < ncolumns; i++) {
+			if (column_needs_properties(columns[i], dev))
+				break;
+		}
+		if (i == ncolumns)
+			continue;
+		if (ndevs == sz) {
+			sz = sz ? sz * 2 : 64;
+			devs = xrealloc(devs, sz * sizeof(struct lsblk_device *));
+		}
+		devs[ndevs++] = dev;
+	}
+
+	if (ndevs)
+		lsblk_prefetch_properties(devs, ndevs);
+	free(devs);
+}
+
 static void __attribute__((__noreturn__)) usage(void)
 {
 	FILE *out = stdout;
@@ -1928,6 +1952,7 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_(" -y, --shell          use column names to be usable as shell variable identifiers\n"), out);
 	fputs(_(" -z, --zoned          print zone related information\n"), out);
 	fputs(_("     --sysroot <dir>  use specified directory as system root\n"), out);
+	fputs(_("     --cbor           use CBOR (binary JSON) output format\n"), out);
 	fputs(USAGE_SEPARATOR, out);
 	printf(USAGE_HELP_OPTIONS(22));
 
@@ -1964,12 +1989,14 @@ int main(int argc, char *argv[])
 	int force_tree = 0, has_tree_col = 0;
 
 	enum {
-		OPT_SYSROOT = CHAR_MAX + 1
+		OPT_SYSROOT = CHAR_MAX + 1,
+		OPT_CBOR
 	};
 
 	static const struct option longopts[] = {
 		{ "all",	no_argument,       NULL, 'a' },
 		{ "bytes",      no_argument,       NULL, 'b' },
+		{ "cbor",       no_argument,       NULL, OPT_CBOR },
 		{ "nodeps",     no_argument,       NULL, 'd' },
 		{ "noempty",    no_argument,       NULL, 'A' },
 		{ "discard",    no_argument,       NULL, 'D' },
@@ -2005,7 +2032,7 @@ int main(int argc, char *argv[])
 	static const ul_excl_t excl[] = {       /* rows and cols in ASCII order */
 		{ 'D','O' },
 		{ 'I','e' },
-		{ 'J', 'P', 'r' },
+		{ 'J', 'P', 'r', OPT_CBOR },
 		{ 'O','S' },
 		{ 'O','f' },
 		{ 'O','m' },
@@ -2156,6 +2183,9 @@ int main(int argc, char *argv[])
 				lsblk->tree_id = column_name_to_id(optarg, strlen(optarg));
 			}
 			break;
+		case OPT_CBOR:
+			lsblk->flags |= LSBLK_CBOR;
+			break;
 		case OPT_SYSROOT:
 			lsblk->sysroot = optarg;
 			break;
@@ -2243,9 +2273,10 @@ int main(int argc, char *argv[])
 	scols_table_enable_shellvar(lsblk->table, !!(lsblk->flags & LSBLK_SHELLVAR));
 	scols_table_enable_ascii(lsblk->table, !!(lsblk->flags & LSBLK_ASCII));
 	scols_table_enable_json(lsblk->table, !!(lsblk->flags & LSBLK_JSON));
+	scols_table_enable_cbor(lsblk->table, !!(lsblk->flags & LSBLK_CBOR));
 	scols_table_enable_noheadings(lsblk->table, !!(lsblk->flags & LSBLK_NOHEADINGS));
 
-	if (lsblk->flags & LSBLK_JSON)
+	if (lsblk->flags & (LSBLK_JSON | LSBLK_CBOR))
 		scols_table_set_name(lsblk->table, "blockdevices");
 	if (width) {
 		scols_table_set_termwidth(lsblk->table, width);
@@ -2271,7 +2302,7 @@ int main(int argc, char *argv[])
 			fl |= SCOLS_FL_HIDDEN;
 
 		if (force_tree
-		    && lsblk->flags & LSBLK_JSON
+		    && lsblk->flags & (LSBLK_JSON | LSBLK_CBOR)
 		    && has_tree_col == 0
 		    && i + 1 == ncolumns)
 			/* The "--tree --json" specified, but no column with
@@ -2286,11 +2317,12 @@ int main(int argc, char *argv[])
 		}
 		if (!lsblk->sort_col && lsblk->sort_id == id) {
 			lsblk->sort_col = cl;
-			scols_column_set_cmpfunc(cl,
-				ci->type == COLTYPE_NUM     ? cmp_u64_cells :
-				ci->type == COLTYPE_SIZE    ? cmp_u64_cells :
-			        ci->type == COLTYPE_SORTNUM ? cmp_u64_cells : scols_cmpstr_cells,
-				NULL);
+			if (ci->type == COLTYPE_NUM
+			    || ci->type == COLTYPE_SIZE
+			    || ci->type == COLTYPE_SORTNUM)
+				scols_column_set_sortkey_type(cl, SCOLS_SORTKEY_U64);
+			else
+				scols_column_set_cmpfunc(cl, scols_cmpstr_cells, NULL);
 		}
 		/* multi-line cells (now used for MOUNTPOINTS) */
 		if (fl & SCOLS_FL_WRAP) {
@@ -2301,7 +2333,7 @@ int main(int argc, char *argv[])
 			scols_column_set_safechars(cl, "\n");
 		}
 
-		if (lsblk->flags & LSBLK_JSON) {
+		if (lsblk->flags & (LSBLK_JSON | LSBLK_CBOR)) {
 			switch (ci->type) {
 			case COLTYPE_SIZE:
 				if (!lsblk->bytes)
@@ -2347,6 +2379,8 @@ int main(int argc, char *argv[])
 					  EXIT_SUCCESS;		/* all success */
 	}
 
+	devtree_prefetch_properties(tr);
+
 	if (lsblk->dedup_id > -1) {
 		devtree_set_dedupkeys(tr, lsblk->dedup_id);
 		lsblk_devtree_deduplicate_devices(tr);
@@ -2362,9 +2396,8 @@ int main(int argc, char *argv[])
 	scols_print_table(lsblk->table);
 
 leave:
-	if (lsblk->sort_col)
-		unref_sortdata(lsblk->table);
-
+	DBG(DEV, ul_debug("probes: %zu done, %zu avoided",
+				lsblk->nprobes, lsblk->nprobes_avoided));
 	scols_unref_table(lsblk->table);
 
 	lsblk_mnt_deinit();
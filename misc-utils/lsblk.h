@@ -56,6 +56,9 @@ struct lsblk {
 	unsigned int dedup_hidden :1;	/* deduplication column not between output columns */
 	unsigned int force_tree_order:1;/* sort lines by parent->tree relation */
 	unsigned int noempty:1;		/* hide empty devices */
+
+	size_t nprobes;			/* number of statvfs/udev/blkid lookups */
+	size_t nprobes_avoided;		/* number of lookups served from cache */
 };
 
 extern struct lsblk *lsblk;     /* global handler */
@@ -139,7 +142,9 @@ struct lsblk_device {
 			is_printed : 1,
 			udev_requested : 1,
 			blkid_requested : 1,
-			file_requested : 1;
+			file_requested : 1,
+			fsstat_requested : 1,
+			fsstat_failed : 1;
 };
 
 #define device_is_partition(_x)		((_x)->wholedisk != NULL)
@@ -217,6 +222,7 @@ extern struct libmnt_fs **lsblk_device_get_filesystems(struct lsblk_device *dev,
 /* lsblk-properties.c */
 extern void lsblk_device_free_properties(struct lsblk_devprop *p);
 extern struct lsblk_devprop *lsblk_device_get_properties(struct lsblk_device *dev);
+extern void lsblk_prefetch_properties(struct lsblk_device **devs, size_t ndevs);
 extern void lsblk_properties_deinit(void);
 
 extern const char *lsblk_parttype_code_to_string(const char *code, const char *pttype);
@@ -285,6 +285,7 @@ struct lsfd_control {
 	unsigned int	noheadings : 1,
 			raw : 1,
 			json : 1,
+			cbor : 1,
 			notrunc : 1,
 			threads : 1,
 			show_main : 1,		/* print main table */
@@ -1254,6 +1255,7 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(USAGE_OPTIONS, out);
 	fputs(_(" -l, --threads         list in threads level\n"), out);
 	fputs(_(" -J, --json            use JSON output format\n"), out);
+	fputs(_("     --cbor            use CBOR (binary JSON) output format\n"), out);
 	fputs(_(" -n, --noheadings      don't print headings\n"), out);
 	fputs(_(" -o, --output <list>   output columns\n"), out);
 	fputs(_(" -r, --raw             use raw output format\n"), out);
@@ -1459,21 +1461,22 @@ static struct libscols_table *new_summary_table(struct lsfd_control *ctl)
 	scols_table_enable_noheadings(tb, ctl->noheadings);
 	scols_table_enable_raw(tb, ctl->raw);
 	scols_table_enable_json(tb, ctl->json);
+	scols_table_enable_cbor(tb, ctl->cbor);
 
-	if(ctl->json)
+	if(ctl->json || ctl->cbor)
 		scols_table_set_name(tb, "lsfd-summary");
 
 
 	value_cl = scols_table_new_column(tb, _("VALUE"), 0, SCOLS_FL_RIGHT);
 	if (!value_cl)
 		err(EXIT_FAILURE, _("failed to allocate summary column"));
-	if (ctl->json)
+	if (ctl->json || ctl->cbor)
 		scols_column_set_json_type(value_cl, SCOLS_JSON_NUMBER);
 
 	name_cl = scols_table_new_column(tb, _("COUNTER"), 0, 0);
 	if (!name_cl)
 		err(EXIT_FAILURE, _("failed to allocate summary column"));
-	if (ctl->json)
+	if (ctl->json || ctl->cbor)
 		scols_column_set_json_type(name_cl, SCOLS_JSON_STRING);
 
 	return tb;
@@ -1528,6 +1531,7 @@ int main(int argc, char *argv[])
 		OPT_DEBUG_FILTER = CHAR_MAX + 1,
 		OPT_SUMMARY,
 		OPT_DUMP_COUNTERS,
+		OPT_CBOR,
 	};
 	static const struct option longopts[] = {
 		{ "noheadings", no_argument, NULL, 'n' },
@@ -1544,6 +1548,7 @@ int main(int argc, char *argv[])
 		{ "summary",    optional_argument, NULL,  OPT_SUMMARY },
 		{ "counter",    required_argument, NULL, 'C' },
 		{ "dump-counters",no_argument, NULL, OPT_DUMP_COUNTERS },
+		{ "cbor",       no_argument, NULL, OPT_CBOR },
 		{ NULL, 0, NULL, 0 },
 	};
 
@@ -1563,6 +1568,9 @@ int main(int argc, char *argv[])
 		case 'J':
 			ctl.json = 1;
 			break;
+		case OPT_CBOR:
+			ctl.cbor = 1;
+			break;
 		case 'r':
 			ctl.raw = 1;
 			break;
@@ -1637,7 +1645,13 @@ int main(int argc, char *argv[])
 	scols_table_enable_noheadings(ctl.tb, ctl.noheadings);
 	scols_table_enable_raw(ctl.tb, ctl.raw);
 	scols_table_enable_json(ctl.tb, ctl.json);
-	if (ctl.json)
+	scols_table_enable_cbor(ctl.tb, ctl.cbor);
+	if (ctl.show_main && (ctl.json || ctl.cbor || ctl.raw))
+		/* the width does not matter, print lines when converted */
+		scols_table_enable_streaming(ctl.tb, 1);
+	else
+		scols_table_enable_colstore(ctl.tb, 1);	/* huge number of lines */
+	if (ctl.json || ctl.cbor)
 		scols_table_set_name(ctl.tb, "lsfd");
 
 	/* create output columns */
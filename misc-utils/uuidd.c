@@ -23,6 +23,15 @@
  * | reply length (4 bytes) | uuid reply (16 bytes) | number (4 bytes) time bulk |
  *   or
  * | reply length (4 bytes) | pid or maxop number string length in ascii (up to 7 bytes) |
+ *   or
+ * | reply length (4 bytes) | statistics, terminated ascii text |
+ *   or
+ * | reply length (4 bytes) | nothing for ring refill |
+ *
+ * The server reads the requests from all connected clients by one epoll loop,
+ * and the replies are copied from UUIDs pre-generated by worker threads.
+ * A connection is closed if the request and reply are not complete within
+ * UUIDD_CONN_TIMEOUT, and no more than UUIDD_MAXCONNS connections are open.
  */
 
 #include <stdio.h>
@@ -40,17 +49,23 @@
 #include <string.h>
 #include <getopt.h>
 #include <sys/signalfd.h>
-#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#ifdef HAVE_LIBPTHREAD
+# include <pthread.h>
+#endif
 
 #include "uuid.h"
 #include "uuidd.h"
 #include "all-io.h"
 #include "c.h"
 #include "closestream.h"
+#include "list.h"
 #include "strutils.h"
 #include "optutils.h"
 #include "monotonic.h"
 #include "timer.h"
+#include "xalloc.h"
 
 #ifdef HAVE_LIBSYSTEMD
 # include <systemd/sd-daemon.h>
@@ -71,6 +86,7 @@ enum {
 struct uuidd_cxt_t {
 	const char	*cleanup_pidfile;
 	const char	*cleanup_socket;
+	const char	*cleanup_ring;
 	uint32_t	timeout;
 	unsigned int	debug: 1,
 			quiet: 1,
@@ -81,6 +97,7 @@ struct uuidd_cxt_t {
 struct uuidd_options_t {
 	const char	 *pidfile_path;
 	const char	 *socket_path;
+	const char	 *ring_path;
 	uuidd_prot_num_t num;
 	uuidd_prot_op_t	 do_type;
 	unsigned int	 do_kill:1,
@@ -88,6 +105,14 @@ struct uuidd_options_t {
 			 s_flag:1;
 };
 
+/* bulk requests with number of UUIDs and list of UUIDs in reply */
+static inline int is_bulk_list_op(uuidd_prot_op_t op)
+{
+	return op == UUIDD_OP_BULK_RANDOM_UUID
+	    || op == UUIDD_OP_BULK_TIME_V6_UUID
+	    || op == UUIDD_OP_BULK_TIME_V7_UUID;
+}
+
 static void __attribute__((__noreturn__)) usage(void)
 {
 	FILE *out = stdout;
@@ -102,10 +127,14 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_(" -k, --kill              kill running daemon\n"), out);
 	fputs(_(" -r, --random            test random-based generation\n"), out);
 	fputs(_(" -t, --time              test time-based generation\n"), out);
+	fputs(_(" -6, --time-v6           test time-ordered generation, version 6\n"), out);
+	fputs(_(" -7, --time-v7           test time-ordered generation, version 7\n"), out);
 	fputs(_(" -n, --uuids <num>       request number of uuids\n"), out);
+	fputs(_("     --stats             print statistics of running daemon\n"), out);
 	fputs(_(" -P, --no-pid            do not create pid file\n"), out);
 	fputs(_(" -F, --no-fork           do not daemonize using double-fork\n"), out);
 	fputs(_(" -S, --socket-activation do not create listening socket\n"), out);
+	fputs(_("     --ring[=<path>]     export UUIDs by shared memory ring\n"), out);
 	fputs(_(" -d, --debug             run in debugging mode\n"), out);
 	fputs(_(" -q, --quiet             turn on quiet mode\n"), out);
 	fputs(USAGE_SEPARATOR, out);
@@ -136,8 +165,7 @@ static int call_daemon(const char *socket_path, uuidd_prot_op_t op, char *buf,
 	int32_t reply_len = 0;
 	struct sockaddr_un srv_addr;
 
-	if (((op == UUIDD_OP_BULK_TIME_UUID) ||
-	     (op == UUIDD_OP_BULK_RANDOM_UUID)) && !num) {
+	if ((op == UUIDD_OP_BULK_TIME_UUID || is_bulk_list_op(op)) && !num) {
 		if (err_context)
 			*err_context = _("bad arguments");
 		errno = EINVAL;
@@ -162,14 +190,13 @@ static int call_daemon(const char *socket_path, uuidd_prot_op_t op, char *buf,
 		return -1;
 	}
 
-	if (op == UUIDD_OP_BULK_RANDOM_UUID) {
+	if (is_bulk_list_op(op)) {
 		if ((buflen - sizeof(*num)) < (size_t)((*num) * sizeof(uuid_t)))
 			*num = (buflen - sizeof(*num)) / sizeof(uuid_t);
 	}
 	op_buf[0] = op;
 	op_len = sizeof(op);
-	if ((op == UUIDD_OP_BULK_TIME_UUID) ||
-	    (op == UUIDD_OP_BULK_RANDOM_UUID)) {
+	if (op == UUIDD_OP_BULK_TIME_UUID || is_bulk_list_op(op)) {
 		memcpy(op_buf + sizeof(op), num, sizeof(*num));
 		op_len += sizeof(*num);
 	}
@@ -203,7 +230,7 @@ static int call_daemon(const char *socket_path, uuidd_prot_op_t op, char *buf,
 		else
 			*num = -1;
 	}
-	if ((ret > 0) && (op == UUIDD_OP_BULK_RANDOM_UUID)) {
+	if ((ret > 0) && is_bulk_list_op(op)) {
 		if (sizeof(*num) <= (size_t) reply_len)
 			memcpy(buf, num, sizeof(*num));
 		else
@@ -307,6 +334,8 @@ static void __attribute__((__noreturn__)) all_done(const struct uuidd_cxt_t *uui
 		unlink(uuidd_cxt->cleanup_pidfile);
 	if (uuidd_cxt->cleanup_socket)
 		unlink(uuidd_cxt->cleanup_socket);
+	if (uuidd_cxt->cleanup_ring)
+		unlink(uuidd_cxt->cleanup_ring);
 	exit(ret);
 }
 
@@ -337,28 +366,849 @@ static void timeout_handler(int sig __attribute__((__unused__)),
 		errx(EXIT_FAILURE, _("timed out"));
 }
 
+/*
+ * The UUIDs are pre-generated by worker threads to pools, so the main thread
+ * (epoll loop) only copies the UUIDs to the replies. Every pool has two
+ * buffers; the current buffer is used by the main thread and the other is
+ * refilled by a worker. The time-based UUIDs are not used when older than
+ * UUIDD_POOL_MAXAGE. If the pool is empty, the main thread generates the
+ * UUIDs directly.
+ */
+enum {
+	UUIDD_POOL_TIME = 0,		/* time-based range */
+	UUIDD_POOL_RANDOM,
+	UUIDD_POOL_TIME_V6,
+	UUIDD_POOL_TIME_V7,
+	UUIDD_NPOOLS
+};
+
+#define UUIDD_POOL_SIZE		4096		/* UUIDs in the pool buffer */
+#define UUIDD_RANGE_SIZE	1000000		/* time-based range size */
+#define UUIDD_POOL_MAXAGE	1000000		/* max age of time-based UUIDs in usec */
+#define UUIDD_NWORKERS		2
+#define UUIDD_MAXEVENTS		64
+#define UUIDD_MAXCONNS		512		/* max number of open connections */
+#define UUIDD_CONN_TIMEOUT	5000000		/* max connection lifetime in usec */
+#define UUIDD_ACCEPT_BACKOFF	100000		/* accept() pause on EMFILE in usec */
+
+enum {
+	POOLBUF_FREE = 0,
+	POOLBUF_FILLING,
+	POOLBUF_READY,
+	POOLBUF_CURRENT
+};
+
+struct uuidd_poolbuf {
+	uuid_t		*uuids;		/* NULL for the time-based range */
+	uuid_t		first;		/* the first UUID of the range */
+	uint64_t	first_time;	/* timestamp of the first UUID */
+	size_t		pos;		/* the next unused UUID */
+	size_t		count;		/* number of UUIDs */
+	uint64_t	stamp;		/* when generated */
+	int		rc;		/* generator return code */
+	int		state;		/* POOLBUF_* */
+};
+
+struct uuidd_pool {
+	struct uuidd_poolbuf	bufs[2];
+	struct uuidd_poolbuf	*cur;
+};
+
+#define UUIDD_LATENCY_NBUCKETS	16	/* <1us, <2us, <4us, ... >=8192us */
+
+struct uuidd_stats {
+	uint64_t	start;
+	uint64_t	requests;
+	uint64_t	ops[UUIDD_MAX_OP + 1];
+	uint64_t	pool_hits;
+	uint64_t	pool_misses;
+	uint64_t	ring_refills;
+	uint64_t	conn_timeouts;
+	uint64_t	accept_errors;
+	uint64_t	latency[UUIDD_LATENCY_NBUCKETS];
+};
+
+/* client connection */
+struct uuidd_conn {
+	struct list_head conns;		/* uuidd_server->conns, ordered by start */
+	int		fd;
+	uint64_t	start;		/* accept time */
+
+	char		req[sizeof(uuidd_prot_op_t) + sizeof(uuidd_prot_num_t)];
+	size_t		reqlen;		/* already read bytes */
+
+	char		reply[sizeof(int32_t) + UUIDD_PROT_BUFSZ];
+	size_t		replylen;
+	size_t		written;
+
+	unsigned int	waitout : 1;	/* waiting for EPOLLOUT */
+};
+
+struct uuidd_server {
+	struct uuidd_cxt_t	*cxt;
+	struct uuidd_pool	pools[UUIDD_NPOOLS];
+	struct uuidd_stats	stats;
+	struct uuidd_ring	*ring;		/* --ring */
+	uint64_t		ring_tail;	/* the next slot to fill */
+
+	struct list_head	conns;		/* open connections */
+	size_t			nconns;
+	uint64_t		accept_resume;	/* when to accept() again after EMFILE */
+	unsigned int		accept_off : 1;	/* listening socket not in epoll */
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_t		lock;
+	pthread_cond_t		cond;
+#endif
+};
+
+static uint64_t now_usec(void)
+{
+	struct timeval tv;
+
+	gettime_monotonic(&tv);
+	return (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/* 60-bit timestamp of the time-based UUID */
+static uint64_t uuid_get_time_v1(const uuid_t uu)
+{
+	return ((uint64_t) (uu[6] & 0x0F) << 56) | ((uint64_t) uu[7] << 48)
+	       | ((uint64_t) uu[4] << 40) | ((uint64_t) uu[5] << 32)
+	       | ((uint64_t) uu[0] << 24) | ((uint64_t) uu[1] << 16)
+	       | ((uint64_t) uu[2] << 8) | uu[3];
+}
+
+static void uuid_set_time_v1(uuid_t uu, uint64_t t)
+{
+	uu[0] = t >> 24;
+	uu[1] = t >> 16;
+	uu[2] = t >> 8;
+	uu[3] = t;
+	uu[4] = t >> 40;
+	uu[5] = t >> 32;
+	uu[6] = (uu[6] & 0xF0) | ((t >> 56) & 0x0F);
+	uu[7] = t >> 48;
+}
+
+static void poolbuf_fill(int type, struct uuidd_poolbuf *b)
+{
+	int num;
+
+	switch (type) {
+	case UUIDD_POOL_TIME:
+		num = UUIDD_RANGE_SIZE;
+		b->rc = __uuid_generate_time(b->first, &num);
+		b->first_time = uuid_get_time_v1(b->first);
+		b->count = UUIDD_RANGE_SIZE;
+		break;
+	case UUIDD_POOL_RANDOM:
+		num = UUIDD_POOL_SIZE;
+		b->rc = __uuid_generate_random((unsigned char *) b->uuids, &num);
+		b->count = num;
+		break;
+	case UUIDD_POOL_TIME_V6:
+		num = UUIDD_POOL_SIZE;
+		b->rc = __uuid_generate_time_v6((unsigned char *) b->uuids, &num);
+		b->count = num;
+		break;
+	case UUIDD_POOL_TIME_V7:
+		b->rc = uuid_generate_time_v7_bulk(b->uuids, UUIDD_POOL_SIZE);
+		b->count = UUIDD_POOL_SIZE;
+		break;
+	}
+	b->pos = 0;
+	b->stamp = now_usec();
+}
+
+static inline int poolbuf_is_stale(int type, struct uuidd_poolbuf *b, uint64_t now)
+{
+	return type != UUIDD_POOL_RANDOM && now - b->stamp > UUIDD_POOL_MAXAGE;
+}
+
+static void init_pools(struct uuidd_server *srv)
+{
+	size_t i, x;
+
+	for (i = 0; i < UUIDD_NPOOLS; i++) {
+		if (i == UUIDD_POOL_TIME)
+			continue;
+		for (x = 0; x < ARRAY_SIZE(srv->pools[i].bufs); x++)
+			srv->pools[i].bufs[x].uuids = xcalloc(UUIDD_POOL_SIZE, sizeof(uuid_t));
+	}
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_init(&srv->lock, NULL);
+	pthread_cond_init(&srv->cond, NULL);
+#endif
+}
+
+#ifdef HAVE_LIBPTHREAD
+static void *pool_worker(void *data)
+{
+	struct uuidd_server *srv = (struct uuidd_server *) data;
+
+	pthread_mutex_lock(&srv->lock);
+	while (1) {
+		struct uuidd_poolbuf *b = NULL;
+		size_t i;
+		int type;
+
+		for (type = 0; !b && type < UUIDD_NPOOLS; type++) {
+			for (i = 0; i < ARRAY_SIZE(srv->pools[type].bufs); i++) {
+				if (srv->pools[type].bufs[i].state == POOLBUF_FREE) {
+					b = &srv->pools[type].bufs[i];
+					break;
+				}
+			}
+		}
+		if (!b) {
+			pthread_cond_wait(&srv->cond, &srv->lock);
+			continue;
+		}
+		b->state = POOLBUF_FILLING;
+		pthread_mutex_unlock(&srv->lock);
+
+		poolbuf_fill(type - 1, b);
+
+		pthread_mutex_lock(&srv->lock);
+		b->state = POOLBUF_READY;
+	}
+	return NULL;
+}
+#endif
+
+/* the workers inherit blocked signals, call after sigprocmask() */
+static void start_workers(struct uuidd_server *srv)
+{
+#ifdef HAVE_LIBPTHREAD
+	size_t i;
+
+	for (i = 0; i < UUIDD_NWORKERS; i++) {
+		pthread_t thread;
+
+		if (pthread_create(&thread, NULL, pool_worker, srv) != 0) {
+			if (!srv->cxt->quiet)
+				warn(_("cannot create worker thread"));
+			break;
+		}
+		pthread_detach(thread);
+	}
+#else
+	(void) srv;
+#endif
+}
+
+/*
+ * Returns pool buffer with at least @num unused UUIDs or NULL. The exhausted or
+ * stale current buffer is replaced by the buffer prepared by a worker.
+ */
+static struct uuidd_poolbuf *pool_get(struct uuidd_server *srv, int type, size_t num)
+{
+	struct uuidd_pool *pool = &srv->pools[type];
+	struct uuidd_poolbuf *b = pool->cur;
+	uint64_t now = now_usec();
+	size_t i;
+
+	if (b && b->pos + num <= b->count && !poolbuf_is_stale(type, b, now))
+		return b;
+
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_lock(&srv->lock);
+#endif
+	if (b)
+		b->state = POOLBUF_FREE;
+	pool->cur = NULL;
+
+	for (i = 0; i < ARRAY_SIZE(pool->bufs); i++) {
+		b = &pool->bufs[i];
+		if (b->state != POOLBUF_READY)
+			continue;
+		if (poolbuf_is_stale(type, b, now)) {
+			b->state = POOLBUF_FREE;
+			continue;
+		}
+		b->state = POOLBUF_CURRENT;
+		pool->cur = b;
+		break;
+	}
+#ifdef HAVE_LIBPTHREAD
+	pthread_cond_broadcast(&srv->cond);
+	pthread_mutex_unlock(&srv->lock);
+#else
+	if (!pool->cur) {
+		/* no workers, refill now */
+		b = &pool->bufs[0];
+		poolbuf_fill(type, b);
+		b->state = POOLBUF_CURRENT;
+		pool->cur = b;
+	}
+#endif
+	b = pool->cur;
+	if (b && b->pos + num <= b->count)
+		return b;
+	return NULL;
+}
+
+/*
+ * Copies @num UUIDs from the pool to @out. For the time-based range only the
+ * first UUID is copied. Returns 0 on success, -1 if the pool is empty.
+ */
+static int pool_copy(struct uuidd_server *srv, int type,
+		     unsigned char *out, size_t num, int *rc)
+{
+	struct uuidd_poolbuf *b = pool_get(srv, type, num);
+
+	if (!b) {
+		srv->stats.pool_misses++;
+		return -1;
+	}
+
+	if (b->uuids)
+		memcpy(out, b->uuids[b->pos], num * sizeof(uuid_t));
+	else {
+		memcpy(out, b->first, sizeof(uuid_t));
+		uuid_set_time_v1(out, b->first_time + b->pos);
+	}
+	b->pos += num;
+	*rc = b->rc;
+	srv->stats.pool_hits++;
+	return 0;
+}
+
+/*
+ * Creates the shared-memory ring (see uuidd.h). The ring is readable and
+ * writable for the daemon group, the clients have to be trusted.
+ */
+static void ring_create(struct uuidd_server *srv, const char *path)
+{
+	size_t i, sz = UUIDD_RING_SIZE(UUIDD_RING_NSLOTS);
+	struct uuidd_ring *r;
+	mode_t save_umask;
+	int fd;
+
+	unlink(path);
+	save_umask = umask(0);
+	fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0660);
+	umask(save_umask);
+	if (fd < 0)
+		err(EXIT_FAILURE, _("cannot create %s"), path);
+	srv->cxt->cleanup_ring = path;
+
+	if (ftruncate(fd, sz) != 0)
+		err(EXIT_FAILURE, _("could not truncate file: %s"), path);
+	r = mmap(NULL, sz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (r == MAP_FAILED)
+		err(EXIT_FAILURE, _("cannot map %s"), path);
+	close(fd);
+
+	r->nslots = UUIDD_RING_NSLOTS;
+	for (i = 0; i < UUIDD_RING_NSLOTS; i++)
+		r->slots[i].seq = i;
+	r->version = UUIDD_RING_VERSION;
+	__atomic_store_n(&r->magic, UUIDD_RING_MAGIC, __ATOMIC_RELEASE);
+
+	srv->ring = r;
+}
+
+/*
+ * Fills all free slots of the ring by ranges of UUIDD_RING_RANGE UUIDs. The
+ * ranges are reserved in the clock file by one request.
+ */
+static void ring_refill(struct uuidd_server *srv)
+{
+	struct uuidd_ring *r = srv->ring;
+	uint64_t pos = srv->ring_tail, first_time;
+	uuid_t first;
+	time_t now;
+	int i, n = 0, num;
+
+	if (!r)
+		return;
+
+	/* the next request wakes us again */
+	__atomic_store_n(&r->wakeup, 0, __ATOMIC_RELEASE);
+
+	while (n < UUIDD_RING_NSLOTS
+	       && __atomic_load_n(&r->slots[(pos + n) % UUIDD_RING_NSLOTS].seq,
+				  __ATOMIC_ACQUIRE) == pos + n)
+		n++;
+	if (!n)
+		return;
+
+	num = n * UUIDD_RING_RANGE;
+	if (__uuid_generate_time(first, &num) < 0) {
+		/* don't share unsafe UUIDs */
+		if (!srv->cxt->quiet)
+			warnx(_("failed to open/lock clock counter"));
+		return;
+	}
+	first_time = uuid_get_time_v1(first);
+	now = time(NULL);
+
+	for (i = 0; i < n; i++, pos++) {
+		struct uuidd_ring_slot *sl = &r->slots[pos % UUIDD_RING_NSLOTS];
+
+		memcpy(sl->first, first, sizeof(uuid_t));
+		uuid_set_time_v1(sl->first, first_time + (uint64_t) i * UUIDD_RING_RANGE);
+		sl->count = UUIDD_RING_RANGE;
+		sl->stamp = now;
+		__atomic_store_n(&sl->seq, pos + 1, __ATOMIC_RELEASE);
+	}
+	srv->ring_tail = pos;
+	__atomic_store_n(&r->tail, pos, __ATOMIC_RELEASE);
+	srv->stats.ring_refills++;
+
+	if (srv->cxt->debug)
+		fprintf(stderr, _("Refilled %d ring slots\n"), n);
+}
+
+static int32_t format_stats(struct uuidd_server *srv, char *buf, size_t bufsz)
+{
+	struct uuidd_stats *st = &srv->stats;
+	uint64_t uptime = now_usec() - st->start;
+	size_t i, len;
+
+	len = snprintf(buf, bufsz,
+			"uptime: %"PRIu64".%03"PRIu64" s\n"
+			"requests: %"PRIu64"\n"
+			"rate: %.1f req/s\n"
+			"pool hits: %"PRIu64"\n"
+			"pool misses: %"PRIu64"\n"
+			"connections: %zu\n"
+			"connection timeouts: %"PRIu64"\n"
+			"accept errors: %"PRIu64"\n",
+			uptime / 1000000, uptime % 1000000 / 1000,
+			st->requests,
+			uptime ? st->requests * 1000000.0 / uptime : 0.0,
+			st->pool_hits, st->pool_misses,
+			srv->nconns, st->conn_timeouts, st->accept_errors);
+
+	if (srv->ring && len < bufsz)
+		len += snprintf(buf + len, bufsz - len,
+				"ring refills: %"PRIu64"\n", st->ring_refills);
+
+	for (i = 0; i < ARRAY_SIZE(st->ops) && len < bufsz; i++) {
+		if (st->ops[i])
+			len += snprintf(buf + len, bufsz - len,
+					"operation %zu: %"PRIu64"\n", i, st->ops[i]);
+	}
+	for (i = 0; i < UUIDD_LATENCY_NBUCKETS && len < bufsz; i++) {
+		if (i == UUIDD_LATENCY_NBUCKETS - 1)
+			len += snprintf(buf + len, bufsz - len,
+					"latency >= %u us: %"PRIu64"\n",
+					1U << (i - 1), st->latency[i]);
+		else
+			len += snprintf(buf + len, bufsz - len,
+					"latency < %u us: %"PRIu64"\n",
+					1U << i, st->latency[i]);
+	}
+	if (len >= bufsz)
+		len = bufsz - 1;
+	return len + 1;
+}
+
+/*
+ * Generates reply for the request to @reply_buf. Returns the reply length or
+ * -1 for invalid requests.
+ */
+static int32_t handle_request(struct uuidd_server *srv, uuidd_prot_op_t op,
+			      uuidd_prot_num_t num, char *reply_buf, size_t bufsz)
+{
+	struct uuidd_cxt_t *uuidd_cxt = srv->cxt;
+	unsigned char *uu = (unsigned char *) reply_buf;
+	char str[UUID_STR_LEN], *cp;
+	int32_t reply_len = 0;
+	int i, type, rc = 0;
+
+	switch (op) {
+	case UUIDD_OP_GETPID:
+		snprintf(reply_buf, bufsz, "%d", getpid());
+		reply_len = strlen(reply_buf) + 1;
+		break;
+	case UUIDD_OP_GET_MAXOP:
+		snprintf(reply_buf, bufsz, "%d", UUIDD_MAX_OP);
+		reply_len = strlen(reply_buf) + 1;
+		break;
+	case UUIDD_OP_GET_STATS:
+		reply_len = format_stats(srv, reply_buf, bufsz);
+		break;
+	case UUIDD_OP_RING_REFILL:
+		ring_refill(srv);
+		break;
+	case UUIDD_OP_TIME_UUID:
+		num = 1;
+		if (pool_copy(srv, UUIDD_POOL_TIME, uu, 1, &rc) != 0)
+			rc = __uuid_generate_time(uu, &num);
+		if (rc < 0 && !uuidd_cxt->quiet)
+			warnx(_("failed to open/lock clock counter"));
+		if (uuidd_cxt->debug) {
+			uuid_unparse(uu, str);
+			fprintf(stderr, _("Generated time UUID: %s\n"), str);
+		}
+		reply_len = sizeof(uuid_t);
+		break;
+	case UUIDD_OP_RANDOM_UUID:
+		num = 1;
+		if (pool_copy(srv, UUIDD_POOL_RANDOM, uu, 1, &rc) != 0)
+			__uuid_generate_random(uu, &num);
+		if (uuidd_cxt->debug) {
+			uuid_unparse(uu, str);
+			fprintf(stderr, _("Generated random UUID: %s\n"), str);
+		}
+		reply_len = sizeof(uuid_t);
+		break;
+	case UUIDD_OP_TIME_V6_UUID:
+		num = 1;
+		if (pool_copy(srv, UUIDD_POOL_TIME_V6, uu, 1, &rc) != 0)
+			rc = __uuid_generate_time_v6(uu, &num);
+		if (rc < 0 && !uuidd_cxt->quiet)
+			warnx(_("failed to open/lock clock counter"));
+		if (uuidd_cxt->debug) {
+			uuid_unparse(uu, str);
+			fprintf(stderr, _("Generated time-v6 UUID: %s\n"), str);
+		}
+		reply_len = sizeof(uuid_t);
+		break;
+	case UUIDD_OP_TIME_V7_UUID:
+		if (pool_copy(srv, UUIDD_POOL_TIME_V7, uu, 1, &rc) != 0)
+			uuid_generate_time_v7(uu);
+		if (uuidd_cxt->debug) {
+			uuid_unparse(uu, str);
+			fprintf(stderr, _("Generated time-v7 UUID: %s\n"), str);
+		}
+		reply_len = sizeof(uuid_t);
+		break;
+	case UUIDD_OP_BULK_TIME_UUID:
+		if (num <= 0 || pool_copy(srv, UUIDD_POOL_TIME, uu, num, &rc) != 0)
+			rc = __uuid_generate_time(uu, &num);
+		if (rc < 0 && !uuidd_cxt->quiet)
+			warnx(_("failed to open/lock clock counter"));
+		if (uuidd_cxt->debug) {
+			uuid_unparse(uu, str);
+			fprintf(stderr, P_("Generated time UUID %s "
+					   "and %d following\n",
+					   "Generated time UUID %s "
+					   "and %d following\n", num - 1),
+			       str, num - 1);
+		}
+		reply_len = sizeof(uuid_t);
+		memcpy(reply_buf + reply_len, &num, sizeof(num));
+		reply_len += sizeof(num);
+		break;
+	case UUIDD_OP_BULK_RANDOM_UUID:
+	case UUIDD_OP_BULK_TIME_V6_UUID:
+	case UUIDD_OP_BULK_TIME_V7_UUID:
+		if (num < 0)
+			num = 1;
+		if ((bufsz - sizeof(num)) < (size_t) (sizeof(uuid_t) * num))
+			num = (bufsz - sizeof(num)) / sizeof(uuid_t);
+		cp = reply_buf + sizeof(num);
+
+		type = op == UUIDD_OP_BULK_RANDOM_UUID ? UUIDD_POOL_RANDOM :
+		       op == UUIDD_OP_BULK_TIME_V6_UUID ? UUIDD_POOL_TIME_V6 :
+							  UUIDD_POOL_TIME_V7;
+
+		if (pool_copy(srv, type, (unsigned char *) cp, num, &rc) == 0)
+			;
+		else if (op == UUIDD_OP_BULK_RANDOM_UUID)
+			__uuid_generate_random((unsigned char *) cp, &num);
+		else if (op == UUIDD_OP_BULK_TIME_V7_UUID)
+			uuid_generate_time_v7_bulk((uuid_t *) cp, num);
+		else
+			rc = __uuid_generate_time_v6((unsigned char *) cp, &num);
+
+		if (rc < 0 && op == UUIDD_OP_BULK_TIME_V6_UUID && !uuidd_cxt->quiet)
+			warnx(_("failed to open/lock clock counter"));
+		reply_len = sizeof(num) + (sizeof(uuid_t) * num);
+		memcpy(reply_buf, &num, sizeof(num));
+		if (uuidd_cxt->debug) {
+			fprintf(stderr, P_("Generated %d UUID:\n",
+					   "Generated %d UUIDs:\n", num), num);
+			for (i = 0; i < num; i++) {
+				uuid_unparse((unsigned char *)cp, str);
+				fprintf(stderr, "\t%s\n", str);
+				cp += sizeof(uuid_t);
+			}
+		}
+		break;
+	default:
+		if (uuidd_cxt->debug)
+			fprintf(stderr, _("Invalid operation %d\n"), op);
+		return -1;
+	}
+
+	srv->stats.requests++;
+	srv->stats.ops[op]++;
+	return reply_len;
+}
+
+static size_t request_size(uuidd_prot_op_t op)
+{
+	if (op == UUIDD_OP_BULK_TIME_UUID || is_bulk_list_op(op))
+		return sizeof(op) + sizeof(uuidd_prot_num_t);
+	return sizeof(op);
+}
+
+/*
+ * Reads the request from non-blocking socket. Returns 1 if the request is
+ * complete, 0 if more data are expected, and -1 on error.
+ */
+static int conn_read(struct uuidd_conn *conn)
+{
+	while (1) {
+		size_t need = conn->reqlen ? request_size(conn->req[0])
+					   : sizeof(uuidd_prot_op_t);
+		ssize_t ret;
+
+		if (conn->reqlen == need)
+			return 1;
+
+		ret = read(conn->fd, conn->req + conn->reqlen, need - conn->reqlen);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return 0;
+			warn(_("read failed"));
+			return -1;
+		}
+		if (ret == 0) {
+			if (!conn->reqlen)
+				warnx(_("error reading from client, len = %d"), 0);
+			return -1;
+		}
+		conn->reqlen += ret;
+	}
+}
+
+/* Returns 1 if the reply has been written, 0 if the socket is full, -1 on error. */
+static int conn_write(struct uuidd_conn *conn)
+{
+	while (conn->written < conn->replylen) {
+		ssize_t ret = send(conn->fd, conn->reply + conn->written,
+				   conn->replylen - conn->written, MSG_NOSIGNAL);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return 0;
+			return -1;
+		}
+		conn->written += ret;
+	}
+	return 1;
+}
+
+static int conn_process(struct uuidd_server *srv, struct uuidd_conn *conn)
+{
+	uuidd_prot_op_t op = conn->req[0];
+	uuidd_prot_num_t num = 0;
+	int32_t reply_len;
+
+	if (conn->reqlen > sizeof(op)) {
+		memcpy(&num, conn->req + sizeof(op), sizeof(num));
+		if (srv->cxt->debug)
+			fprintf(stderr, _("operation %d, incoming num = %d\n"),
+			       op, num);
+	} else if (srv->cxt->debug)
+		fprintf(stderr, _("operation %d\n"), op);
+
+	reply_len = handle_request(srv, op, num,
+				   conn->reply + sizeof(reply_len), UUIDD_PROT_BUFSZ);
+	if (reply_len < 0)
+		return -1;
+
+	memcpy(conn->reply, &reply_len, sizeof(reply_len));
+	conn->replylen = sizeof(reply_len) + reply_len;
+	return 0;
+}
+
+static void conn_account_latency(struct uuidd_server *srv, struct uuidd_conn *conn)
+{
+	uint64_t lat = now_usec() - conn->start;
+	size_t i = 0;
+
+	while (lat && i < UUIDD_LATENCY_NBUCKETS - 1) {
+		lat >>= 1;
+		i++;
+	}
+	srv->stats.latency[i]++;
+}
+
+static void conn_free(struct uuidd_server *srv, struct uuidd_conn *conn)
+{
+	list_del(&conn->conns);
+	srv->nconns--;
+	close(conn->fd);
+	free(conn);
+}
+
+/* reads the request and writes the reply as far as possible without blocking */
+static void conn_event(struct uuidd_server *srv, int epfd, struct uuidd_conn *conn)
+{
+	int rc;
+
+	if (!conn->replylen) {
+		rc = conn_read(conn);
+		if (rc == 0)
+			return;
+		if (rc < 0 || conn_process(srv, conn) != 0)
+			goto done;
+	}
+
+	rc = conn_write(conn);
+	if (rc == 0) {
+		if (!conn->waitout) {
+			struct epoll_event ev = { .events = EPOLLOUT, .data.ptr = conn };
+
+			if (epoll_ctl(epfd, EPOLL_CTL_MOD, conn->fd, &ev) < 0)
+				goto done;
+			conn->waitout = 1;
+		}
+		return;
+	}
+	if (rc > 0)
+		conn_account_latency(srv, conn);
+done:
+	conn_free(srv, conn);
+}
+
+/* closes connections without complete request/reply after UUIDD_CONN_TIMEOUT */
+static void expire_connections(struct uuidd_server *srv)
+{
+	uint64_t now = now_usec();
+
+	while (!list_empty(&srv->conns)) {
+		struct uuidd_conn *conn = list_first_entry(&srv->conns,
+						struct uuidd_conn, conns);
+
+		if (conn->start + UUIDD_CONN_TIMEOUT > now)
+			break;
+		if (srv->cxt->debug)
+			fprintf(stderr, _("connection timeout, fd %d\n"), conn->fd);
+		srv->stats.conn_timeouts++;
+		conn_free(srv, conn);
+	}
+}
+
+/*
+ * The listening socket is removed from epoll if there are too many
+ * connections or if accept() is out of resources (@resume is not zero), the
+ * listen backlog keeps the clients waiting.
+ */
+static void accept_disable(struct uuidd_server *srv, int epfd, int *s, uint64_t resume)
+{
+	if (!srv->accept_off) {
+		if (epoll_ctl(epfd, EPOLL_CTL_DEL, *s, NULL) < 0)
+			err(EXIT_FAILURE, _("cannot remove file descriptor from epoll"));
+		srv->accept_off = 1;
+	}
+	srv->accept_resume = resume;
+}
+
+static void accept_enable(struct uuidd_server *srv, int epfd, int *s)
+{
+	struct epoll_event ev = { .events = EPOLLIN, .data.ptr = s };
+
+	if (!srv->accept_off
+	    || srv->nconns >= UUIDD_MAXCONNS
+	    || (srv->accept_resume && now_usec() < srv->accept_resume))
+		return;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, *s, &ev) < 0)
+		err(EXIT_FAILURE, _("cannot add file descriptor to epoll"));
+	srv->accept_off = 0;
+	srv->accept_resume = 0;
+}
+
+/*
+ * Returns epoll_wait() timeout in milliseconds to expire the oldest connection
+ * or to accept() again, or -1.
+ */
+static int server_next_timeout(struct uuidd_server *srv)
+{
+	uint64_t now = now_usec(), deadline = 0;
+
+	if (!list_empty(&srv->conns))
+		deadline = list_first_entry(&srv->conns,
+				struct uuidd_conn, conns)->start + UUIDD_CONN_TIMEOUT;
+	if (srv->accept_off && srv->accept_resume
+	    && (!deadline || srv->accept_resume < deadline))
+		deadline = srv->accept_resume;
+	if (!deadline)
+		return -1;
+	return deadline > now ? (int) ((deadline - now + 999) / 1000) : 0;
+}
+
+static void accept_clients(struct uuidd_server *srv, int epfd, int *s)
+{
+	while (srv->nconns < UUIDD_MAXCONNS) {
+		struct epoll_event ev = { .events = EPOLLIN };
+		struct uuidd_conn *conn;
+		int ns;
+
+		ns = accept4(*s, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (ns < 0) {
+			switch (errno) {
+			case EINTR:
+			case ECONNABORTED:	/* client is gone */
+			case EPROTO:
+				continue;
+			case EAGAIN:
+#if EAGAIN != EWOULDBLOCK
+			case EWOULDBLOCK:
+#endif
+				return;
+			case EMFILE:
+			case ENFILE:
+			case ENOBUFS:
+			case ENOMEM:
+				/* don't exit, try it later */
+				srv->stats.accept_errors++;
+				if (!srv->cxt->quiet)
+					warn(_("accept failed"));
+				accept_disable(srv, epfd, s, now_usec() + UUIDD_ACCEPT_BACKOFF);
+				return;
+			default:
+				err(EXIT_FAILURE, "accept");
+			}
+		}
+
+		conn = calloc(1, sizeof(*conn));
+		if (!conn) {
+			close(ns);
+			continue;
+		}
+		conn->fd = ns;
+		conn->start = now_usec();
+
+		ev.data.ptr = conn;
+		if (epoll_ctl(epfd, EPOLL_CTL_ADD, ns, &ev) < 0) {
+			close(ns);
+			free(conn);
+			continue;
+		}
+		list_add_tail(&conn->conns, &srv->conns);
+		srv->nconns++;
+
+		/* the request is usually already in the socket */
+		conn_event(srv, epfd, conn);
+	}
+
+	if (srv->cxt->debug)
+		fprintf(stderr, _("too many connections (%zu)\n"), srv->nconns);
+	accept_disable(srv, epfd, s, 0);
+}
+
 static void server_loop(const char *socket_path, const char *pidfile_path,
-			struct uuidd_cxt_t *uuidd_cxt)
-{
-	struct sockaddr_un	from_addr;
-	socklen_t		fromlen;
-	int32_t			reply_len = 0;
-	uuid_t			uu;
-	char			reply_buf[UUIDD_PROT_BUFSZ], *cp;
-	uuidd_prot_op_t 	op;
-	char			str[UUID_STR_LEN];
-	int			i, ns, len;
-	uuidd_prot_num_t	num;		/* intentionally uninitialized */
+			const char *ring_path, struct uuidd_cxt_t *uuidd_cxt)
+{
+	struct uuidd_server	srv = { .cxt = uuidd_cxt };
+	struct epoll_event	ev, events[UUIDD_MAXEVENTS];
+	char			reply_buf[UUIDD_PROT_BUFSZ];
 	int			s = 0;
 	int			fd_pidfile = -1;
-	int			ret;
-	struct pollfd		pfd[2];
+	int			ret, i, epfd, wait;
 	sigset_t		sigmask;
 	int			sigfd;
-	enum {
-				POLLFD_SIGNAL = 0,
-				POLLFD_SOCKET
-	};
 
 #ifdef HAVE_LIBSYSTEMD
 	if (!uuidd_cxt->no_sock)	/* no_sock implies no_fork and no_pid */
@@ -434,131 +1284,66 @@ static void server_loop(const char *socket_path, const char *pidfile_path,
 	if ((sigfd = signalfd(-1, &sigmask, 0)) < 0)
 		err(EXIT_FAILURE, _("cannot set signal handler"));
 
-	pfd[POLLFD_SIGNAL].fd = sigfd;
-	pfd[POLLFD_SOCKET].fd = s;
-	pfd[POLLFD_SIGNAL].events = pfd[POLLFD_SOCKET].events = POLLIN | POLLERR | POLLHUP;
+	/* accept() all pending clients in one loop iteration */
+	ret = fcntl(s, F_GETFL);
+	if (ret < 0 || fcntl(s, F_SETFL, ret | O_NONBLOCK) < 0)
+		err(EXIT_FAILURE, _("cannot set non-blocking mode"));
+
+	if ((epfd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+		err(EXIT_FAILURE, _("cannot create epoll"));
+
+	ev.events = EPOLLIN;
+	ev.data.ptr = &sigfd;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, sigfd, &ev) < 0)
+		err(EXIT_FAILURE, _("cannot add file descriptor to epoll"));
+	ev.data.ptr = &s;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, s, &ev) < 0)
+		err(EXIT_FAILURE, _("cannot add file descriptor to epoll"));
+
+	if (ring_path) {
+		ring_create(&srv, ring_path);
+		ring_refill(&srv);
+	}
+
+	INIT_LIST_HEAD(&srv.conns);
+	init_pools(&srv);
+	start_workers(&srv);
+	srv.stats.start = now_usec();
 
 	while (1) {
-		ret = poll(pfd, ARRAY_SIZE(pfd),
-				uuidd_cxt->timeout ?
-					(int) uuidd_cxt->timeout * 1000 : -1);
+		int conn_wait = server_next_timeout(&srv);
+
+		wait = uuidd_cxt->timeout ? (int) uuidd_cxt->timeout * 1000 : -1;
+		if (conn_wait >= 0 && (wait < 0 || conn_wait < wait))
+			wait = conn_wait;
+		else
+			conn_wait = -1;
+
+		ret = epoll_wait(epfd, events, ARRAY_SIZE(events), wait);
 		if (ret < 0) {
-			if (errno == EAGAIN)
+			if (errno == EAGAIN || errno == EINTR)
 				continue;
 			warn(_("poll failed"));
 			all_done(uuidd_cxt, EXIT_FAILURE);
 		}
-		if (ret == 0) {		/* true when poll() times out */
+		if (ret == 0 && conn_wait < 0) {	/* true when epoll_wait() times out */
 			if (uuidd_cxt->debug)
 				fprintf(stderr, _("timeout [%d sec]\n"), uuidd_cxt->timeout);
 			all_done(uuidd_cxt, EXIT_SUCCESS);
 		}
-		if (pfd[POLLFD_SIGNAL].revents != 0)
-			handle_signal(uuidd_cxt, sigfd);
-		if (pfd[POLLFD_SOCKET].revents == 0)
-			continue;
-		fromlen = sizeof(from_addr);
-		ns = accept(s, (struct sockaddr *) &from_addr, &fromlen);
-		if (ns < 0) {
-			if ((errno == EAGAIN) || (errno == EINTR))
-				continue;
-			err(EXIT_FAILURE, "accept");
-		}
-		len = read(ns, &op, sizeof(op));
-		if (len != sizeof(op)) {
-			if (len < 0)
-				warn(_("read failed"));
+		for (i = 0; i < ret; i++) {
+			void *ptr = events[i].data.ptr;
+
+			if (ptr == &sigfd)
+				handle_signal(uuidd_cxt, sigfd);
+			else if (ptr == &s)
+				accept_clients(&srv, epfd, &s);
 			else
-				warnx(_("error reading from client, len = %d"),
-						len);
-			goto shutdown_socket;
-		}
-		if ((op == UUIDD_OP_BULK_TIME_UUID) ||
-		    (op == UUIDD_OP_BULK_RANDOM_UUID)) {
-			if (read_all(ns, (char *) &num, sizeof(num)) != sizeof(num))
-				goto shutdown_socket;
-			if (uuidd_cxt->debug)
-				fprintf(stderr, _("operation %d, incoming num = %d\n"),
-				       op, num);
-		} else if (uuidd_cxt->debug)
-			fprintf(stderr, _("operation %d\n"), op);
-
-		switch (op) {
-		case UUIDD_OP_GETPID:
-			snprintf(reply_buf, sizeof(reply_buf), "%d", getpid());
-			reply_len = strlen(reply_buf) + 1;
-			break;
-		case UUIDD_OP_GET_MAXOP:
-			snprintf(reply_buf, sizeof(reply_buf), "%d", UUIDD_MAX_OP);
-			reply_len = strlen(reply_buf) + 1;
-			break;
-		case UUIDD_OP_TIME_UUID:
-			num = 1;
-			if (__uuid_generate_time(uu, &num) < 0 && !uuidd_cxt->quiet)
-				warnx(_("failed to open/lock clock counter"));
-			if (uuidd_cxt->debug) {
-				uuid_unparse(uu, str);
-				fprintf(stderr, _("Generated time UUID: %s\n"), str);
-			}
-			memcpy(reply_buf, uu, sizeof(uu));
-			reply_len = sizeof(uu);
-			break;
-		case UUIDD_OP_RANDOM_UUID:
-			num = 1;
-			if (__uuid_generate_time(uu, &num) < 0 && !uuidd_cxt->quiet)
-				warnx(_("failed to open/lock clock counter"));
-			if (uuidd_cxt->debug) {
-				uuid_unparse(uu, str);
-				fprintf(stderr, _("Generated random UUID: %s\n"), str);
-			}
-			memcpy(reply_buf, uu, sizeof(uu));
-			reply_len = sizeof(uu);
-			break;
-		case UUIDD_OP_BULK_TIME_UUID:
-			if (__uuid_generate_time(uu, &num) < 0 && !uuidd_cxt->quiet)
-				warnx(_("failed to open/lock clock counter"));
-			if (uuidd_cxt->debug) {
-				uuid_unparse(uu, str);
-				fprintf(stderr, P_("Generated time UUID %s "
-						   "and %d following\n",
-						   "Generated time UUID %s "
-						   "and %d following\n", num - 1),
-				       str, num - 1);
-			}
-			memcpy(reply_buf, uu, sizeof(uu));
-			reply_len = sizeof(uu);
-			memcpy(reply_buf + reply_len, &num, sizeof(num));
-			reply_len += sizeof(num);
-			break;
-		case UUIDD_OP_BULK_RANDOM_UUID:
-			if (num < 0)
-				num = 1;
-			if ((sizeof(reply_buf) - sizeof(num)) < (size_t) (sizeof(uu) * num))
-				num = (sizeof(reply_buf) - sizeof(num)) / sizeof(uu);
-			__uuid_generate_random((unsigned char *) reply_buf +
-					      sizeof(num), &num);
-			reply_len = sizeof(num) + (sizeof(uu) * num);
-			memcpy(reply_buf, &num, sizeof(num));
-			if (uuidd_cxt->debug) {
-				fprintf(stderr, P_("Generated %d UUID:\n",
-						   "Generated %d UUIDs:\n", num), num);
-				cp = reply_buf + sizeof(num);
-				for (i = 0; i < num; i++) {
-					uuid_unparse((unsigned char *)cp, str);
-					fprintf(stderr, "\t%s\n", str);
-					cp += sizeof(uu);
-				}
-			}
-			break;
-		default:
-			if (uuidd_cxt->debug)
-				fprintf(stderr, _("Invalid operation %d\n"), op);
-			goto shutdown_socket;
+				conn_event(&srv, epfd, (struct uuidd_conn *) ptr);
 		}
-		write_all(ns, (char *) &reply_len, sizeof(num));
-		write_all(ns, reply_buf, reply_len);
-	shutdown_socket:
-		close(ns);
+
+		expire_connections(&srv);
+		accept_enable(&srv, epfd, &s);
 	}
 }
 
@@ -570,6 +1355,10 @@ static void __attribute__ ((__noreturn__)) unexpected_size(int size)
 static void parse_options(int argc, char **argv, struct uuidd_cxt_t *uuidd_cxt,
 			  struct uuidd_options_t *uuidd_opts)
 {
+	enum {
+		OPT_STATS = CHAR_MAX + 1,
+		OPT_RING
+	};
 	const struct option longopts[] = {
 		{"pid", required_argument, NULL, 'p'},
 		{"socket", required_argument, NULL, 's'},
@@ -577,7 +1366,11 @@ static void parse_options(int argc, char **argv, struct uuidd_cxt_t *uuidd_cxt,
 		{"kill", no_argument, NULL, 'k'},
 		{"random", no_argument, NULL, 'r'},
 		{"time", no_argument, NULL, 't'},
+		{"time-v6", no_argument, NULL, '6'},
+		{"time-v7", no_argument, NULL, '7'},
 		{"uuids", required_argument, NULL, 'n'},
+		{"stats", no_argument, NULL, OPT_STATS},
+		{"ring", optional_argument, NULL, OPT_RING},
 		{"no-pid", no_argument, NULL, 'P'},
 		{"no-fork", no_argument, NULL, 'F'},
 		{"socket-activation", no_argument, NULL, 'S'},
@@ -588,15 +1381,15 @@ static void parse_options(int argc, char **argv, struct uuidd_cxt_t *uuidd_cxt,
 		{NULL, 0, NULL, 0}
 	};
 	const ul_excl_t excl[] = {
+		{ '6', '7', 'r', 't', OPT_STATS },
 		{ 'P', 'p' },
 		{ 'd', 'q' },
-		{ 'r', 't' },
 		{ 0 }
 	};
 	int excl_st[ARRAY_SIZE(excl)] = UL_EXCL_STATUS_INIT;
 	int c;
 
-	while ((c = getopt_long(argc, argv, "p:s:T:krtn:PFSdqVh", longopts, NULL)) != -1) {
+	while ((c = getopt_long(argc, argv, "p:s:T:krt67n:PFSdqVh", longopts, NULL)) != -1) {
 		err_exclusive_options(c, longopts, excl, excl_st);
 		switch (c) {
 		case 'd':
@@ -634,6 +1427,12 @@ static void parse_options(int argc, char **argv, struct uuidd_cxt_t *uuidd_cxt,
 		case 'r':
 			uuidd_opts->do_type = UUIDD_OP_RANDOM_UUID;
 			break;
+		case '6':
+			uuidd_opts->do_type = UUIDD_OP_TIME_V6_UUID;
+			break;
+		case '7':
+			uuidd_opts->do_type = UUIDD_OP_TIME_V7_UUID;
+			break;
 		case 's':
 			uuidd_opts->socket_path = optarg;
 			uuidd_opts->s_flag = 1;
@@ -645,6 +1444,12 @@ static void parse_options(int argc, char **argv, struct uuidd_cxt_t *uuidd_cxt,
 			uuidd_cxt->timeout = strtou32_or_err(optarg,
 						_("failed to parse --timeout"));
 			break;
+		case OPT_STATS:
+			uuidd_opts->do_type = UUIDD_OP_GET_STATS;
+			break;
+		case OPT_RING:
+			uuidd_opts->ring_path = optarg ? optarg : UUIDD_RING_PATH;
+			break;
 
 		case 'V':
 			print_version(EXIT_SUCCESS);
@@ -663,6 +1468,12 @@ static void parse_options(int argc, char **argv, struct uuidd_cxt_t *uuidd_cxt,
 		case UUIDD_OP_TIME_UUID:
 			uuidd_opts->do_type = UUIDD_OP_BULK_TIME_UUID;
 			break;
+		case UUIDD_OP_TIME_V6_UUID:
+			uuidd_opts->do_type = UUIDD_OP_BULK_TIME_V6_UUID;
+			break;
+		case UUIDD_OP_TIME_V7_UUID:
+			uuidd_opts->do_type = UUIDD_OP_BULK_TIME_V7_UUID;
+			break;
 		}
 	}
 }
@@ -694,6 +1505,21 @@ int main(int argc, char **argv)
 		warnx(_("Both --socket-activation and --socket specified. "
 			"Ignoring --socket."));
 
+	if (uuidd_opts.do_type == UUIDD_OP_GET_STATS) {
+		char buf[UUIDD_PROT_BUFSZ];
+
+		ret = call_daemon(uuidd_opts.socket_path, uuidd_opts.do_type, buf,
+				  sizeof(buf), 0, &err_context);
+		if (ret < 0)
+			err(EXIT_FAILURE, _("error calling uuidd daemon (%s)"),
+					err_context ? : _("unexpected error"));
+		if (ret == 0 || buf[ret - 1] != '\0')
+			unexpected_size(ret);
+
+		fputs(buf, stdout);
+		return EXIT_SUCCESS;
+	}
+
 	if (uuidd_opts.num && uuidd_opts.do_type) {
 		char buf[UUIDD_PROT_BUFSZ];
 		char str[UUID_STR_LEN];
@@ -769,6 +1595,7 @@ int main(int argc, char **argv)
 		return EXIT_SUCCESS;
 	}
 
-	server_loop(uuidd_opts.socket_path, uuidd_opts.pidfile_path, &uuidd_cxt);
+	server_loop(uuidd_opts.socket_path, uuidd_opts.pidfile_path,
+		    uuidd_opts.ring_path, &uuidd_cxt);
 	return EXIT_SUCCESS;
 }
@@ -17,6 +17,11 @@
 #include "nls.h"
 #include "c.h"
 #include "closestream.h"
+#include "strutils.h"
+#include "xalloc.h"
+
+/* max number of UUIDs generated by one bulk request */
+#define UUIDGEN_BULKSZ	(64 * 1024)
 
 static void __attribute__((__noreturn__)) usage(void)
 {
@@ -31,12 +36,15 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(USAGE_OPTIONS, out);
 	fputs(_(" -r, --random        generate random-based uuid\n"), out);
 	fputs(_(" -t, --time          generate time-based uuid\n"), out);
+	fputs(_(" -6, --time-v6       generate time-ordered uuid, version 6\n"), out);
+	fputs(_(" -7, --time-v7       generate time-ordered uuid, version 7\n"), out);
 	fputs(_(" -n, --namespace ns  generate hash-based uuid in this namespace\n"), out);
 	printf(_("                       available namespaces: %s\n"), "@dns @url @oid @x500");
 	fputs(_(" -N, --name name     generate hash-based uuid from this name\n"), out);
 	fputs(_(" -m, --md5           generate md5 hash\n"), out);
 	fputs(_(" -s, --sha1          generate sha1 hash\n"), out);
 	fputs(_(" -x, --hex           interpret name as hex string\n"), out);
+	fputs(_(" -C, --count <num>   generate more uuids\n"), out);
 	fputs(USAGE_SEPARATOR, out);
 	printf(USAGE_HELP_OPTIONS(21));
 	printf(USAGE_MAN_TAIL("uuidgen(1)"));
@@ -79,6 +87,48 @@ badstring:
 	return value2;
 }
 
+/* generates and prints @count random or time based UUIDs */
+static void print_bulk(int type, size_t count)
+{
+	char str[UUID_STR_LEN];
+	uuid_t *uus;
+	size_t sz = min(count, (size_t) UUIDGEN_BULKSZ);
+
+	uus = xmalloc(sz * sizeof(uuid_t));
+
+	while (count > 0) {
+		size_t i, n = min(count, sz);
+
+		switch (type) {
+		case UUID_TYPE_DCE_TIME:
+			uuid_generate_time_bulk(uus, n);
+			break;
+		case UUID_TYPE_DCE_RANDOM:
+			uuid_generate_random_bulk(uus, n);
+			break;
+		case UUID_TYPE_DCE_TIME_V6:
+			uuid_generate_time_v6_bulk(uus, n);
+			break;
+		case UUID_TYPE_DCE_TIME_V7:
+			uuid_generate_time_v7_bulk(uus, n);
+			break;
+		default:
+			/* the same as uuid_generate() */
+			if (uuid_generate_random_bulk(uus, n) != 0)
+				uuid_generate_time_bulk(uus, n);
+			break;
+		}
+
+		for (i = 0; i < n; i++) {
+			uuid_unparse(uus[i], str);
+			fputs(str, stdout);
+			fputc('\n', stdout);
+		}
+		count -= n;
+	}
+	free(uus);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -86,12 +136,14 @@ main (int argc, char *argv[])
 	int    do_type = 0, is_hex = 0;
 	char   str[UUID_STR_LEN];
 	char   *namespace = NULL, *name = NULL;
-	size_t namelen = 0;
+	size_t namelen = 0, count = 1;
 	uuid_t ns, uu;
 
 	static const struct option longopts[] = {
 		{"random", no_argument, NULL, 'r'},
 		{"time", no_argument, NULL, 't'},
+		{"time-v6", no_argument, NULL, '6'},
+		{"time-v7", no_argument, NULL, '7'},
 		{"version", no_argument, NULL, 'V'},
 		{"help", no_argument, NULL, 'h'},
 		{"namespace", required_argument, NULL, 'n'},
@@ -99,6 +151,7 @@ main (int argc, char *argv[])
 		{"md5", no_argument, NULL, 'm'},
 		{"sha1", no_argument, NULL, 's'},
 		{"hex", no_argument, NULL, 'x'},
+		{"count", required_argument, NULL, 'C'},
 		{NULL, 0, NULL, 0}
 	};
 
@@ -107,7 +160,7 @@ main (int argc, char *argv[])
 	textdomain(PACKAGE);
 	close_stdout_atexit();
 
-	while ((c = getopt_long(argc, argv, "rtVhn:N:msx", longopts, NULL)) != -1)
+	while ((c = getopt_long(argc, argv, "C:rt67Vhn:N:msx", longopts, NULL)) != -1)
 		switch (c) {
 		case 't':
 			do_type = UUID_TYPE_DCE_TIME;
@@ -115,6 +168,12 @@ main (int argc, char *argv[])
 		case 'r':
 			do_type = UUID_TYPE_DCE_RANDOM;
 			break;
+		case '6':
+			do_type = UUID_TYPE_DCE_TIME_V6;
+			break;
+		case '7':
+			do_type = UUID_TYPE_DCE_TIME_V7;
+			break;
 		case 'n':
 			namespace = optarg;
 			break;
@@ -130,6 +189,9 @@ main (int argc, char *argv[])
 		case 'x':
 			is_hex = 1;
 			break;
+		case 'C':
+			count = strtosize_or_err(optarg, _("failed to parse count"));
+			break;
 
 		case 'h':
 			usage();
@@ -165,6 +227,12 @@ main (int argc, char *argv[])
 			name = unhex(name, &namelen);
 	}
 
+	if (count != 1 && do_type != UUID_TYPE_DCE_MD5
+	    && do_type != UUID_TYPE_DCE_SHA1) {
+		print_bulk(do_type, count);
+		return EXIT_SUCCESS;
+	}
+
 	switch (do_type) {
 	case UUID_TYPE_DCE_TIME:
 		uuid_generate_time(uu);
@@ -172,6 +240,12 @@ main (int argc, char *argv[])
 	case UUID_TYPE_DCE_RANDOM:
 		uuid_generate_random(uu);
 		break;
+	case UUID_TYPE_DCE_TIME_V6:
+		uuid_generate_time_v6(uu);
+		break;
+	case UUID_TYPE_DCE_TIME_V7:
+		uuid_generate_time_v7(uu);
+		break;
 	case UUID_TYPE_DCE_MD5:
 	case UUID_TYPE_DCE_SHA1:
 		if (namespace[0] == '@' && namespace[1] != '\0') {
@@ -201,7 +275,9 @@ main (int argc, char *argv[])
 
 	uuid_unparse(uu, str);
 
-	printf("%s\n", str);
+	/* hash-based UUIDs are predictable, all are the same */
+	while (count-- > 0)
+		printf("%s\n", str);
 
 	if (is_hex)
 		free(name);
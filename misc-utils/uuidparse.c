@@ -86,9 +86,13 @@ struct control {
 	unsigned int
 		json:1,
 		no_headings:1,
-		raw:1;
+		raw:1,
+		stream:1;
 };
 
+/* size of the buffer for standard input */
+#define UUIDPARSE_BUFSZ		(64 * 1024)
+
 static void __attribute__((__noreturn__)) usage(void)
 {
 	size_t i;
@@ -101,6 +105,7 @@ static void __attribute__((__noreturn__)) usage(void)
 	puts(_(" -n, --noheadings       don't print headings"));
 	puts(_(" -o, --output <list>    COLUMNS to display (see below)"));
 	puts(_(" -r, --raw              use the raw output format"));
+	puts(_("     --stream           print UUIDs while reading the input"));
 	printf(USAGE_HELP_OPTIONS(24));
 
 	fputs(USAGE_COLUMNS, stdout);
@@ -138,7 +143,8 @@ static const struct colinfo *get_column_info(int num)
 	return &infos[get_column_id(num)];
 }
 
-static void fill_table_row(struct libscols_table *tb, char const *const uuid)
+static void fill_table_row(struct libscols_table *tb, char const *const uuid,
+			   size_t len)
 {
 	static struct libscols_line *ln;
 	size_t i;
@@ -153,7 +159,7 @@ static void fill_table_row(struct libscols_table *tb, char const *const uuid)
 	if (!ln)
 		errx(EXIT_FAILURE, _("failed to allocate output line"));
 
-	if (uuid_parse(uuid, buf))
+	if (uuid_parse_range(uuid, uuid + len, buf))
 		invalid = 1;
 	else {
 		variant = uuid_variant(buf);
@@ -165,7 +171,7 @@ static void fill_table_row(struct libscols_table *tb, char const *const uuid)
 
 		switch (get_column_id(i)) {
 		case COL_UUID:
-			str = xstrdup(uuid);
+			str = xstrndup(uuid, len);
 			break;
 		case COL_VARIANT:
 			if (invalid) {
@@ -213,6 +219,12 @@ static void fill_table_row(struct libscols_table *tb, char const *const uuid)
 			case UUID_TYPE_DCE_SHA1:
 				str = xstrdup(_("sha1-based"));
 				break;
+			case UUID_TYPE_DCE_TIME_V6:
+				str = xstrdup(_("time-v6"));
+				break;
+			case UUID_TYPE_DCE_TIME_V7:
+				str = xstrdup(_("time-v7"));
+				break;
 			default:
 				str = xstrdup(_("unknown"));
 			}
@@ -222,7 +234,10 @@ static void fill_table_row(struct libscols_table *tb, char const *const uuid)
 				str = xstrdup(_("invalid"));
 				break;
 			}
-			if (variant == UUID_VARIANT_DCE && type == UUID_TYPE_DCE_TIME) {
+			if (variant == UUID_VARIANT_DCE
+			    && (type == UUID_TYPE_DCE_TIME
+				|| type == UUID_TYPE_DCE_TIME_V6
+				|| type == UUID_TYPE_DCE_TIME_V7)) {
 				struct timeval tv;
 				char date_buf[ISO_BUFSIZ];
 
@@ -240,6 +255,70 @@ static void fill_table_row(struct libscols_table *tb, char const *const uuid)
 	}
 }
 
+static inline int is_uuid_sep(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n'
+	       || c == '\r' || c == '\v' || c == '\f';
+}
+
+/*
+ * Reads whitespace separated UUIDs from @f by large blocks and adds them to
+ * the table without copying to another buffer.
+ */
+static void read_input(struct libscols_table *tb, FILE *f)
+{
+	char *buf = xmalloc(UUIDPARSE_BUFSZ);
+	size_t len = 0;
+	int eof = 0, skip = 0;
+
+	while (!eof) {
+		size_t rd = fread(buf + len, 1, UUIDPARSE_BUFSZ - len, f);
+		char *p = buf, *end;
+
+		if (rd < UUIDPARSE_BUFSZ - len) {
+			if (ferror(f))
+				err(EXIT_FAILURE, _("read failed"));
+			eof = 1;
+		}
+		end = buf + len + rd;
+
+		/* the rest of a token longer than the buffer */
+		if (skip) {
+			while (p < end && !is_uuid_sep(*p))
+				p++;
+			if (p < end)
+				skip = 0;
+		}
+
+		while (p < end) {
+			char *tok;
+
+			while (p < end && is_uuid_sep(*p))
+				p++;
+			tok = p;
+			while (p < end && !is_uuid_sep(*p))
+				p++;
+			if (tok == p)
+				break;
+			if (p == end && !eof) {
+				if (tok > buf) {
+					/* incomplete, read the rest */
+					p = tok;
+					break;
+				}
+				/* longer than the buffer, one invalid entry */
+				skip = 1;
+			}
+			fill_table_row(tb, tok, p - tok);
+		}
+
+		len = end - p;
+		if (len)
+			memmove(buf, p, len);
+	}
+	free(buf);
+}
+
 static void print_output(struct control const *const ctrl, int argc,
 			 char **argv)
 {
@@ -257,6 +336,9 @@ static void print_output(struct control const *const ctrl, int argc,
 	}
 	scols_table_enable_noheadings(tb, ctrl->no_headings);
 	scols_table_enable_raw(tb, ctrl->raw);
+	scols_table_enable_streaming(tb, ctrl->stream);
+	/* the lines are printed in a loop, one write(2) per line is expensive */
+	scols_table_enable_stream_buffering(tb, ctrl->stream);
 
 	for (i = 0; i < ncolumns; i++) {
 		const struct colinfo *col = get_column_info(i);
@@ -268,14 +350,10 @@ static void print_output(struct control const *const ctrl, int argc,
 	}
 
 	for (i = 0; i < (size_t) argc; i++)
-		fill_table_row(tb, argv[i]);
-
-	if (i == 0) {
-		char uuid[UUID_STR_LEN];
+		fill_table_row(tb, argv[i], strlen(argv[i]));
 
-		while (scanf(" %36[^ \t\n]%*c", uuid) && !feof(stdin))
-			fill_table_row(tb, uuid);
-	}
+	if (i == 0)
+		read_input(tb, stdin);
 	scols_print_table(tb);
 	scols_unref_table(tb);
 }
@@ -286,11 +364,15 @@ int main(int argc, char **argv)
 	char *outarg = NULL;
 	int c;
 
+	enum {
+		OPT_STREAM = CHAR_MAX + 1
+	};
 	static const struct option longopts[] = {
 		{"json",       no_argument,       NULL, 'J'},
 		{"noheadings", no_argument,       NULL, 'n'},
 		{"output",     required_argument, NULL, 'o'},
 		{"raw",        no_argument,       NULL, 'r'},
+		{"stream",     no_argument,       NULL, OPT_STREAM},
 		{"version",    no_argument,       NULL, 'V'},
 		{"help",       no_argument,       NULL, 'h'},
 		{NULL, 0, NULL, 0}
@@ -321,6 +403,9 @@ int main(int argc, char **argv)
 		case 'r':
 			ctrl.raw = 1;
 			break;
+		case OPT_STREAM:
+			ctrl.stream = 1;
+			break;
 
 		case 'V':
 			print_version(EXIT_SUCCESS);
@@ -36,6 +36,7 @@
 #include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/vfs.h>
+#include <sys/wait.h>
 #include <linux/fs.h>
 
 #include "nls.h"
@@ -47,6 +48,9 @@
 #include "sysfs.h"
 #include "optutils.h"
 #include "statfs_magic.h"
+#include "all-io.h"
+#include "jsonwrt.h"
+#include "monotonic.h"
 
 #include <libmount.h>
 
@@ -65,7 +69,29 @@ struct fstrim_control {
 
 	unsigned int verbose : 1,
 		     quiet_unsupp : 1,
-		     dryrun : 1;
+		     dryrun : 1,
+		     json : 1,
+		     parallel : 1;
+};
+
+struct fstrim_entry {
+	const char	*path;		/* mountpoint */
+	const char	*devname;	/* source device or NULL */
+	dev_t		disk;		/* whole-disk device */
+
+	int		rc;		/* fstrim_filesystem() return code */
+	uint64_t	trimmed;	/* number of discarded bytes */
+	uint64_t	usec;		/* time spent by FITRIM */
+
+	unsigned int	done : 1;
+};
+
+/* result sent from child to parent in --parallel mode */
+struct fstrim_result {
+	size_t		idx;		/* index in entries array */
+	int		rc;
+	uint64_t	trimmed;
+	uint64_t	usec;
 };
 
 static int is_directory(const char *path, int silent)
@@ -86,12 +112,14 @@ static int is_directory(const char *path, int silent)
 }
 
 /* returns: 0 = success, 1 = unsupported, < 0 = error */
-static int fstrim_filesystem(struct fstrim_control *ctl, const char *path, const char *devname)
+static int fstrim_filesystem(struct fstrim_control *ctl, const char *path, uint64_t *trimmed)
 {
 	int fd = -1, rc;
 	struct fstrim_range range;
 	char *rpath = realpath(path, NULL);
 
+	*trimmed = 0;
+
 	if (!rpath) {
 		warn(_("cannot get realpath: %s"), path);
 		rc = -errno;
@@ -108,10 +136,6 @@ static int fstrim_filesystem(struct fstrim_control *ctl, const char *path, const
 	}
 
 	if (ctl->dryrun) {
-		if (devname)
-			printf(_("%s: 0 B (dry run) trimmed on %s\n"), path, devname);
-		else
-			printf(_("%s: 0 B (dry run) trimmed\n"), path);
 		rc = 0;
 		goto done;
 	}
@@ -133,31 +157,180 @@ static int fstrim_filesystem(struct fstrim_control *ctl, const char *path, const
 		goto done;
 	}
 
-	if (ctl->verbose) {
+	*trimmed = range.len;
+	rc = 0;
+done:
+	if (fd >= 0)
+		close(fd);
+	free(rpath);
+	return rc;
+}
+
+static void fstrim_entry_run(struct fstrim_control *ctl, struct fstrim_entry *ent)
+{
+	struct timeval start, end, diff;
+
+	gettime_monotonic(&start);
+	ent->rc = fstrim_filesystem(ctl, ent->path, &ent->trimmed);
+	gettime_monotonic(&end);
+
+	timersub(&end, &start, &diff);
+	ent->usec = (uint64_t) diff.tv_sec * 1000000 + diff.tv_usec;
+	ent->done = 1;
+}
+
+static void fstrim_entry_report(struct fstrim_control *ctl, struct fstrim_entry *ent)
+{
+	if (ent->rc == 1 && !ctl->quiet_unsupp)
+		warnx(_("%s: the discard operation is not supported"), ent->path);
+	if (ent->rc != 0 || ctl->json)
+		return;
+
+	if (ctl->dryrun) {
+		if (ent->devname)
+			printf(_("%s: 0 B (dry run) trimmed on %s\n"), ent->path, ent->devname);
+		else
+			printf(_("%s: 0 B (dry run) trimmed\n"), ent->path);
+
+	} else if (ctl->verbose) {
 		char *str = size_to_human_string(
 				SIZE_SUFFIX_3LETTER | SIZE_SUFFIX_SPACE,
-				(uint64_t) range.len);
-		if (devname)
+				ent->trimmed);
+		if (ent->devname)
 			/* TRANSLATORS: The standard value here is a very large number. */
 			printf(_("%s: %s (%" PRIu64 " bytes) trimmed on %s\n"),
-				path, str, (uint64_t) range.len, devname);
+				ent->path, str, ent->trimmed, ent->devname);
 		else
 			/* TRANSLATORS: The standard value here is a very large number. */
 			printf(_("%s: %s (%" PRIu64 " bytes) trimmed\n"),
-				path, str, (uint64_t) range.len);
+				ent->path, str, ent->trimmed);
 
 		free(str);
 	}
+	/* in --parallel mode the lines are printed as the filesystems are done */
+	fflush(stdout);
+}
 
-	rc = 0;
-done:
-	if (fd >= 0)
-		close(fd);
-	free(rpath);
-	return rc;
+static void fstrim_json(struct fstrim_entry *ents, size_t nents)
+{
+	struct ul_jsonwrt json;
+	uint64_t total = 0;
+	size_t i;
+
+	ul_jsonwrt_init(&json, stdout, 0);
+	ul_jsonwrt_root_open(&json);
+	ul_jsonwrt_array_open(&json, "filesystems");
+
+	for (i = 0; i < nents; i++) {
+		struct fstrim_entry *ent = &ents[i];
+		char tm[64];
+
+		ul_jsonwrt_object_open(&json, NULL);
+		ul_jsonwrt_value_s(&json, "target", ent->path);
+		ul_jsonwrt_value_s(&json, "source", ent->devname);
+		ul_jsonwrt_value_s(&json, "status",
+				ent->rc == 0 ? "ok" :
+				ent->rc == 1 ? "unsupported" : "failed");
+		ul_jsonwrt_value_u64(&json, "trimmed", ent->trimmed);
+		snprintf(tm, sizeof(tm), "%" PRIu64 ".%06" PRIu64,
+				ent->usec / 1000000, ent->usec % 1000000);
+		ul_jsonwrt_value_raw(&json, "time", tm);
+		ul_jsonwrt_object_close(&json);
+
+		total += ent->trimmed;
+	}
+
+	ul_jsonwrt_array_close(&json);
+
+	ul_jsonwrt_object_open(&json, "total");
+	ul_jsonwrt_value_u64(&json, "trimmed", total);
+	ul_jsonwrt_object_close(&json);
+
+	ul_jsonwrt_root_close(&json);
 }
 
-static int has_discard(const char *devname, struct path_cxt **wholedisk)
+/*
+ * Trims filesystems on different whole-disk devices in parallel, one child
+ * process per disk. The filesystems on the same disk are trimmed one by one,
+ * FITRIM on the same device concurrently does not make things faster. The
+ * children send the results back to the parent by pipe.
+ */
+static void fstrim_entries_parallel(struct fstrim_control *ctl,
+				    struct fstrim_entry *ents, size_t nents)
+{
+	struct fstrim_result res;
+	size_t i, j, nchildren = 0;
+	int pfd[2];
+
+	if (pipe(pfd) != 0) {
+		warn(_("cannot create pipe"));
+		return;		/* fallback to sequential mode */
+	}
+
+	fflush(stdout);
+
+	for (i = 0; i < nents; i++) {
+		pid_t pid;
+
+		/* the first filesystem on the disk starts the job */
+		for (j = 0; j < i; j++) {
+			if (ents[j].disk == ents[i].disk)
+				break;
+		}
+		if (j < i)
+			continue;
+
+		pid = fork();
+		if (pid < 0) {
+			warn(_("fork failed"));
+			break;
+		}
+		if (pid == 0) {
+			close(pfd[0]);
+			for (j = i; j < nents; j++) {
+				if (ents[j].disk != ents[i].disk)
+					continue;
+				fstrim_entry_run(ctl, &ents[j]);
+
+				res.idx = j;
+				res.rc = ents[j].rc;
+				res.trimmed = ents[j].trimmed;
+				res.usec = ents[j].usec;
+				if (write_all(pfd[1], &res, sizeof(res)) != 0)
+					_exit(EXIT_FAILURE);
+			}
+			_exit(EXIT_SUCCESS);
+		}
+		nchildren++;
+	}
+	close(pfd[1]);
+
+	while (read_all(pfd[0], (char *) &res, sizeof(res)) == sizeof(res)) {
+		struct fstrim_entry *ent;
+
+		if (res.idx >= nents)
+			continue;
+		ent = &ents[res.idx];
+		ent->rc = res.rc;
+		ent->trimmed = res.trimmed;
+		ent->usec = res.usec;
+		ent->done = 1;
+
+		fstrim_entry_report(ctl, ent);
+	}
+	close(pfd[0]);
+
+	while (nchildren) {
+		if (wait(NULL) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		nchildren--;
+	}
+}
+
+static int has_discard(const char *devname, struct path_cxt **wholedisk, dev_t *diskno)
 {
 	struct path_cxt *pc = NULL;
 	uint64_t dg = 0;
@@ -181,6 +354,7 @@ static int has_discard(const char *devname, struct path_cxt **wholedisk)
 	rc = sysfs_blkdev_get_wholedisk(pc, NULL, 0, &disk);
 	if (rc != 0 || !disk)
 		goto fail;
+	*diskno = disk;
 
 	if (dev != disk) {
 		/* Partition, try reuse whole-disk context if valid for the
@@ -279,6 +453,8 @@ static int fstrim_all_from_file(struct fstrim_control *ctl, const char *filename
 	struct libmnt_table *tab;
 	struct libmnt_cache *cache = NULL;
 	struct path_cxt *wholedisk = NULL;
+	struct fstrim_entry *ents;
+	size_t i, nents = 0;
 	int cnt = 0, cnt_err = 0;
 	int fstab = 0;
 
@@ -325,11 +501,15 @@ static int fstrim_all_from_file(struct fstrim_control *ctl, const char *filename
 	if (!itr)
 		err(MNT_EX_FAIL, _("failed to initialize libmount iterator"));
 
+	ents = xcalloc(mnt_table_get_nents(tab) ? : 1, sizeof(struct fstrim_entry));
+
 	/* Remove useless entries and canonicalize the table */
 	while (mnt_table_next_fs(tab, itr, &fs) == 0) {
 		const char *src = mnt_fs_get_srcpath(fs),
 			   *tgt = mnt_fs_get_target(fs);
 		char *path;
+		struct fstrim_entry *ent;
+		dev_t disk = 0;
 		int rc = 1;
 
 		if (!tgt || is_unwanted_fs(fs, tgt)) {
@@ -366,10 +546,13 @@ static int fstrim_all_from_file(struct fstrim_control *ctl, const char *filename
 		}
 
 		if (!is_directory(tgt, 1) ||
-		    !has_discard(src, &wholedisk)) {
+		    !has_discard(src, &wholedisk, &disk)) {
 			mnt_table_remove_fs(tab, fs);
 			continue;
 		}
+		ent = &ents[nents++];
+		ent->disk = disk;
+		mnt_fs_set_userdata(fs, ent);
 	}
 
 	/* de-duplicate by source */
@@ -377,29 +560,48 @@ static int fstrim_all_from_file(struct fstrim_control *ctl, const char *filename
 
 	mnt_reset_iter(itr, MNT_ITER_BACKWARD);
 
-	/* Do FITRIM */
+	/* The same order as above, so the entry of the filesystem is never
+	 * before the slot in the array and it's possible to compact in-place. */
+	nents = 0;
 	while (mnt_table_next_fs(tab, itr, &fs) == 0) {
-		const char *src = mnt_fs_get_srcpath(fs),
-			   *tgt = mnt_fs_get_target(fs);
-		int rc;
+		struct fstrim_entry *ent = &ents[nents++];
 
-		cnt++;
+		*ent = *((struct fstrim_entry *) mnt_fs_get_userdata(fs));
+		ent->path = mnt_fs_get_target(fs);
+		ent->devname = mnt_fs_get_srcpath(fs);
+	}
+	mnt_free_iter(itr);
 
-		/*
-		 * We're able to detect that the device supports discard, but
-		 * things also depend on filesystem or device mapping, for
-		 * example LUKS (by default) does not support FSTRIM.
-		 *
-		 * This is reason why we ignore EOPNOTSUPP and ENOTTY errors
-		 * from discard ioctl.
-		 */
-		rc = fstrim_filesystem(ctl, tgt, src);
-		if (rc < 0)
+	/*
+	 * Do FITRIM
+	 *
+	 * We're able to detect that the device supports discard, but
+	 * things also depend on filesystem or device mapping, for
+	 * example LUKS (by default) does not support FSTRIM.
+	 *
+	 * This is reason why we ignore EOPNOTSUPP and ENOTTY errors
+	 * from discard ioctl.
+	 */
+	if (ctl->parallel && nents > 1)
+		fstrim_entries_parallel(ctl, ents, nents);
+
+	for (i = 0; i < nents; i++) {
+		struct fstrim_entry *ent = &ents[i];
+
+		/* sequential mode, or the job has not been finished by child */
+		if (!ent->done) {
+			fstrim_entry_run(ctl, ent);
+			fstrim_entry_report(ctl, ent);
+		}
+
+		cnt++;
+		if (ent->rc < 0)
 		       cnt_err++;
-		else if (rc == 1 && !ctl->quiet_unsupp)
-			warnx(_("%s: the discard operation is not supported"), tgt);
 	}
-	mnt_free_iter(itr);
+
+	if (ctl->json)
+		fstrim_json(ents, nents);
+	free(ents);
 
 	ul_unref_path(wholedisk);
 	mnt_unref_table(tab);
@@ -463,6 +665,8 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_(" -v, --verbose            print number of discarded bytes\n"), out);
 	fputs(_("     --quiet-unsupported  suppress error messages if trim unsupported\n"), out);
 	fputs(_(" -n, --dry-run            does everything, but trim\n"), out);
+	fputs(_(" -J, --json               use JSON output format\n"), out);
+	fputs(_(" -p, --parallel           trim filesystems on different disks in parallel\n"), out);
 
 	fputs(USAGE_SEPARATOR, out);
 	printf(USAGE_HELP_OPTIONS(21));
@@ -482,6 +686,7 @@ int main(int argc, char **argv)
 	struct fstrim_control ctl = {
 			.range = { .len = ULLONG_MAX }
 	};
+	struct fstrim_entry ent = { .path = NULL };
 	enum {
 		OPT_QUIET_UNSUPP = CHAR_MAX + 1
 	};
@@ -498,6 +703,8 @@ int main(int argc, char **argv)
 	    { "verbose",   no_argument,       NULL, 'v' },
 	    { "quiet-unsupported", no_argument,       NULL, OPT_QUIET_UNSUPP },
 	    { "dry-run",   no_argument,       NULL, 'n' },
+	    { "json",      no_argument,       NULL, 'J' },
+	    { "parallel",  no_argument,       NULL, 'p' },
 	    { NULL, 0, NULL, 0 }
 	};
 
@@ -512,7 +719,7 @@ int main(int argc, char **argv)
 	textdomain(PACKAGE);
 	close_stdout_atexit();
 
-	while ((c = getopt_long(argc, argv, "AahI:l:m:no:Vv", longopts, NULL)) != -1) {
+	while ((c = getopt_long(argc, argv, "AahI:Jl:m:no:pVv", longopts, NULL)) != -1) {
 
 		err_exclusive_options(c, longopts, excl, excl_st);
 
@@ -532,6 +739,12 @@ int main(int argc, char **argv)
 		case 'n':
 			ctl.dryrun = 1;
 			break;
+		case 'J':
+			ctl.json = 1;
+			break;
+		case 'p':
+			ctl.parallel = 1;
+			break;
 		case 'l':
 			ctl.range.len = strtosize_or_err(optarg,
 					_("failed to parse length"));
@@ -570,17 +783,24 @@ int main(int argc, char **argv)
 		errtryhelp(EXIT_FAILURE);
 	}
 
+	if (ctl.parallel && !all)
+		errx(EXIT_FAILURE, _("--parallel requires --all, --fstab or --listed-in"));
+
 	if (all)
 		return fstrim_all(&ctl, tabs);	/* MNT_EX_* codes */
 
 	if (!is_directory(path, 0))
 		return EXIT_FAILURE;
 
-	rc = fstrim_filesystem(&ctl, path, NULL);
+	ent.path = path;
+	fstrim_entry_run(&ctl, &ent);
+	fstrim_entry_report(&ctl, &ent);
+	if (ctl.json)
+		fstrim_json(&ent, 1);
+
+	rc = ent.rc;
 	if (rc == 1 && ctl.quiet_unsupp)
 		rc = 0;
-	if (rc == 1)
-		warnx(_("%s: the discard operation is not supported"), path);
 
 	return rc == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,248 @@
+/*
+ * Reference CBOR (RFC 8949) decoder for libsmartcols CBOR output. It reads
+ * CBOR data from standard input (or file) and prints them in the
+ * diagnostic notation, one map or array item per line.
+ *
+ * This file may be redistributed under the terms of the GNU Public
+ * License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+static FILE *in;
+
+static void __attribute__((__noreturn__)) fail(const char *msg)
+{
+	fprintf(stderr, "cbordump: %s (offset %ld)\n", msg, ftell(in));
+	exit(EXIT_FAILURE);
+}
+
+static int get_byte(void)
+{
+	int c = fgetc(in);
+
+	if (c == EOF)
+		fail("unexpected end of data");
+	return c;
+}
+
+static uint64_t get_uint(size_t n)
+{
+	uint64_t x = 0;
+
+	while (n--)
+		x = (x << 8) | get_byte();
+	return x;
+}
+
+static void indent(int level)
+{
+	int i;
+
+	for (i = 0; i < level; i++)
+		fputs("  ", stdout);
+}
+
+static double half_to_double(uint16_t h)
+{
+	int e = (h >> 10) & 0x1f, m = h & 0x3ff;
+	double d;
+
+	if (e == 31)
+		d = m == 0 ? INFINITY : NAN;
+	else {
+		/* (m + 1024) * 2^(e - 25) or m * 2^-24 for subnormals */
+		d = e ? m + 1024 : m;
+		for (e = e ? e : 1; e < 25; e++)
+			d /= 2;
+		for (; e > 25; e--)
+			d *= 2;
+	}
+	return h & 0x8000 ? -d : d;
+}
+
+static void print_double(double d)
+{
+	char buf[64];
+
+	if (isnan(d)) {
+		fputs("NaN", stdout);
+		return;
+	}
+	if (isinf(d)) {
+		fputs(d < 0 ? "-Infinity" : "Infinity", stdout);
+		return;
+	}
+	snprintf(buf, sizeof(buf), "%.15g", d);
+	fputs(buf, stdout);
+	if (!strpbrk(buf, ".e"))
+		fputs(".0", stdout);
+}
+
+static void print_text(uint64_t len)
+{
+	putchar('"');
+	while (len--) {
+		int c = get_byte();
+
+		if (c == '"' || c == '\\')
+			printf("\\%c", c);
+		else if (c < 0x20)
+			printf("\\u%04x", c);
+		else
+			putchar(c);
+	}
+	putchar('"');
+}
+
+/* returns 1 for the "break" stop code */
+static int print_item(int level)
+{
+	int ib = get_byte();
+	int major = ib >> 5, info = ib & 0x1f;
+	uint64_t arg = 0;
+	int indef = 0;
+
+	if (info < 24)
+		arg = info;
+	else if (info <= 27)
+		arg = get_uint(1 << (info - 24));
+	else if (info == 31)
+		indef = 1;
+	else
+		fail("reserved additional information");
+
+	switch (major) {
+	case 0:
+		printf("%ju", (uintmax_t) arg);
+		break;
+	case 1:
+		if (arg > INT64_MAX)
+			printf("-1-%ju", (uintmax_t) arg);
+		else
+			printf("%jd", (intmax_t) (-1 - (int64_t) arg));
+		break;
+	case 2:
+	case 3:
+		if (indef) {
+			/* concatenated chunks */
+			printf("(_ ");
+			while (!print_item(level))
+				putchar(' ');
+			putchar(')');
+		} else if (major == 3)
+			print_text(arg);
+		else {
+			fputs("h'", stdout);
+			while (arg--)
+				printf("%02x", get_byte());
+			putchar('\'');
+		}
+		break;
+	case 4:
+	case 5:
+	{
+		uint64_t i;
+
+		putchar(major == 4 ? '[' : '{');
+		if (indef)
+			putchar('_');
+		for (i = 0; indef || i < arg; i++) {
+			if (indef) {
+				int c = get_byte();
+
+				if (c == 0xff)
+					break;
+				ungetc(c, in);
+			}
+			fputs(i ? ",\n" : "\n", stdout);
+			indent(level + 1);
+			if (print_item(level + 1))
+				fail("unexpected break");
+			if (major == 5) {
+				fputs(": ", stdout);
+				if (print_item(level + 1))
+					fail("unexpected break");
+			}
+		}
+		putchar('\n');
+		indent(level);
+		putchar(major == 4 ? ']' : '}');
+		break;
+	}
+	case 6:
+		printf("%ju(", (uintmax_t) arg);
+		if (print_item(level))
+			fail("unexpected break");
+		putchar(')');
+		break;
+	case 7:
+		if (indef)
+			return 1;	/* break */
+		switch (info) {
+		case 20:
+			fputs("false", stdout);
+			break;
+		case 21:
+			fputs("true", stdout);
+			break;
+		case 22:
+			fputs("null", stdout);
+			break;
+		case 23:
+			fputs("undefined", stdout);
+			break;
+		case 25:
+			print_double(half_to_double(arg));
+			break;
+		case 26:
+		{
+			uint32_t x = arg;
+			float f;
+
+			memcpy(&f, &x, sizeof(f));
+			print_double(f);
+			break;
+		}
+		case 27:
+		{
+			double d;
+
+			memcpy(&d, &arg, sizeof(d));
+			print_double(d);
+			break;
+		}
+		default:
+			printf("simple(%ju)", (uintmax_t) arg);
+			break;
+		}
+		break;
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int c;
+
+	in = argc > 1 ? fopen(argv[1], "r") : stdin;
+	if (!in) {
+		perror(argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	/* a sequence of the data items */
+	while ((c = fgetc(in)) != EOF) {
+		ungetc(c, in);
+		if (print_item(0))
+			fail("unexpected break");
+		putchar('\n');
+	}
+
+	if (in != stdin)
+		fclose(in);
+	return EXIT_SUCCESS;
+}
@@ -23,7 +23,7 @@
 
 int main(int argc, char **argv)
 {
-	int i = 1;
+	int i = 1, widths = 0;
 	char *(*encode_fn)(const char *, size_t *) = mbs_safe_encode;
 
 	setlocale(LC_ALL, "");
@@ -35,6 +35,9 @@ int main(int argc, char **argv)
 		} else if (!strcmp(argv[i], "--invalid")) {
 			i++;
 			encode_fn = mbs_invalid_encode;
+		} else if (!strcmp(argv[i], "--width")) {
+			i++;
+			widths = 1;
 		} else if (!strcmp(argv[i], "--")) {
 			i++;
 		}
@@ -43,6 +46,15 @@ int main(int argc, char **argv)
 	for (; i < argc; i++) {
 		size_t width;
 		char *res;
+
+		if (widths) {
+			size_t bytes;
+
+			width = mbs_safe_nwidth(argv[i], strlen(argv[i]), &bytes);
+			printf("%zu %zu/%zu %zu\n", mbs_width(argv[i]),
+					width, bytes, mbs_nwidth(argv[i], 5));
+			continue;
+		}
 		res = encode_fn(argv[i], &width);
 		printf("%zi %s\n", width, res);
 		free(res);
@@ -106,7 +106,13 @@ static size_t width(const wchar_t *str)
 
 	for (; *str != '\0'; str++) {
 #ifdef HAVE_WIDECHAR
-		int x = wcwidth(*str);	/* don't use wcswidth(), need to ignore non-printable */
+		int x;
+
+		if (*str >= 0x20 && *str < 0x7f) {
+			width++;		/* printable ASCII, no wcwidth() call */
+			continue;
+		}
+		x = wcwidth(*str);	/* don't use wcswidth(), need to ignore non-printable */
 		if (x > 0)
 			width += x;
 #else